@@ -180,6 +180,20 @@ std::string MediaLibraryFrontend::Impl::create_pipeline_string()
         std::cout << "Failed to get output streams ids" << std::endl;
         throw new std::runtime_error("Failed to get output streams ids");
     }
+    // The sensor and its caps are taken from the input stream configuration, if present
+    std::string video_device = "/dev/video0";
+    uint32_t width = 3840, height = 2160, framerate = 30;
+    if (m_json_config.contains("input_stream"))
+    {
+        nlohmann::json input_config = m_json_config["input_stream"];
+        video_device = input_config.value("source", video_device);
+        if (input_config.contains("resolution"))
+        {
+            width = input_config["resolution"].value("width", width);
+            height = input_config["resolution"].value("height", height);
+            framerate = input_config["resolution"].value("framerate", framerate);
+        }
+    }
     std::ostringstream pipeline;
 
     switch (m_src_element)
@@ -188,7 +202,7 @@ std::string MediaLibraryFrontend::Impl::create_pipeline_string()
         pipeline << "appsrc name=src do-timestamp=true format=buffers is-live=true max-bytes=0 ! ";
         break;
     case FRONTEND_SRC_ELEMENT_V4L2SRC:
-        pipeline << "v4l2src name=src device=/dev/video0 io-mode=mmap ! ";
+        pipeline << "v4l2src name=src device=" << video_device << " io-mode=mmap ! ";
         break;
     default:
         std::cout << "Invalid src element " << m_src_element << std::endl;
@@ -196,7 +210,7 @@ std::string MediaLibraryFrontend::Impl::create_pipeline_string()
     }
 
     pipeline << "queue leaky=no max-size-buffers=5 max-size-time=0 max-size-bytes=0 ! ";
-    pipeline << "video/x-raw,format=NV12,width=3840,height=2160,framerate=30/1 ! ";
+    pipeline << "video/x-raw,format=NV12,width=" << width << ",height=" << height << ",framerate=" << framerate << "/1 ! ";
     pipeline << "hailofrontend name=frontend config-string='" << std::string(m_json_config.dump()) << "' ";
     for (frontend_output_stream_t s : outputs_expected.value())
     {
@@ -82,7 +82,9 @@ static GstVideoMeta *add_video_meta_to_buffer(GstBuffer *buffer,
 {
     GstVideoAlignment alignment;
     gst_video_alignment_reset(&alignment);
-    alignment.padding_right = hailo_buffer->hailo_pix_buffer->planes[0].bytesperline - GST_VIDEO_INFO_PLANE_STRIDE(video_info, 0);
+    // padding_right is given in pixels while the strides are in bytes - 3 bytes per pixel for packed RGB
+    gint pixel_stride = GST_VIDEO_INFO_COMP_PSTRIDE(video_info, 0);
+    alignment.padding_right = (hailo_buffer->hailo_pix_buffer->planes[0].bytesperline - GST_VIDEO_INFO_PLANE_STRIDE(video_info, 0)) / (pixel_stride > 0 ? pixel_stride : 1);
     if (!gst_video_info_align(video_info, &alignment))
     {
         return NULL;
@@ -181,6 +183,7 @@ static bool create_hailo_buffer_from_video_frame(GstVideoFrame *video_frame, hai
         return false;
 
     hailo_buffer.create(nullptr, input_dsp_image_props_ptr);
+    hailo_buffer.latency.stamp_ingress();
     if (hailo_v4l2_meta)
     {
         hailo_buffer.vsm = hailo_v4l2_meta->vsm;
@@ -22,6 +22,7 @@
  */
 #include "gsthailodenoise.hpp"
 #include "common/gstmedialibcommon.hpp"
+#include "buffer_utils/gsthailobuffermeta.hpp"
 
 #include <gst/gst.h>
 #include <gst/video/video.h>
@@ -448,6 +449,10 @@ gst_hailodenoise_sink_probe(GstPad *pad, GstPadProbeInfo *info, GstHailoDenoise
         GST_WARNING_OBJECT(hailodenoise, "Buffer is not writable at sink probe");
     }
 
+    GstHailoBufferMeta *hailo_buffer_meta = gst_buffer_get_hailo_buffer_meta(buffer);
+    if (hailo_buffer_meta && hailo_buffer_meta->buffer_ptr)
+        hailo_buffer_meta->buffer_ptr->latency.stamp_start(FRAME_LATENCY_STAGE_DENOISE);
+
     // Get the network configurations
     feedback_network_config_t net_configs = hailodenoise->medialib_denoise->get_denoise_configs().network_config;
     uint loopback = hailodenoise->medialib_denoise->get_denoise_configs().loopback_count;
@@ -578,6 +583,10 @@ gst_hailodenoise_src_probe(GstPad *pad, GstPadProbeInfo *info, GstHailoDenoise *
     // Loop-back the denoised buffer
     gst_hailodenoise_queue_buffer(hailodenoise, loopback_payload);
 
+    GstHailoBufferMeta *hailo_buffer_meta = gst_buffer_get_hailo_buffer_meta(buffer);
+    if (hailo_buffer_meta && hailo_buffer_meta->buffer_ptr)
+        hailo_buffer_meta->buffer_ptr->latency.stamp_end(FRAME_LATENCY_STAGE_DENOISE);
+
     return GST_PAD_PROBE_PASS;
 }
 
@@ -32,6 +32,8 @@ GST_DEBUG_CATEGORY_STATIC(gst_hailo_multi_resize_debug);
 
 #define ROTATION_EVENT_NAME "HAILO_ROTATION_EVENT"
 #define ROTATION_EVENT_PROP_NAME "rotation"
+// Type of the GstVideoRegionOfInterestMeta of the input buffer to mask in the frame (e.g. set by analytics on faces)
+#define PRIVACY_MASK_ROI_TYPE "privacy-mask"
 
 // Pad Templates
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink",
@@ -161,7 +163,7 @@ static GstFlowReturn gst_hailo_multi_resize_push_output_frames(GstHailoMultiResi
     {
         if (output_frames[i].hailo_pix_buffer == nullptr)
         {
-            GST_DEBUG_OBJECT(self, "Skipping output frame %d to match requested framerate", i);
+            GST_DEBUG_OBJECT(self, "Skipping output frame %d to match requested framerate or saturated consumer", i);
             continue;
         }
 
@@ -200,6 +202,52 @@ static GstFlowReturn gst_hailo_multi_resize_push_output_frames(GstHailoMultiResi
     return ret;
 }
 
+/**
+ * Report the occupancy of the consumer linked to each srcpad, so saturated outputs are skipped
+ * before resizing. The level is read from a downstream queue element when the srcpad is linked to one.
+ */
+static void gst_hailo_multi_resize_update_consumer_levels(GstHailoMultiResize *self)
+{
+    for (guint i = 0; i < self->srcpads.size(); i++)
+    {
+        guint queued_buffers = 0;
+        guint max_queued_buffers = 0;
+        GstPad *peer = gst_pad_get_peer(self->srcpads[i]);
+        if (peer)
+        {
+            GstElement *consumer = gst_pad_get_parent_element(peer);
+            if (consumer)
+            {
+                GObjectClass *consumer_class = G_OBJECT_GET_CLASS(consumer);
+                if (g_object_class_find_property(consumer_class, "current-level-buffers") &&
+                    g_object_class_find_property(consumer_class, "max-size-buffers"))
+                {
+                    g_object_get(consumer, "current-level-buffers", &queued_buffers, "max-size-buffers", &max_queued_buffers, NULL);
+                }
+                gst_object_unref(consumer);
+            }
+            gst_object_unref(peer);
+        }
+
+        self->medialib_multi_resize->set_output_consumer_level(i, queued_buffers, max_queued_buffers);
+    }
+}
+
+static void gst_hailo_multi_resize_get_privacy_mask_rects(GstBuffer *buffer, std::vector<roi_t> &rects)
+{
+    rects.clear();
+    gpointer state = NULL;
+    GstMeta *meta;
+    GQuark privacy_mask_roi_type = g_quark_from_static_string(PRIVACY_MASK_ROI_TYPE);
+    while ((meta = gst_buffer_iterate_meta_filtered(buffer, &state, GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE)))
+    {
+        GstVideoRegionOfInterestMeta *roi_meta = reinterpret_cast<GstVideoRegionOfInterestMeta *>(meta);
+        if (roi_meta->roi_type != privacy_mask_roi_type)
+            continue;
+        rects.push_back({roi_meta->x, roi_meta->y, roi_meta->w, roi_meta->h});
+    }
+}
+
 static GstFlowReturn gst_hailo_multi_resize_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer)
 {
     GstHailoMultiResize *self = GST_HAILO_MULTI_RESIZE(parent);
@@ -216,9 +264,12 @@ static GstFlowReturn gst_hailo_multi_resize_chain(GstPad *pad, GstObject *parent
         return GST_FLOW_ERROR;
     }
     gst_caps_unref(input_caps);
+    gst_hailo_multi_resize_get_privacy_mask_rects(buffer, input_frame_ptr->privacy_mask_rects);
 
     std::vector<hailo_media_library_buffer> output_frames;
 
+    gst_hailo_multi_resize_update_consumer_levels(self);
+
     GST_DEBUG_OBJECT(self, "Call media library handle frame - GstBuffer offset %ld", GST_BUFFER_OFFSET(buffer));
     media_library_return media_lib_ret = self->medialib_multi_resize->handle_frame(*input_frame_ptr.get(), output_frames);
 
@@ -268,6 +319,22 @@ gst_hailo_create_caps_from_output_config(GstHailoMultiResize *self, output_resol
         return NULL;
     }
 
+    // Outputs converted to RGB override the format of the output video
+    switch (output_res.color_format)
+    {
+    case COLOR_FORMAT_RGB:
+        format = "RGB";
+        break;
+    case COLOR_FORMAT_BGR:
+        format = "BGR";
+        break;
+    case COLOR_FORMAT_RGB_PLANAR:
+        format = "RGBP";
+        break;
+    default:
+        break;
+    }
+
     GST_DEBUG_OBJECT(self, "Creating caps - width = %ld height = %ld framerate = %d", output_res.dimensions.destination_width, output_res.dimensions.destination_height, output_res.framerate);
     caps = gst_caps_new_simple("video/x-raw",
                                "format", G_TYPE_STRING, format.c_str(),
@@ -354,7 +354,7 @@ static GstFlowReturn gst_hailoosd_transform_ip(GstBaseTransform *trans,
     media_library_buffer = hailo_buffer_from_gst_buffer(buffer, caps);
 
     // perform blending
-    ret = hailoosd->blender->blend(*media_library_buffer->hailo_pix_buffer.get());
+    ret = hailoosd->blender->blend(*media_library_buffer);
     if (ret != MEDIA_LIBRARY_SUCCESS)
     {
         GST_ERROR_OBJECT(trans, "Failed to do blend (%d)", ret);
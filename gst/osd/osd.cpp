@@ -265,6 +265,14 @@ namespace osd
 
     media_library_return Blender::blend(dsp_image_properties_t &input_image_properties) { return m_impl->blend(input_image_properties); }
 
+    media_library_return Blender::blend(hailo_media_library_buffer &buffer)
+    {
+        buffer.latency.stamp_start(FRAME_LATENCY_STAGE_OSD_BLEND);
+        media_library_return ret = m_impl->blend(*buffer.hailo_pix_buffer);
+        buffer.latency.stamp_end(FRAME_LATENCY_STAGE_OSD_BLEND);
+        return ret;
+    }
+
     media_library_return Blender::set_frame_size(int frame_width, int frame_height) { return m_impl->set_frame_size(frame_width, frame_height); }
 
 }
\ No newline at end of file
@@ -253,6 +253,13 @@ namespace osd
 
         media_library_return set_frame_size(int frame_width, int frame_height);
         media_library_return blend(dsp_image_properties_t &input_image_properties);
+        /**
+         * @brief Blend all overlays onto a media library buffer
+         * @details Same as blending its image properties, and stamps the blend stage in the latency record of the buffer
+         * @param[in] buffer The buffer to blend onto
+         * @return :MEDIA_LIBRARY_SUCCESS if successful, otherwise a :media_library_return error
+         */
+        media_library_return blend(hailo_media_library_buffer &buffer);
 
     private:
         class Impl;
@@ -24,10 +24,20 @@
 #include "osd_impl.hpp"
 #include "buffer_utils/buffer_utils.hpp"
 #include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <map>
 #include <thread>
 #include <iomanip>
 
 #define WIDTH_PADDING 10
+// Timestamp of DateTimeOverlay, its characters, and a timestamp of the same layout
+#define DATETIME_FORMAT "%d-%m-%Y %H:%M:%S"
+#define DATETIME_GLYPHS "0123456789-: "
+#define DATETIME_TEMPLATE "00-00-0000 00:00:00"
+#define DATETIME_MAX_LENGTH 32
 
 cv::Mat OverlayImpl::resize_mat(cv::Mat mat, int width, int height)
 {
@@ -217,6 +227,21 @@ OverlayImpl::OverlayImpl(std::string id, float x, float y, float width, float he
 {
 }
 
+OverlayImpl::OverlayImpl(const OverlayImpl &other) : m_image_mat(other.m_image_mat), m_id(other.m_id), m_x(other.m_x), m_y(other.m_y), m_width(other.m_width), m_height(other.m_height), m_z_index(other.m_z_index), m_angle(other.m_angle), m_rotation_policy(other.m_rotation_policy), m_ready_to_blend(false)
+{
+}
+
+tl::expected<OverlayImplPtr, media_library_return> OverlayImpl::prepare_overlay(OverlayImplPtr overlay, int frame_width, int frame_height)
+{
+    auto overlays_expected = overlay->create_dsp_overlays(frame_width, frame_height);
+    if (!overlays_expected.has_value())
+    {
+        LOGGER__ERROR("Failed to prepare overlay {} ({})", overlay->get_id(), overlays_expected.error());
+        return tl::make_unexpected(overlays_expected.error());
+    }
+    return overlay;
+}
+
 bool OverlayImpl::get_ready_to_blend()
 {
     /*
@@ -367,11 +392,21 @@ TextOverlayImpl::TextOverlayImpl(const osd::TextOverlay &overlay, media_library_
 }
 
 DateTimeOverlayImpl::DateTimeOverlayImpl(const osd::DateTimeOverlay &overlay, media_library_return &status) : OverlayImpl(overlay.id, overlay.x, overlay.y, 0, 0, overlay.z_index, overlay.angle, overlay.rotation_alignment_policy, false),
-                                                                                                              m_rgb_text_color{overlay.rgb.red, overlay.rgb.green, overlay.rgb.blue}, m_font_size(overlay.font_size), m_line_thickness(overlay.line_thickness)
+                                                                                                              m_rgb_text_color{overlay.rgb.red, overlay.rgb.green, overlay.rgb.blue}, m_font_size(overlay.font_size), m_line_thickness(overlay.line_thickness),
+                                                                                                              m_frame_width(0), m_frame_height(0)
 {
     status = MEDIA_LIBRARY_SUCCESS;
 }
 
+DateTimeOverlayImpl::~DateTimeOverlayImpl()
+{
+    if (m_angle == 0)
+    {
+        // the overlay images are the timestamp frames of the renderer, freed by it
+        m_dsp_overlays.clear();
+    }
+}
+
 CustomOverlayImpl::CustomOverlayImpl(const osd::CustomOverlay &overlay, media_library_return &status) : OverlayImpl(overlay.id, overlay.x, overlay.y, overlay.width, overlay.height, overlay.z_index, overlay.angle, overlay.rotation_alignment_policy, false)
 {
     status = MEDIA_LIBRARY_SUCCESS;
@@ -544,6 +579,27 @@ tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> ImageO
     return OverlayImpl::create_dsp_overlays(frame_width, frame_height);
 }
 
+tl::expected<OverlayImplPtr, media_library_return> ImageOverlayImpl::create_resized_overlay(int frame_width, int frame_height)
+{
+    return prepare_overlay(std::make_shared<ImageOverlayImpl>(*this), frame_width, frame_height);
+}
+
+tl::expected<OverlayImplPtr, media_library_return> TextOverlayImpl::create_resized_overlay(int frame_width, int frame_height)
+{
+    // The rendered text is shared, only its DSP image is created again
+    return prepare_overlay(std::make_shared<TextOverlayImpl>(*this), frame_width, frame_height);
+}
+
+tl::expected<OverlayImplPtr, media_library_return> CustomOverlayImpl::create_resized_overlay(int frame_width, int frame_height)
+{
+    if (!m_dsp_overlays.empty())
+    {
+        // The buffer the application draws into is kept as is
+        return OverlayImplPtr();
+    }
+    return prepare_overlay(std::make_shared<CustomOverlayImpl>(*this), frame_width, frame_height);
+}
+
 tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> CustomOverlayImpl::create_dsp_overlays(int frame_width, int frame_height)
 {
     if (frame_width == 0 || frame_height == 0)
@@ -587,6 +643,288 @@ tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> Custom
     return m_dsp_overlays;
 }
 
+static std::mutex datetime_renderers_mutex;
+static std::map<std::tuple<int, int, int, float, int>, std::weak_ptr<DateTimeRenderer>> datetime_renderers;
+
+datetime_frame_t::~datetime_frame_t()
+{
+    if (mapped)
+    {
+        dsp_utils::free_image_property_planes(&dsp_image);
+        gst_video_frame_unmap(&video_frame);
+    }
+}
+
+tl::expected<DateTimeRendererPtr, media_library_return> DateTimeRenderer::get_shared(const std::array<int, 3> &rgb_text_color, float font_size, int line_thickness)
+{
+    auto key = std::make_tuple(rgb_text_color[0], rgb_text_color[1], rgb_text_color[2], font_size, line_thickness);
+
+    std::unique_lock<std::mutex> lock(datetime_renderers_mutex);
+    DateTimeRendererPtr renderer = datetime_renderers[key].lock();
+    if (renderer != nullptr)
+    {
+        LOGGER__DEBUG("Sharing DateTime renderer");
+        return renderer;
+    }
+
+    media_library_return status = MEDIA_LIBRARY_UNINITIALIZED;
+    renderer = std::make_shared<DateTimeRenderer>(rgb_text_color, font_size, line_thickness, status);
+    if (status != MEDIA_LIBRARY_SUCCESS)
+    {
+        return tl::make_unexpected(status);
+    }
+    datetime_renderers[key] = renderer;
+    return renderer;
+}
+
+DateTimeRenderer::DateTimeRenderer(const std::array<int, 3> &rgb_text_color, float font_size, int line_thickness, media_library_return &status) : m_rgb_text_color(rgb_text_color), m_font_size(font_size), m_line_thickness(line_thickness),
+                                                                                                                                                    m_width(0), m_height(0), m_glyph_atlas_ready(false), m_stop_timer(false)
+{
+    status = create_glyph_atlas();
+    if (status != MEDIA_LIBRARY_SUCCESS)
+    {
+        return;
+    }
+
+    // The current second is published right away, the timer publishes the next ones
+    auto frame_expected = acquire_frame();
+    if (!frame_expected.has_value())
+    {
+        status = frame_expected.error();
+        return;
+    }
+    status = compose(*frame_expected.value(), std::time(nullptr));
+    if (status != MEDIA_LIBRARY_SUCCESS)
+    {
+        return;
+    }
+    std::atomic_store(&m_published_frame, frame_expected.value());
+
+    m_timer_thread = std::thread(&DateTimeRenderer::timer_loop, this);
+}
+
+DateTimeRenderer::~DateTimeRenderer()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_timer_mutex);
+        m_stop_timer = true;
+    }
+    m_timer_cv.notify_all();
+    if (m_timer_thread.joinable())
+    {
+        m_timer_thread.join();
+    }
+
+    m_published_frame = nullptr;
+    m_frames.clear();
+    if (m_glyph_atlas_ready)
+    {
+        gst_video_frame_unmap(&m_glyph_atlas_frame);
+    }
+}
+
+DateTimeFramePtr DateTimeRenderer::get_frame()
+{
+    return std::atomic_load(&m_published_frame);
+}
+
+media_library_return DateTimeRenderer::create_glyph_atlas()
+{
+    // calculate the size of the text
+    int baseline = 0;
+    cv::Size text_size = cv::getTextSize(DATETIME_TEMPLATE, cv::FONT_HERSHEY_SIMPLEX, m_font_size, m_line_thickness, &baseline);
+
+    // ensure even dimensions, round up not to clip text - the chroma of the overlay is subsampled by 2
+    text_size.height += text_size.height % 2;
+    baseline += baseline % 2;
+    int height = text_size.height + baseline;
+
+    // All the digits get the cell of the widest, so that the layout does not change with the time
+    int digit_width = 0;
+    for (char digit = '0'; digit <= '9'; digit++)
+    {
+        digit_width = std::max(digit_width, cv::getTextSize(std::string(1, digit), cv::FONT_HERSHEY_SIMPLEX, m_font_size, m_line_thickness, &baseline).width);
+    }
+
+    m_glyph_atlas_x.fill(-1);
+    m_glyph_width.fill(0);
+    int atlas_width = 0;
+    for (char glyph : std::string(DATETIME_GLYPHS))
+    {
+        int width = std::isdigit(glyph) ? digit_width : cv::getTextSize(std::string(1, glyph), cv::FONT_HERSHEY_SIMPLEX, m_font_size, m_line_thickness, &baseline).width;
+        // cells start at even columns, so they do not share chroma samples
+        width += width % 2;
+        m_glyph_atlas_x[(unsigned char)glyph] = atlas_width;
+        m_glyph_width[(unsigned char)glyph] = width;
+        atlas_width += width;
+    }
+
+    m_cell_x.clear();
+    m_cell_width.clear();
+    int width = 0;
+    for (char glyph : std::string(DATETIME_TEMPLATE))
+    {
+        m_cell_x.push_back(width);
+        m_cell_width.push_back(m_glyph_width[(unsigned char)glyph]);
+        width += m_glyph_width[(unsigned char)glyph];
+    }
+    m_width = width;
+    m_height = height;
+
+    // draw each glyph on a transparent BGRA image, clipped to its cell
+    cv::Mat atlas_mat = cv::Mat(height, atlas_width, CV_8UC4, cv::Scalar(0, 0, 0, 0));
+    cv::Scalar text_color(m_rgb_text_color[2], m_rgb_text_color[1], m_rgb_text_color[0], 255); // The input is expected RGB, but we draw as BGRA
+    for (char glyph : std::string(DATETIME_GLYPHS))
+    {
+        cv::Mat cell = atlas_mat(cv::Rect(m_glyph_atlas_x[(unsigned char)glyph], 0, m_glyph_width[(unsigned char)glyph], height));
+        cv::putText(cell, std::string(1, glyph), cv::Point(0, text_size.height), cv::FONT_HERSHEY_SIMPLEX, m_font_size, text_color, m_line_thickness);
+    }
+
+    GstVideoFrame gst_bgra_image = OverlayImpl::gst_video_frame_from_mat_bgra(atlas_mat);
+    media_library_return status = OverlayImpl::convert_2_dsp_video_frame(&gst_bgra_image, &m_glyph_atlas_frame, GST_VIDEO_FORMAT_A420);
+
+    gst_buffer_unref(gst_bgra_image.buffer);
+    gst_video_frame_unmap(&gst_bgra_image);
+
+    if (status != MEDIA_LIBRARY_SUCCESS)
+    {
+        LOGGER__ERROR("Failed to convert the DateTime glyph atlas");
+        return status;
+    }
+
+    m_glyph_atlas_ready = true;
+    LOGGER__DEBUG("DateTime glyph atlas created, {}x{} for {} glyphs", atlas_width, height, std::string(DATETIME_GLYPHS).size());
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+void DateTimeRenderer::compose_glyph(datetime_frame_t &datetime_frame, size_t position, char glyph)
+{
+    int atlas_x = m_glyph_atlas_x[(unsigned char)glyph];
+    if (atlas_x < 0)
+    {
+        LOGGER__ERROR("Character '{}' is not in the DateTime glyph atlas", glyph);
+        return;
+    }
+
+    // Copy the cell of every plane (Y, U, V, A) - the cells are aligned to the chroma subsampling
+    GstVideoFrame *frame = &datetime_frame.video_frame;
+    const GstVideoFormatInfo *finfo = frame->info.finfo;
+    int width = std::min(m_glyph_width[(unsigned char)glyph], m_cell_width[position]);
+    for (uint component = 0; component < GST_VIDEO_FRAME_N_COMPONENTS(frame); component++)
+    {
+        int pixel_stride = GST_VIDEO_FRAME_COMP_PSTRIDE(frame, component);
+        int src_stride = GST_VIDEO_FRAME_COMP_STRIDE(&m_glyph_atlas_frame, component);
+        int dest_stride = GST_VIDEO_FRAME_COMP_STRIDE(frame, component);
+        const uint8_t *src = (const uint8_t *)GST_VIDEO_FRAME_COMP_DATA(&m_glyph_atlas_frame, component) + GST_VIDEO_FORMAT_INFO_SCALE_WIDTH(finfo, component, atlas_x) * pixel_stride;
+        uint8_t *dest = (uint8_t *)GST_VIDEO_FRAME_COMP_DATA(frame, component) + GST_VIDEO_FORMAT_INFO_SCALE_WIDTH(finfo, component, m_cell_x[position]) * pixel_stride;
+        size_t row_size = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH(finfo, component, width) * pixel_stride;
+        for (int row = 0; row < GST_VIDEO_FRAME_COMP_HEIGHT(frame, component); row++)
+        {
+            memcpy(dest + row * dest_stride, src + row * src_stride, row_size);
+        }
+    }
+}
+
+tl::expected<DateTimeFramePtr, media_library_return> DateTimeRenderer::acquire_frame()
+{
+    // Called from the timer thread, or from the constructor before it starts
+    for (const DateTimeFramePtr &frame : m_frames)
+    {
+        if (frame.use_count() == 1)
+        {
+            // released by all the overlays and blends which used it
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return frame;
+        }
+    }
+
+    // All the frames are held - allocated only until there is one for each overlay holding an old timestamp
+    DateTimeFramePtr frame = std::make_shared<datetime_frame_t>();
+    media_library_return status = OverlayImpl::create_gst_video_frame(m_width, m_height, "A420", &frame->video_frame);
+    if (status != MEDIA_LIBRARY_SUCCESS)
+    {
+        LOGGER__ERROR("Failed to create DateTime frame");
+        return tl::make_unexpected(status);
+    }
+    frame->mapped = true;
+    create_dsp_buffer_from_video_frame(&frame->video_frame, frame->dsp_image);
+    frame->datetime = std::string(m_cell_x.size(), '\0');
+    m_frames.push_back(frame);
+    LOGGER__DEBUG("DateTime renderer holding {} frames", m_frames.size());
+    return frame;
+}
+
+media_library_return DateTimeRenderer::compose(datetime_frame_t &frame, std::time_t time)
+{
+    char datetime[DATETIME_MAX_LENGTH];
+    size_t datetime_length = write_timestamp(datetime, sizeof(datetime), time);
+    if (datetime_length != m_cell_x.size())
+    {
+        LOGGER__ERROR("Timestamp {} does not match the DateTime layout", std::string(datetime, datetime_length));
+        return MEDIA_LIBRARY_ERROR;
+    }
+
+    // Compose only the characters changed since the frame was last drawn, in place - no allocation
+    for (size_t i = 0; i < datetime_length; i++)
+    {
+        if (datetime[i] != frame.datetime[i])
+        {
+            compose_glyph(frame, i, datetime[i]);
+            frame.datetime[i] = datetime[i];
+        }
+    }
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+void DateTimeRenderer::timer_loop()
+{
+    std::unique_lock<std::mutex> lock(m_timer_mutex);
+    while (!m_stop_timer)
+    {
+        // Render the next second ahead of time
+        auto now = std::chrono::system_clock::now();
+        auto next_second = std::chrono::floor<std::chrono::seconds>(now) + std::chrono::seconds(1);
+        // Wait for the rest of the second on the steady clock, setting the wall clock does not move the wake up
+        auto wake_up = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(next_second - now);
+        lock.unlock();
+        auto frame_expected = acquire_frame();
+        media_library_return status = frame_expected.has_value() ? compose(*frame_expected.value(), std::chrono::system_clock::to_time_t(next_second)) : frame_expected.error();
+        lock.lock();
+
+        if (m_timer_cv.wait_until(lock, wake_up, [this]
+                                  { return m_stop_timer; }))
+        {
+            break;
+        }
+        if (status != MEDIA_LIBRARY_SUCCESS)
+        {
+            LOGGER__ERROR("Failed to render DateTime, status: {}", status);
+            continue;
+        }
+
+        // The clock may have been set meanwhile - show the second it is now
+        auto current_second = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
+        if (current_second != next_second)
+        {
+            status = compose(*frame_expected.value(), std::chrono::system_clock::to_time_t(current_second));
+            if (status != MEDIA_LIBRARY_SUCCESS)
+            {
+                // Keep the previous frame rather than publishing one of another second
+                LOGGER__ERROR("Failed to render DateTime, status: {}", status);
+                continue;
+            }
+        }
+        std::atomic_store(&m_published_frame, frame_expected.value());
+    }
+}
+
+size_t DateTimeRenderer::write_timestamp(char *buffer, size_t size, std::time_t time)
+{
+    std::tm tm;
+    localtime_r(&time, &tm);
+    return std::strftime(buffer, size, DATETIME_FORMAT, &tm);
+}
+
 tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> DateTimeOverlayImpl::create_dsp_overlays(int frame_width, int frame_height)
 {
     if (frame_width == 0 || frame_height == 0)
@@ -594,6 +932,63 @@ tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> DateTi
         return tl::make_unexpected(MEDIA_LIBRARY_UNINITIALIZED);
     }
 
+    if (m_angle != 0)
+    {
+        return create_rotated_dsp_overlays(frame_width, frame_height);
+    }
+
+    if (m_renderer == nullptr)
+    {
+        auto renderer_expected = DateTimeRenderer::get_shared(m_rgb_text_color, m_font_size, m_line_thickness);
+        if (!renderer_expected.has_value())
+        {
+            LOGGER__ERROR("Failed to create DateTime renderer of overlay {}", m_id);
+            return tl::make_unexpected(renderer_expected.error());
+        }
+        m_renderer = renderer_expected.value();
+    }
+
+    DateTimeFramePtr datetime_frame = m_renderer->get_frame();
+    dsp_image_properties_t dsp_image = datetime_frame->dsp_image;
+    m_width = dsp_image.width;
+    m_height = dsp_image.height;
+
+    auto offsets_expected = calc_xy_offsets(m_id, m_x, m_y, dsp_image.width, dsp_image.height, frame_width, frame_height, 0, 0);
+    if (!offsets_expected.has_value())
+    {
+        return tl::make_unexpected(offsets_expected.error());
+    }
+
+    auto [x_offset, y_offset] = offsets_expected.value();
+    dsp_overlay_properties_t dsp_overlay =
+        {
+            .overlay = dsp_image,
+            .x_offset = (size_t)x_offset,
+            .y_offset = (size_t)y_offset,
+        };
+
+    m_datetime_frame = datetime_frame;
+    m_dsp_overlays = {dsp_overlay};
+    m_frame_width = frame_width;
+    m_frame_height = frame_height;
+    m_ready_to_blend = true;
+    return m_dsp_overlays;
+}
+
+tl::expected<OverlayImplPtr, media_library_return> DateTimeOverlayImpl::create_resized_overlay(int frame_width, int frame_height)
+{
+    // Created from the settings only - the timestamp of this overlay is updated by the blends meanwhile
+    auto overlay_expected = create(*std::static_pointer_cast<osd::DateTimeOverlay>(get_metadata()));
+    if (!overlay_expected.has_value())
+    {
+        return tl::make_unexpected(overlay_expected.error());
+    }
+    return prepare_overlay(overlay_expected.value(), frame_width, frame_height);
+}
+
+tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> DateTimeOverlayImpl::create_rotated_dsp_overlays(int frame_width, int frame_height)
+{
+    // The rotated text does not split into cells - it is rendered whole each time it changes
     std::string datetime = select_chars_for_timestamp();
     if (datetime == m_datetime_str)
     {
@@ -650,19 +1045,29 @@ tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> DateTi
         return tl::make_unexpected(MEDIA_LIBRARY_UNINITIALIZED);
     }
 
-    // in case of DateTime, overlay needs to be refreshed with the current time
-    create_dsp_overlays(m_frame_width, m_frame_height);
+    if (m_angle != 0)
+    {
+        // in case of a rotated DateTime, overlay needs to be refreshed with the current time
+        create_rotated_dsp_overlays(m_frame_width, m_frame_height);
+        return m_dsp_overlays;
+    }
+
+    // Rendered ahead of time by the renderer - only the latest timestamp is loaded
+    DateTimeFramePtr datetime_frame = m_renderer->get_frame();
+    if (datetime_frame != m_datetime_frame)
+    {
+        m_datetime_frame = datetime_frame;
+        m_dsp_overlays[0].overlay = m_datetime_frame->dsp_image;
+    }
 
     return m_dsp_overlays;
 }
 
 std::string DateTimeOverlayImpl::select_chars_for_timestamp()
 {
-    auto t = std::time(nullptr);
-    auto tm = *std::localtime(&t);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%d-%m-%Y %H:%M:%S");
-    return oss.str();
+    char datetime[DATETIME_MAX_LENGTH];
+    size_t datetime_length = DateTimeRenderer::write_timestamp(datetime, sizeof(datetime), std::time(nullptr));
+    return std::string(datetime, datetime_length);
 }
 
 std::shared_ptr<osd::Overlay> ImageOverlayImpl::get_metadata()
@@ -712,6 +1117,8 @@ namespace osd
         m_frame_width = 0;
         m_frame_height = 0;
         m_frame_size_set = false;
+        m_frame_size_generation = 0;
+        std::atomic_store(&m_blend_overlays, std::make_shared<const std::vector<OverlayImplPtr>>());
         m_config_manager = std::make_shared<ConfigManager>(ConfigSchema::CONFIG_SCHEMA_OSD);
         // check if the config has ' at the beginning and end of the string. if so, remove them
         std::string clean_config = config; // config is const, so we need to copy it
@@ -778,6 +1185,7 @@ namespace osd
 
     Blender::Impl::~Impl()
     {
+        std::atomic_store(&m_blend_overlays, std::shared_ptr<const std::vector<OverlayImplPtr>>());
         m_prioritized_overlays.clear();
         m_overlays.clear();
 
@@ -902,6 +1310,8 @@ namespace osd
 
     media_library_return Blender::Impl::add_overlay(const OverlayImplPtr overlay)
     {
+        // Held while the overlay is prepared, so that set_frame_size() does not change the frame size meanwhile
+        std::unique_lock ulock(m_mutex);
         if (m_overlays.contains(overlay->get_id()))
         {
             LOGGER__ERROR("Overlay with id {} already exists", overlay->get_id());
@@ -917,8 +1327,20 @@ namespace osd
             }
         }
 
-        std::unique_lock ulock(m_mutex);
-        return add_overlay_internal(overlay);
+        media_library_return ret = add_overlay_internal(overlay);
+        if (ret == MEDIA_LIBRARY_SUCCESS)
+        {
+            publish_overlays();
+        }
+        return ret;
+    }
+
+    // this method is not thread safe, the caller should have a mutex locked
+    void Blender::Impl::publish_overlays()
+    {
+        // The removed overlays are released by the last blend still using the previous list
+        auto blend_overlays = std::make_shared<const std::vector<OverlayImplPtr>>(m_prioritized_overlays.begin(), m_prioritized_overlays.end());
+        std::atomic_store(&m_blend_overlays, blend_overlays);
     }
 
     // this method is not thread safe, the caller should have a mutex locked
@@ -950,16 +1372,44 @@ namespace osd
         return MEDIA_LIBRARY_SUCCESS;
     }
 
+    // this method is not thread safe, the caller should have a mutex locked
+    media_library_return Blender::Impl::replace_overlay_internal(const OverlayImplPtr previous_overlay, const OverlayImplPtr overlay)
+    {
+        if (remove_overlay_internal(previous_overlay->get_id()) != MEDIA_LIBRARY_SUCCESS)
+        {
+            LOGGER__ERROR("Failed to remove overlay with id {}", previous_overlay->get_id());
+            return MEDIA_LIBRARY_ERROR;
+        }
+
+        media_library_return ret = add_overlay_internal(overlay);
+        if (ret != MEDIA_LIBRARY_SUCCESS)
+        {
+            if (add_overlay_internal(previous_overlay) != MEDIA_LIBRARY_SUCCESS)
+            {
+                LOGGER__ERROR("Failed to replace overlay with id {}, and to restore the previous one - it is removed", overlay->get_id());
+                return MEDIA_LIBRARY_ERROR;
+            }
+            LOGGER__ERROR("Failed to replace overlay with id {}, keeping the previous one", overlay->get_id());
+            return ret;
+        }
+        return MEDIA_LIBRARY_SUCCESS;
+    }
+
     media_library_return Blender::Impl::remove_overlay(const std::string &id)
     {
+        std::unique_lock lock(m_mutex);
         if (!m_overlays.contains(id))
         {
             LOGGER__ERROR("No overlay with id {}", id);
             return MEDIA_LIBRARY_INVALID_ARGUMENT;
         }
 
-        std::unique_lock lock(m_mutex);
-        return remove_overlay_internal(id);
+        media_library_return ret = remove_overlay_internal(id);
+        if (ret == MEDIA_LIBRARY_SUCCESS)
+        {
+            publish_overlays();
+        }
+        return ret;
     }
 
     // this method is not thread safe, the caller should have a mutex locked
@@ -1110,6 +1560,8 @@ namespace osd
 
     media_library_return Blender::Impl::set_overlay(const OverlayImplPtr overlay)
     {
+        // Held while the overlay is prepared, so that set_frame_size() does not change the frame size meanwhile
+        std::unique_lock lock(m_mutex);
         if (!m_overlays.contains(overlay->get_id()))
         {
             LOGGER__ERROR("No overlay with id {}", overlay->get_id());
@@ -1125,24 +1577,24 @@ namespace osd
             }
         }
 
-        std::unique_lock lock(m_mutex);
-        if (remove_overlay_internal(overlay->get_id()) != MEDIA_LIBRARY_SUCCESS)
-        {
-            LOGGER__ERROR("Failed to remove overlay with id {}", overlay->get_id());
-            return MEDIA_LIBRARY_ERROR;
-        }
-
-        return add_overlay_internal(overlay);
+        // Published in a single step - the blends see either the previous overlay or the new one. If the previous
+        // one could not be restored either, the list without it is published.
+        media_library_return ret = replace_overlay_internal(m_overlays[overlay->get_id()], overlay);
+        publish_overlays();
+        return ret;
     }
 
     media_library_return Blender::Impl::blend(dsp_image_properties_t &input_image_properties)
     {
-        std::unique_lock lock(m_mutex);
+        // Never waits for an update of the overlays - it reads the latest published list, which keeps its overlays
+        // alive until they are blended
+        std::unique_lock lock(m_blend_mutex);
+        std::shared_ptr<const std::vector<OverlayImplPtr>> blend_overlays = std::atomic_load(&m_blend_overlays);
 
         // We prepare to blend all overlays at once
         std::vector<dsp_overlay_properties_t> all_overlays_to_blend;
-        all_overlays_to_blend.reserve(m_overlays.size());
-        for (const auto &overlay : m_prioritized_overlays)
+        all_overlays_to_blend.reserve(blend_overlays->size());
+        for (const auto &overlay : *blend_overlays)
         {
             if (!overlay->get_ready_to_blend())
             {
@@ -1187,25 +1639,60 @@ namespace osd
 
     media_library_return Blender::Impl::set_frame_size(int frame_width, int frame_height)
     {
-        std::unique_lock lock(m_mutex);
+        // The overlays are prepared for the new size as new instances off the lock, while the blends keep using the
+        // published ones. The overlays added or set meanwhile are prepared for the new size by themselves.
+        std::vector<OverlayImplPtr> overlays;
+        uint64_t frame_size_generation;
+        {
+            std::unique_lock lock(m_mutex);
+            m_frame_width = frame_width;
+            m_frame_height = frame_height;
+            m_frame_size_set = true;
+            frame_size_generation = ++m_frame_size_generation;
+            overlays.assign(m_prioritized_overlays.begin(), m_prioritized_overlays.end());
+        }
 
-        m_frame_width = frame_width;
-        m_frame_height = frame_height;
-        m_frame_size_set = true;
+        std::vector<std::pair<OverlayImplPtr, OverlayImplPtr>> resized_overlays;
+        resized_overlays.reserve(overlays.size());
+        for (const auto &overlay : overlays)
+        {
+            auto resized_expected = overlay->create_resized_overlay(frame_width, frame_height);
+            if (!resized_expected.has_value())
+            {
+                LOGGER__ERROR("Failed to prepare overlays ({})", resized_expected.error());
+                return resized_expected.error();
+            }
+            if (resized_expected.value() != nullptr)
+            {
+                resized_overlays.emplace_back(overlay, resized_expected.value());
+            }
+        }
 
-        // Initialize static images
-        std::vector<dsp_overlay_properties_t> overlays;
-        overlays.reserve(m_overlays.size());
-        for (const auto &overlay : m_prioritized_overlays)
+        std::unique_lock lock(m_mutex);
+        if (frame_size_generation != m_frame_size_generation)
         {
-            auto overlays_expected = overlay->create_dsp_overlays(frame_width, frame_height);
-            if (!overlays_expected.has_value())
+            // the overlays of the later frame size are published by its own call
+            return MEDIA_LIBRARY_SUCCESS;
+        }
+
+        media_library_return ret = MEDIA_LIBRARY_SUCCESS;
+        for (const auto &[overlay, resized_overlay] : resized_overlays)
+        {
+            // the overlays removed or set meanwhile are not brought back
+            auto current = m_overlays.find(overlay->get_id());
+            if (current == m_overlays.end() || current->second != overlay)
             {
-                LOGGER__ERROR("Failed to prepare overlays ({})", overlays_expected.error());
-                return overlays_expected.error();
+                continue;
+            }
+            media_library_return replace_ret = replace_overlay_internal(overlay, resized_overlay);
+            if (replace_ret != MEDIA_LIBRARY_SUCCESS)
+            {
+                ret = replace_ret;
             }
         }
 
-        return MEDIA_LIBRARY_SUCCESS;
+        // All the resized overlays are published in a single step
+        publish_overlays();
+        return ret;
     }
 }
\ No newline at end of file
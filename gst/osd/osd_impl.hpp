@@ -32,6 +32,12 @@
 #include <opencv2/core/utils/filesystem.hpp>
 #include <opencv2/freetype.hpp>
 #include <set>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include <functional>
@@ -42,12 +48,17 @@ using OverlayImplPtr = std::shared_ptr<OverlayImpl>;
 
 class OverlayImpl
 {
+    friend class DateTimeRenderer;
+
 public:
     OverlayImpl(std::string id, float x, float y, float width, float height, unsigned int z_index, unsigned int angle, osd::rotation_alignment_policy_t rotation_policy, bool ready_to_blend);
     virtual ~OverlayImpl();
 
     virtual tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> create_dsp_overlays(int frame_width, int frame_height);
     virtual tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> get_dsp_overlays();
+    // Returns an overlay of the same settings prepared for the frame size, leaving this one as is - it may be blended
+    // meanwhile. nullptr if the images of this overlay do not depend on the frame size.
+    virtual tl::expected<OverlayImplPtr, media_library_return> create_resized_overlay(int frame_width, int frame_height) = 0;
 
     bool operator<(const OverlayImpl &other);
 
@@ -59,6 +70,9 @@ public:
     std::string get_id() { return m_id; }
 
 protected:
+    // Copies the settings and the source image of other, not its DSP overlays
+    OverlayImpl(const OverlayImpl &other);
+    static tl::expected<OverlayImplPtr, media_library_return> prepare_overlay(OverlayImplPtr overlay, int frame_width, int frame_height);
     static tl::expected<std::tuple<int, int>, media_library_return> calc_xy_offsets(std::string id, float x_norm, float y_norm, int overlay_width, int overlay_height, int image_width, int image_height, int x_drift, int y_drift);
     static GstVideoFrame gst_video_frame_from_mat_bgra(cv::Mat mat);
     static media_library_return convert_2_dsp_video_frame(GstVideoFrame *src_frame, GstVideoFrame *dest_frame, GstVideoFormat dest_format);
@@ -95,6 +109,7 @@ public:
     virtual ~CustomOverlayImpl() = default;
 
     virtual tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> create_dsp_overlays(int frame_width, int frame_height);
+    virtual tl::expected<OverlayImplPtr, media_library_return> create_resized_overlay(int frame_width, int frame_height);
 
     virtual std::shared_ptr<osd::Overlay> get_metadata();
 };
@@ -111,6 +126,7 @@ public:
     virtual ~ImageOverlayImpl() = default;
 
     virtual tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> create_dsp_overlays(int frame_width, int frame_height);
+    virtual tl::expected<OverlayImplPtr, media_library_return> create_resized_overlay(int frame_width, int frame_height);
 
     virtual std::shared_ptr<osd::Overlay> get_metadata();
 
@@ -129,6 +145,7 @@ public:
     TextOverlayImpl(const osd::TextOverlay &overlay, media_library_return &status);
     virtual ~TextOverlayImpl() = default;
 
+    virtual tl::expected<OverlayImplPtr, media_library_return> create_resized_overlay(int frame_width, int frame_height);
     virtual std::shared_ptr<osd::Overlay> get_metadata();
 
 protected:
@@ -140,6 +157,71 @@ protected:
     std::string m_font_path;
 };
 
+// Timestamp rendered by DateTimeRenderer, in the DSP overlay format (A420)
+struct datetime_frame_t
+{
+    GstVideoFrame video_frame;
+    dsp_image_properties_t dsp_image;
+    // characters drawn in the frame, compared to the next timestamp to compose only the changed ones
+    std::string datetime;
+    bool mapped = false;
+
+    ~datetime_frame_t();
+};
+using DateTimeFramePtr = std::shared_ptr<datetime_frame_t>;
+
+class DateTimeRenderer;
+using DateTimeRendererPtr = std::shared_ptr<DateTimeRenderer>;
+
+class DateTimeRenderer
+{
+    /*
+    Timer service of the DateTime overlays of the process. The timestamp of the next second is composed from a glyph
+    atlas on a background thread and published at the second boundary, so that the frame path only loads a pointer.
+    Overlays of the same text color, font size and line thickness share a renderer.
+    */
+public:
+    static tl::expected<DateTimeRendererPtr, media_library_return> get_shared(const std::array<int, 3> &rgb_text_color, float font_size, int line_thickness);
+    DateTimeRenderer(const std::array<int, 3> &rgb_text_color, float font_size, int line_thickness, media_library_return &status);
+    ~DateTimeRenderer();
+
+    // Returns the timestamp of the current second. Not written to while it is referenced.
+    DateTimeFramePtr get_frame();
+    static size_t write_timestamp(char *buffer, size_t size, std::time_t time);
+
+private:
+    media_library_return create_glyph_atlas();
+    tl::expected<DateTimeFramePtr, media_library_return> acquire_frame();
+    media_library_return compose(datetime_frame_t &frame, std::time_t time);
+    void compose_glyph(datetime_frame_t &frame, size_t position, char glyph);
+    void timer_loop();
+
+    std::array<int, 3> m_rgb_text_color;
+    float m_font_size;
+    int m_line_thickness;
+    int m_width;
+    int m_height;
+    // Glyph atlas - the characters of the timestamp rendered once in the DSP overlay format, copied cell by cell
+    // into the timestamp frames as the time changes
+    GstVideoFrame m_glyph_atlas_frame;
+    bool m_glyph_atlas_ready;
+    // x of the cell of each character in the atlas (-1 if not in it), and its width
+    std::array<int, 256> m_glyph_atlas_x;
+    std::array<int, 256> m_glyph_width;
+    // x and width of the cell of each position of the timestamp
+    std::vector<int> m_cell_x;
+    std::vector<int> m_cell_width;
+    // Timestamp frames, reused once only this list references them - new ones are allocated only while overlays
+    // hold all of them
+    std::vector<DateTimeFramePtr> m_frames;
+    // Accessed with std::atomic_load/std::atomic_store
+    DateTimeFramePtr m_published_frame;
+    std::thread m_timer_thread;
+    std::mutex m_timer_mutex;
+    std::condition_variable m_timer_cv;
+    bool m_stop_timer;
+};
+
 class DateTimeOverlayImpl;
 using DateTimeOverlayImplPtr = std::shared_ptr<DateTimeOverlayImpl>;
 
@@ -152,21 +234,27 @@ public:
     static tl::expected<DateTimeOverlayImplPtr, media_library_return> create(const osd::DateTimeOverlay &overlay);
     static std::shared_future<tl::expected<DateTimeOverlayImplPtr, media_library_return>> create_async(const osd::DateTimeOverlay &overlay);
     DateTimeOverlayImpl(const osd::DateTimeOverlay &overlay, media_library_return &status);
-    virtual ~DateTimeOverlayImpl() = default;
+    virtual ~DateTimeOverlayImpl();
 
     virtual tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> get_dsp_overlays();
     virtual tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> create_dsp_overlays(int frame_width, int frame_height);
+    virtual tl::expected<OverlayImplPtr, media_library_return> create_resized_overlay(int frame_width, int frame_height);
     virtual std::shared_ptr<osd::Overlay> get_metadata();
 
     static std::string select_chars_for_timestamp();
 
 private:
+    tl::expected<std::vector<dsp_overlay_properties_t>, media_library_return> create_rotated_dsp_overlays(int frame_width, int frame_height);
+
     std::array<int, 3> m_rgb_text_color;
     float m_font_size;
     int m_line_thickness;
     std::string m_datetime_str;
     int m_frame_width;
     int m_frame_height;
+    DateTimeRendererPtr m_renderer;
+    // Timestamp of m_dsp_overlays, held until the next one is blended
+    DateTimeFramePtr m_datetime_frame;
 };
 
 namespace osd
@@ -212,13 +300,21 @@ namespace osd
         media_library_return add_overlay(const OverlayImplPtr overlay);
         media_library_return remove_overlay_internal(const std::string &id);
         media_library_return add_overlay_internal(const OverlayImplPtr overlay);
+        media_library_return replace_overlay_internal(const OverlayImplPtr previous_overlay, const OverlayImplPtr overlay);
 
         void initialize_overlay_images();
+        void publish_overlays();
 
         std::unordered_map<std::string, OverlayImplPtr> m_overlays;
         std::set<OverlayImplPtr> m_prioritized_overlays;
 
+        // Guards the overlays of the API and the frame size - blend() does not take it
         std::shared_mutex m_mutex;
+        // Overlays blended by blend(), in blend order. Replaced as a whole on each update and never modified once
+        // published, accessed with std::atomic_load/std::atomic_store
+        std::shared_ptr<const std::vector<OverlayImplPtr>> m_blend_overlays;
+        // Held by blend() for the whole blend - the DateTime overlays update their timestamp when blended
+        std::mutex m_blend_mutex;
 
         nlohmann::json m_config;
         std::shared_ptr<ConfigManager> m_config_manager;
@@ -226,6 +322,9 @@ namespace osd
         int m_frame_width;
         int m_frame_height;
         bool m_frame_size_set;
+        // Incremented by each set_frame_size(), so that the overlays it prepares off the lock are not published over
+        // the ones of a later frame size
+        uint64_t m_frame_size_generation;
     };
 
 }
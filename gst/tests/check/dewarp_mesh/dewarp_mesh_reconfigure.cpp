@@ -0,0 +1,136 @@
+#include "config_manager.hpp"
+#include "dewarp_mesh_context.hpp"
+#include <gst/check/check.h>
+#include <gst/check/gstcheck.h>
+#include <gst/gst.h>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Target only - the configuration and the sensor calibration it refers to are installed with the media library
+#define CONFIG_JSON_FILE_PATH "/home/root/apps/media_lib/resources/vision_config.json"
+#define NUM_VSMS 10
+
+// Dewarp with DIS, the meshes generated in on_frame_vsm_update() so that they follow the VSMs deterministically
+static pre_proc_op_configurations read_config()
+{
+    std::ifstream file(CONFIG_JSON_FILE_PATH);
+    fail_unless(file.good(), "missing " CONFIG_JSON_FILE_PATH ", the test runs on the target only");
+    std::stringstream config_string;
+    config_string << file.rdbuf();
+
+    ConfigManager config_manager(ConfigSchema::CONFIG_SCHEMA_VISION);
+    pre_proc_op_configurations config;
+    fail_unless_equals_int(config_manager.config_string_to_struct<pre_proc_op_configurations>(config_string.str(), config),
+                           MEDIA_LIBRARY_SUCCESS);
+    config.dewarp_config.enabled = true;
+    config.dis_config.enabled = true;
+    config.dis_config.background_mesh_generation = false;
+    return config;
+}
+
+static void generate_dis_meshes(DewarpMeshContext &mesh_ctx)
+{
+    for (int i = 0; i < NUM_VSMS; i++)
+    {
+        struct hailo15_vsm vsm = {};
+        vsm.dx = i % 3 - 1;
+        vsm.dy = i % 5 - 2;
+        fail_unless_equals_int(mesh_ctx.on_frame_vsm_update(vsm), MEDIA_LIBRARY_SUCCESS);
+    }
+}
+
+static void assert_same_mesh(DewarpMeshContext &mesh_ctx, DewarpMeshContext &expected_mesh_ctx)
+{
+    DspDewarpMeshPtr mesh = mesh_ctx.get();
+    DspDewarpMeshPtr expected_mesh = expected_mesh_ctx.get();
+    fail_unless(mesh != nullptr);
+    fail_unless(expected_mesh != nullptr);
+    fail_unless_equals_int(mesh->mesh_width, expected_mesh->mesh_width);
+    fail_unless_equals_int(mesh->mesh_height, expected_mesh->mesh_height);
+    fail_unless(memcmp(mesh->mesh_table, expected_mesh->mesh_table,
+                       mesh->mesh_width * mesh->mesh_height * 2 * sizeof(int32_t)) == 0,
+                "reconfigured context generated another mesh than a fresh one");
+}
+
+// Reconfigures a context which already generated meshes, and compares its meshes against a fresh context of the
+// new configuration fed with the same VSMs
+static void run_reconfigure(void (*reconfigure)(pre_proc_op_configurations &config))
+{
+    pre_proc_op_configurations config = read_config();
+    pre_proc_op_configurations new_config = config;
+    reconfigure(new_config);
+
+    // Generating a dewarp mesh advances DIS, so neither of the compared contexts should generate the dewarp mesh of
+    // the new configuration - they share it with this one
+    DewarpMeshContext shared_mesh_ctx(new_config);
+
+    DewarpMeshContext mesh_ctx(config);
+    generate_dis_meshes(mesh_ctx);
+    fail_unless_equals_int(mesh_ctx.configure(new_config), MEDIA_LIBRARY_SUCCESS);
+    generate_dis_meshes(mesh_ctx);
+
+    DewarpMeshContext expected_mesh_ctx(new_config);
+    generate_dis_meshes(expected_mesh_ctx);
+
+    assert_same_mesh(mesh_ctx, expected_mesh_ctx);
+}
+
+GST_START_TEST(test_reconfigure_camera_fov)
+{
+    run_reconfigure([](pre_proc_op_configurations &config) {
+        config.dewarp_config.camera_fov = config.dewarp_config.camera_fov > 0 ? config.dewarp_config.camera_fov * 0.8f : 80.0f;
+    });
+}
+
+GST_END_TEST;
+
+GST_START_TEST(test_reconfigure_fast_camera_model)
+{
+    run_reconfigure([](pre_proc_op_configurations &config) {
+        config.dis_config.fast_camera_model = !config.dis_config.fast_camera_model;
+    });
+}
+
+GST_END_TEST;
+
+GST_START_TEST(test_reconfigure_optical_zoom)
+{
+    run_reconfigure([](pre_proc_op_configurations &config) {
+        config.optical_zoom_config.enabled = true;
+        config.optical_zoom_config.magnification = 2.0f;
+    });
+}
+
+GST_END_TEST;
+
+GST_START_TEST(test_reconfigure_stabilization)
+{
+    run_reconfigure([](pre_proc_op_configurations &config) {
+        config.dis_config.std_multiplier *= 2;
+    });
+}
+
+GST_END_TEST;
+
+// Suite definition to allow to run a group of test and allow for further control
+// Of what test to run
+static Suite *
+dewarp_mesh_reconfigure_suite(void)
+{
+    Suite *s = suite_create("dewarp_mesh_reconfigure");
+    TCase *tc_chain = tcase_create("dewarp_mesh_reconfigure_test");
+
+    suite_add_tcase(s, tc_chain);
+    tcase_add_test(tc_chain, test_reconfigure_camera_fov);
+    tcase_add_test(tc_chain, test_reconfigure_fast_camera_model);
+    tcase_add_test(tc_chain, test_reconfigure_optical_zoom);
+    tcase_add_test(tc_chain, test_reconfigure_stabilization);
+
+    return s;
+}
+
+// Defines what suite to run as part of the normal calling
+GST_CHECK_MAIN(dewarp_mesh_reconfigure);
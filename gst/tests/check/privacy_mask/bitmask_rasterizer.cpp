@@ -0,0 +1,327 @@
+#include "bitmask_rasterizer.hpp"
+#include <gst/check/check.h>
+#include <gst/check/gstcheck.h>
+#include <gst/gst.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+// Bitmask of a frame, its rows padded to the 64 bit words the rasterizer writes
+struct test_bitmask_t
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_line;
+    std::vector<uint8_t> data;
+};
+
+static test_bitmask_t create_bitmask(uint32_t width, uint32_t height, uint8_t value = 0x00)
+{
+    uint32_t bytes_per_line = (width + 63) / 64 * 8;
+    return {width, height, bytes_per_line, std::vector<uint8_t>(bytes_per_line * height, value)};
+}
+
+static bool get_pixel(const test_bitmask_t &bitmask, uint32_t x, uint32_t y)
+{
+    return bitmask.data[y * bitmask.bytes_per_line + x / 8] & (0x80 >> (x % 8));
+}
+
+static void set_pixel(test_bitmask_t &bitmask, uint32_t x, uint32_t y, bool value)
+{
+    uint8_t &byte = bitmask.data[y * bitmask.bytes_per_line + x / 8];
+    byte = value ? byte | (0x80 >> (x % 8)) : byte & ~(0x80 >> (x % 8));
+}
+
+static roi_t full_frame(const test_bitmask_t &bitmask)
+{
+    return {0, 0, bitmask.width, bitmask.height};
+}
+
+// Reference of the fill rule, pixel by pixel - the center of the pixel is inside by the even-odd rule, counting the
+// edges which cross its row at or left of the center, so that a center on a left edge is inside and on a right edge
+// is outside
+static bool pixel_in_polygon(const std::vector<bitmask_point_t> &points, int64_t x, int64_t y)
+{
+    bool inside = false;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        bitmask_point_t top = points[i];
+        bitmask_point_t bottom = points[(i + 1) % points.size()];
+        if (top.y > bottom.y)
+            std::swap(top, bottom);
+        // the row center y + 0.5 is between the vertices
+        if (y < top.y || y >= bottom.y)
+            continue;
+        // x + 0.5 >= top.x + (y + 0.5 - top.y) * dx / dy
+        int64_t dx = bottom.x - top.x;
+        int64_t dy = bottom.y - top.y;
+        if ((2 * x + 1) * dy >= 2 * top.x * dy + (2 * (y - top.y) + 1) * dx)
+            inside = !inside;
+    }
+    return inside;
+}
+
+static void draw_reference(test_bitmask_t &bitmask, const std::vector<bitmask_point_t> &points, const roi_t &clip)
+{
+    for (uint32_t y = clip.y; y < clip.y + clip.height; y++)
+        for (uint32_t x = clip.x; x < clip.x + clip.width; x++)
+            if (pixel_in_polygon(points, x, y))
+                set_pixel(bitmask, x, y, true);
+}
+
+static void draw_polygons(test_bitmask_t &bitmask, const std::vector<std::vector<bitmask_point_t>> &polygons, const roi_t &clip)
+{
+    for (const auto &points : polygons)
+        fill_polygon_bitmask(points, clip, bitmask.data.data(), bitmask.bytes_per_line);
+}
+
+static void assert_same_bitmask(const test_bitmask_t &bitmask, const test_bitmask_t &expected)
+{
+    for (uint32_t y = 0; y < expected.height; y++)
+    {
+        for (uint32_t x = 0; x < expected.width; x++)
+        {
+            fail_unless(get_pixel(bitmask, x, y) == get_pixel(expected, x, y), "pixel (%u, %u) is %d, expected %d", x, y,
+                        get_pixel(bitmask, x, y), get_pixel(expected, x, y));
+        }
+    }
+    // the padding of the rows is never written
+    fail_unless(bitmask.data == expected.data, "the padding of the bitmask rows changed");
+}
+
+// Vertices of a rectangle of the given size rotated around its center, rounded to pixels
+static std::vector<bitmask_point_t> rotated_rect(double center_x, double center_y, double width, double height, double angle)
+{
+    double radians = angle * M_PI / 180.0;
+    double cos_angle = std::cos(radians);
+    double sin_angle = std::sin(radians);
+    std::vector<bitmask_point_t> points;
+    for (auto [corner_x, corner_y] : {std::pair{-0.5, -0.5}, std::pair{0.5, -0.5}, std::pair{0.5, 0.5}, std::pair{-0.5, 0.5}})
+    {
+        double x = corner_x * width;
+        double y = corner_y * height;
+        points.push_back({static_cast<int>(std::lround(center_x + x * cos_angle - y * sin_angle)),
+                          static_cast<int>(std::lround(center_y + x * sin_angle + y * cos_angle))});
+    }
+    return points;
+}
+
+// Rectangle of the pixels a polygon may set, clipped to the frame
+static roi_t polygon_bounds(const std::vector<bitmask_point_t> &points, const test_bitmask_t &bitmask)
+{
+    int x_min = bitmask.width, y_min = bitmask.height, x_max = 0, y_max = 0;
+    for (const bitmask_point_t &point : points)
+    {
+        x_min = std::min(x_min, std::max(point.x, 0));
+        y_min = std::min(y_min, std::max(point.y, 0));
+        x_max = std::max(x_max, std::min(point.x, static_cast<int>(bitmask.width)));
+        y_max = std::max(y_max, std::min(point.y, static_cast<int>(bitmask.height)));
+    }
+    if (x_max <= x_min || y_max <= y_min)
+        return {0, 0, 0, 0};
+    return {static_cast<uint32_t>(x_min), static_cast<uint32_t>(y_min), static_cast<uint32_t>(x_max - x_min),
+            static_cast<uint32_t>(y_max - y_min)};
+}
+
+static roi_t rect_union(const roi_t &a, const roi_t &b)
+{
+    if (a.width == 0 || a.height == 0)
+        return b;
+    if (b.width == 0 || b.height == 0)
+        return a;
+    uint32_t x = std::min(a.x, b.x);
+    uint32_t y = std::min(a.y, b.y);
+    return {x, y, std::max(a.x + a.width, b.x + b.width) - x, std::max(a.y + a.height, b.y + b.height) - y};
+}
+
+GST_START_TEST(test_polygon_clipped_at_frame_edges)
+{
+    // Crossing the left and top edges, the right and bottom edges, and all of them
+    std::vector<std::vector<bitmask_point_t>> polygons = {
+        {{-50, -30}, {150, 10}, {20, 200}},
+        {{150, 60}, {260, 100}, {180, 170}, {120, 90}},
+        {{-20, 60}, {100, -40}, {230, 60}, {100, 160}},
+    };
+    test_bitmask_t reference_frame = create_bitmask(203, 117);
+    for (const roi_t &clip : {full_frame(reference_frame), roi_t{37, 21, 90, 50}, roi_t{0, 0, 1, 117}, roi_t{202, 0, 1, 117}})
+    {
+        for (const auto &points : polygons)
+        {
+            test_bitmask_t bitmask = create_bitmask(203, 117);
+            test_bitmask_t expected = create_bitmask(203, 117);
+            fill_polygon_bitmask(points, clip, bitmask.data.data(), bitmask.bytes_per_line);
+            draw_reference(expected, points, clip);
+            assert_same_bitmask(bitmask, expected);
+        }
+    }
+}
+
+GST_END_TEST;
+
+GST_START_TEST(test_rects_unaligned)
+{
+    const uint32_t width = 333;
+    const uint32_t height = 3;
+    for (uint32_t x : {0, 1, 7, 8, 63, 64, 65, 127, 200, 269, 332})
+    {
+        for (uint32_t rect_width : {1, 2, 57, 63, 64, 65, 130, 333})
+        {
+            if (x + rect_width > width)
+                continue;
+            roi_t rect = {x, 1, rect_width, 2};
+
+            test_bitmask_t bitmask = create_bitmask(width, height);
+            test_bitmask_t expected = create_bitmask(width, height);
+            fill_bitmask_rect(bitmask.data.data(), bitmask.bytes_per_line, rect);
+            for (uint32_t y = rect.y; y < rect.y + rect.height; y++)
+                for (uint32_t i = rect.x; i < rect.x + rect.width; i++)
+                    set_pixel(expected, i, y, true);
+            assert_same_bitmask(bitmask, expected);
+
+            bitmask = create_bitmask(width, height, 0xFF);
+            expected = create_bitmask(width, height, 0xFF);
+            clear_bitmask_rect(bitmask.data.data(), bitmask.bytes_per_line, rect);
+            for (uint32_t y = rect.y; y < rect.y + rect.height; y++)
+                for (uint32_t i = rect.x; i < rect.x + rect.width; i++)
+                    set_pixel(expected, i, y, false);
+            assert_same_bitmask(bitmask, expected);
+        }
+    }
+}
+
+GST_END_TEST;
+
+GST_START_TEST(test_spans_unaligned)
+{
+    // Every span of a row of three words, with bits already set around it
+    const uint32_t width = 192;
+    for (uint32_t x_start = 0; x_start <= width; x_start++)
+    {
+        for (uint32_t x_end = x_start; x_end <= width; x_end++)
+        {
+            test_bitmask_t bitmask = create_bitmask(width, 1);
+            set_pixel(bitmask, x_start / 2, 0, true);
+            test_bitmask_t expected = bitmask;
+            fill_bitmask_span(bitmask.data.data(), x_start, x_end);
+            for (uint32_t x = x_start; x < x_end; x++)
+                set_pixel(expected, x, 0, true);
+            fail_unless(bitmask.data == expected.data, "span [%u, %u) set other pixels", x_start, x_end);
+        }
+    }
+}
+
+GST_END_TEST;
+
+GST_START_TEST(test_polygon_fill_rule)
+{
+    // A rectangle sets exactly the pixels from its top left corner to before its bottom right one
+    test_bitmask_t bitmask = create_bitmask(96, 64);
+    test_bitmask_t expected = create_bitmask(96, 64);
+    fill_polygon_bitmask({{10, 5}, {50, 5}, {50, 25}, {10, 25}}, full_frame(bitmask), bitmask.data.data(), bitmask.bytes_per_line);
+    for (uint32_t y = 5; y < 25; y++)
+        for (uint32_t x = 10; x < 50; x++)
+            set_pixel(expected, x, y, true);
+    assert_same_bitmask(bitmask, expected);
+
+    // Polygons sharing an edge set each pixel of their union exactly once - split vertically, diagonally, and through
+    // pixel centers
+    std::vector<std::pair<std::vector<bitmask_point_t>, std::vector<bitmask_point_t>>> splits = {
+        {{{0, 0}, {33, 0}, {33, 64}, {0, 64}}, {{33, 0}, {96, 0}, {96, 64}, {33, 64}}},
+        {{{0, 0}, {96, 0}, {96, 50}, {0, 7}}, {{0, 7}, {96, 50}, {96, 64}, {0, 64}}},
+        {{{0, 0}, {64, 0}, {0, 64}}, {{64, 0}, {96, 0}, {96, 64}, {0, 64}}},
+    };
+    for (const auto &[first, second] : splits)
+    {
+        test_bitmask_t first_bitmask = create_bitmask(96, 64);
+        test_bitmask_t second_bitmask = create_bitmask(96, 64);
+        fill_polygon_bitmask(first, full_frame(first_bitmask), first_bitmask.data.data(), first_bitmask.bytes_per_line);
+        fill_polygon_bitmask(second, full_frame(second_bitmask), second_bitmask.data.data(), second_bitmask.bytes_per_line);
+        for (uint32_t y = 0; y < 64; y++)
+        {
+            for (uint32_t x = 0; x < 96; x++)
+            {
+                fail_unless(get_pixel(first_bitmask, x, y) != get_pixel(second_bitmask, x, y),
+                            "pixel (%u, %u) is set by %s of the adjacent polygons", x, y,
+                            get_pixel(first_bitmask, x, y) ? "both" : "none");
+            }
+        }
+    }
+}
+
+GST_END_TEST;
+
+GST_START_TEST(test_rotated_polygons)
+{
+    for (int angle = 0; angle < 360; angle += 15)
+    {
+        // Inside the frame, and partly out of it at its corner
+        for (auto [center_x, center_y] : {std::pair{160.0, 90.0}, std::pair{300.0, 170.0}})
+        {
+            test_bitmask_t bitmask = create_bitmask(317, 181);
+            test_bitmask_t expected = create_bitmask(317, 181);
+            std::vector<bitmask_point_t> points = rotated_rect(center_x, center_y, 121, 43, angle + 0.5);
+            fill_polygon_bitmask(points, full_frame(bitmask), bitmask.data.data(), bitmask.bytes_per_line);
+            draw_reference(expected, points, full_frame(expected));
+            assert_same_bitmask(bitmask, expected);
+        }
+    }
+}
+
+GST_END_TEST;
+
+GST_START_TEST(test_dirty_rect_redraw)
+{
+    std::vector<std::vector<bitmask_point_t>> polygons = {
+        rotated_rect(80, 60, 90, 30, 20),
+        rotated_rect(150, 100, 60, 60, 45),
+        {{200, 20}, {300, 40}, {260, 150}},
+        {{-10, 150}, {70, 130}, {90, 190}},
+    };
+    test_bitmask_t bitmask = create_bitmask(317, 181);
+    draw_polygons(bitmask, polygons, full_frame(bitmask));
+
+    // Move and reshape the polygons one by one, redrawing only the rectangle covering the previous and the new one
+    std::vector<std::vector<bitmask_point_t>> moved_polygons = {
+        rotated_rect(91, 67, 90, 30, 35),
+        rotated_rect(170, 80, 70, 50, 10),
+        {{190, 25}, {301, 61}, {250, 170}, {230, 90}},
+        {{-30, 140}, {100, 120}, {80, 200}},
+    };
+    for (size_t i = 0; i < polygons.size(); i++)
+    {
+        roi_t dirty_rect = rect_union(polygon_bounds(polygons[i], bitmask), polygon_bounds(moved_polygons[i], bitmask));
+        polygons[i] = moved_polygons[i];
+        clear_bitmask_rect(bitmask.data.data(), bitmask.bytes_per_line, dirty_rect);
+        draw_polygons(bitmask, polygons, dirty_rect);
+
+        test_bitmask_t expected = create_bitmask(317, 181);
+        draw_polygons(expected, polygons, full_frame(expected));
+        assert_same_bitmask(bitmask, expected);
+    }
+}
+
+GST_END_TEST;
+
+// Suite definition to allow to run a group of test and allow for further control
+// Of what test to run
+static Suite *
+bitmask_rasterizer_suite(void)
+{
+    Suite *s = suite_create("bitmask_rasterizer");
+    TCase *tc_chain = tcase_create("bitmask_rasterizer_test");
+
+    suite_add_tcase(s, tc_chain);
+    tcase_add_test(tc_chain, test_polygon_clipped_at_frame_edges);
+    tcase_add_test(tc_chain, test_rects_unaligned);
+    tcase_add_test(tc_chain, test_spans_unaligned);
+    tcase_add_test(tc_chain, test_polygon_fill_rule);
+    tcase_add_test(tc_chain, test_rotated_polygons);
+    tcase_add_test(tc_chain, test_dirty_rect_redraw);
+
+    return s;
+}
+
+// Defines what suite to run as part of the normal calling
+GST_CHECK_MAIN(bitmask_rasterizer);
@@ -0,0 +1,103 @@
+#include "polygon_math.hpp"
+#include <gst/check/check.h>
+#include <gst/check/gstcheck.h>
+#include <gst/gst.h>
+#include <cstdint>
+#include <vector>
+
+#define FRAME_WIDTH 3840
+#define FRAME_HEIGHT 2160
+
+// Deterministic pseudo random boxes inside the frame, of 8 to 263 pixels
+static std::vector<roi_t> create_boxes(size_t count, uint32_t seed)
+{
+    uint32_t state = seed;
+    auto next = [&state](uint32_t range)
+    {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) % range;
+    };
+
+    std::vector<roi_t> boxes;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t width = 8 + next(256);
+        uint32_t height = 8 + next(256);
+        boxes.push_back({next(FRAME_WIDTH - width), next(FRAME_HEIGHT - height), width, height});
+    }
+    return boxes;
+}
+
+static bool roi_contains(const roi_t &roi, const roi_t &box)
+{
+    return box.x >= roi.x && box.y >= roi.y && box.x + box.width <= roi.x + roi.width &&
+           box.y + box.height <= roi.y + roi.height;
+}
+
+static void assert_boxes_covered(const std::vector<roi_t> &boxes)
+{
+    roi_t rois[MAX_NUM_OF_PRIVACY_MASK_ROIS];
+    uint rois_count = cluster_privacy_mask_rois(boxes, rois, MAX_NUM_OF_PRIVACY_MASK_ROIS);
+    fail_unless(rois_count <= MAX_NUM_OF_PRIVACY_MASK_ROIS, "%u rois for %zu masks", rois_count, boxes.size());
+
+    for (size_t i = 0; i < boxes.size(); i++)
+    {
+        bool covered = false;
+        for (uint j = 0; j < rois_count && !covered; j++)
+            covered = roi_contains(rois[j], boxes[i]);
+        fail_unless(covered, "mask %zu is not inside any of the %u rois", i, rois_count);
+    }
+}
+
+GST_START_TEST(test_max_masks_clustered)
+{
+    for (uint32_t seed = 1; seed <= 8; seed++)
+    {
+        assert_boxes_covered(create_boxes(MAX_NUM_OF_PRIVACY_MASKS, seed));
+    }
+
+    // Overlapping and identical masks
+    std::vector<roi_t> boxes;
+    for (size_t i = 0; i < MAX_NUM_OF_PRIVACY_MASKS; i++)
+    {
+        boxes.push_back({static_cast<uint32_t>(100 + (i % 16) * 10), static_cast<uint32_t>(100 + (i / 16) % 4 * 10), 64, 64});
+    }
+    assert_boxes_covered(boxes);
+}
+
+GST_END_TEST;
+
+GST_START_TEST(test_few_masks_not_merged)
+{
+    for (size_t count = 0; count <= MAX_NUM_OF_PRIVACY_MASK_ROIS; count++)
+    {
+        std::vector<roi_t> boxes = create_boxes(count, count + 1);
+        roi_t rois[MAX_NUM_OF_PRIVACY_MASK_ROIS];
+        uint rois_count = cluster_privacy_mask_rois(boxes, rois, MAX_NUM_OF_PRIVACY_MASK_ROIS);
+        fail_unless_equals_int(rois_count, count);
+        for (size_t i = 0; i < count; i++)
+        {
+            fail_unless(rois[i] == boxes[i], "mask %zu of %zu was merged", i, count);
+        }
+    }
+}
+
+GST_END_TEST;
+
+// Suite definition to allow to run a group of test and allow for further control
+// Of what test to run
+static Suite *
+privacy_mask_rois_suite(void)
+{
+    Suite *s = suite_create("privacy_mask_rois");
+    TCase *tc_chain = tcase_create("privacy_mask_rois_test");
+
+    suite_add_tcase(s, tc_chain);
+    tcase_add_test(tc_chain, test_max_masks_clustered);
+    tcase_add_test(tc_chain, test_few_masks_not_merged);
+
+    return s;
+}
+
+// Defines what suite to run as part of the normal calling
+GST_CHECK_MAIN(privacy_mask_rois);
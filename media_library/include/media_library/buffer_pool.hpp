@@ -32,10 +32,12 @@
 #include <mutex>
 #include <stdint.h>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "dsp_utils.hpp"
+#include "frame_latency.hpp"
 #include "media_library_types.hpp"
 #include "hailo_v4l2/hailo_vsm.h"
 
@@ -100,7 +102,10 @@ private:
     uint m_height;
     uint m_bytes_per_line;
     dsp_image_format_t m_format;
+    bool m_planar;
     std::shared_ptr<std::mutex> m_buffer_pool_mutex;
+    // Content tags of the buffers, by the address of their first plane
+    std::unordered_map<intptr_t, uint64_t> m_buffer_tags;
 
 public:
     /**
@@ -123,10 +128,13 @@ public:
      * @param[in] max_buffers - number of buffers to allocate
      * @param[in] memory_type - memory type
      * @param[in] bytes_per_line - bytes per line if the buffer stride is padded (when padding=0, bytes_per_line=width)
+     * @param[in] planar - for RGB format, allocate three separate R, G and B planes instead of packed pixels
      */
     MediaLibraryBufferPool(uint width, uint height, dsp_image_format_t format,
-                           size_t max_buffers, HailoMemoryType memory_type, uint bytes_per_line);
+                           size_t max_buffers, HailoMemoryType memory_type, uint bytes_per_line,
+                           bool planar = false);
     ~MediaLibraryBufferPool();
+
     // Copy constructor - delete
     MediaLibraryBufferPool(const MediaLibraryBufferPool &) = delete;
     // Copy assignment - delete
@@ -185,6 +193,28 @@ public:
      * @return The height of the buffer pool as an unsigned integer.
      */
     uint get_height() { return m_height; }
+    /**
+     * @brief Gets the number of buffers that can currently be acquired from the pool.
+     *
+     * @return The number of free buffers, buffers held by consumers are not counted.
+     */
+    size_t get_available_buffers_count();
+    /**
+     * @brief Gets the content tag of a buffer of the pool.
+     * A tag identifies content which stays in a buffer across acquisitions (e.g. a letterbox padding).
+     * A user relying on such content checks the tag, and a user overwriting the buffer sets its own tag, or 0.
+     *
+     * @param[in] buffer - a buffer acquired from the pool
+     * @return The tag last set for the buffer, 0 if none.
+     */
+    uint64_t get_buffer_tag(const hailo_media_library_buffer &buffer);
+    /**
+     * @brief Sets the content tag of a buffer of the pool.
+     *
+     * @param[in] buffer - a buffer acquired from the pool
+     * @param[in] tag - the tag, 0 for content that is not kept
+     */
+    void set_buffer_tag(const hailo_media_library_buffer &buffer, uint64_t tag);
 };
 
 struct hailo_media_library_buffer
@@ -240,11 +270,20 @@ public:
     struct hailo15_vsm vsm;
     int32_t isp_ae_fps;
     int32_t video_fd;
+    // Region of the buffer holding image content, the rest is padding (e.g. letterbox)
+    roi_t content_roi;
+    // Region of the source frame that the content was resized from
+    roi_t source_roi;
+    // Time spent by the frame in each stage of the pipeline
+    frame_latency_record_t latency;
+    // Rectangles to mask in this frame only (e.g. detected faces), in frame pixels - see PrivacyMaskBlender::blend
+    std::vector<roi_t> privacy_mask_rects;
 
     hailo_media_library_buffer()
         : m_buffer_mutex(std::make_shared<std::mutex>()),
           m_plane_mutex(std::make_shared<std::mutex>()),
-          hailo_pix_buffer(nullptr), owner(nullptr), isp_ae_fps(-1), video_fd(-1)
+          hailo_pix_buffer(nullptr), owner(nullptr), isp_ae_fps(-1), video_fd(-1),
+          content_roi{0, 0, 0, 0}, source_roi{0, 0, 0, 0}, latency{}
     {
         vsm.dx = 0;
         vsm.dy = 0;
@@ -260,11 +299,16 @@ public:
         vsm = other.vsm;
         isp_ae_fps = other.isp_ae_fps;
         video_fd = other.video_fd;
+        content_roi = other.content_roi;
+        source_roi = other.source_roi;
+        latency = other.latency;
+        privacy_mask_rects = std::move(other.privacy_mask_rects);
         other.hailo_pix_buffer = nullptr;
         other.owner = nullptr;
         other.m_buffer_mutex = nullptr;
         other.m_plane_mutex = nullptr;
         other.planes_reference_count.clear();
+        other.privacy_mask_rects.clear();
         other.isp_ae_fps = -1;
         other.video_fd = -1;
         other.vsm.dx = 0;
@@ -285,11 +329,16 @@ public:
             vsm = other.vsm;
             isp_ae_fps = other.isp_ae_fps;
             video_fd = other.video_fd;
+            content_roi = other.content_roi;
+            source_roi = other.source_roi;
+            latency = other.latency;
+            privacy_mask_rects = std::move(other.privacy_mask_rects);
             other.hailo_pix_buffer = nullptr;
             other.owner = nullptr;
             other.m_buffer_mutex = nullptr;
             other.m_plane_mutex = nullptr;
             other.planes_reference_count.clear();
+            other.privacy_mask_rects.clear();
             other.isp_ae_fps = -1;
             other.video_fd = -1;
             other.vsm.dx = 0;
@@ -32,6 +32,7 @@
 #include <algorithm>
 #include <math.h>
 #include <climits>
+#include <stdint.h>
 
 /**
  * @enum camera_type_t
@@ -160,6 +161,39 @@ struct dis_config_t
      */
     float black_corners_threshold;
 
+    /**
+     * Use lookup tables and polynomial approximations instead of the exact camera model functions (binary search,
+     * atan2, tan) when generating the grids. Faster, with an error well below 1/100 pixel.
+     * Optional in the configuration, default false.
+     */
+    bool fast_camera_model;
+
+    /**
+     * If the stabilizing rotation moved less than this since the grid was last updated, the grid is reused as is.
+     * In pixels of the input image near the optical center, >= 0. 0 disables it.
+     * Optional in the configuration, default 0.
+     */
+    float mesh_reuse_threshold;
+
+    /**
+     * If the stabilizing rotation moved less than this since the grid was last fully generated, the grid is
+     * updated by a first order correction instead of being projected again. The per vertex derivatives wrt the
+     * rotation come from the last three fully generated grids, so the correction is used only once those were
+     * generated close to each other and not along a single line.
+     * In pixels of the input image near the optical center, >= 0. 0 disables it.
+     * Optional in the configuration, default 0.
+     */
+    float mesh_correction_threshold;
+
+    /**
+     * Generate the DIS mesh of a frame in the background instead of before its dewarp. The frame is then dewarped
+     * with the mesh of the previous frames' motion - one frame of stabilization lag - while the dewarp does not wait
+     * for the mesh generation. The frames which arrive while a mesh is generated advance the stabilization without
+     * a mesh of their own.
+     * Optional in the configuration, default false.
+     */
+    bool background_mesh_generation;
+
     // Debug
     dis_debug_config_t debug;
 };
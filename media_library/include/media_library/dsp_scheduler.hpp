@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file dsp_scheduler.hpp
+ * @brief MediaLibrary DSP scheduler CPP API module
+ **/
+
+#pragma once
+
+#include "frame_latency.hpp"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** @defgroup dsp_scheduler_definitions MediaLibrary DSP scheduler CPP API
+ * definitions
+ *  @{
+ */
+
+/**
+  Process wide arbitration of the DSP between the sensors of a multi-sensor front end.
+  Modules submitting DSP jobs on behalf of a sensor register the sensor with its framerate, and
+  wrap every job with begin_job() and end_job(). Modules of the same sensor
+  register under the same name, and share its statistics. Modules whose configuration names no
+  sensor (no "input_stream.source") register the same default sensor.
+  While a single sensor is registered, jobs are not arbitrated. Once more sensors are registered,
+  jobs run one at a time, earliest deadline first, where the deadline of a job is the time the
+  next frame of its sensor is due. Dewarp and resize jobs of all the sensors are interleaved this
+  way, and every sensor keeps its framerate as long as the DSP is not over committed.
+*/
+namespace dsp_scheduler
+{
+  typedef int32_t sensor_id_t;
+  static constexpr sensor_id_t invalid_sensor_id = -1;
+
+  /**
+    Per sensor DSP statistics
+  */
+  typedef struct
+  {
+    std::string sensor;
+    uint32_t framerate;
+    uint64_t jobs;
+    // jobs that ended after the next frame of the sensor was due
+    uint64_t deadline_misses;
+    // frames dropped by the modules of the sensor, e.g. when an output buffer pool is exhausted
+    uint64_t dropped_frames;
+    // time from requesting the DSP until the job started
+    frame_latency_histogram_t wait;
+    // time the job held the DSP
+    frame_latency_histogram_t service;
+  } sensor_stats_t;
+
+  /**
+    A job in progress, returned by begin_job() and handed back to end_job()
+  */
+  typedef struct
+  {
+    sensor_id_t sensor_id;
+    uint64_t request_ns;
+    uint64_t start_ns;
+    uint64_t deadline_ns;
+  } job_t;
+
+  sensor_id_t register_sensor(const std::string &sensor, uint32_t framerate);
+  void unregister_sensor(sensor_id_t sensor_id);
+  job_t begin_job(sensor_id_t sensor_id);
+  void end_job(const job_t &job);
+  void record_dropped_frame(sensor_id_t sensor_id);
+  std::vector<sensor_stats_t> get_sensors_stats();
+} // namespace dsp_scheduler
+
+/** @} */ // end of dsp_scheduler_definitions
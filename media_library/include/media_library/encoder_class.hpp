@@ -45,6 +45,8 @@ public:
     void update_stride(uint32_t stride);
     std::shared_ptr<EncoderConfig> get_config();
     std::vector<EncoderOutputBuffer> handle_frame(HailoMediaLibraryBufferPtr buf);
+    // Latency histograms of the frames encoded so far, per pipeline stage and end to end
+    frame_latency_stats_t get_latency_stats();
     EncoderOutputBuffer start();
     EncoderOutputBuffer stop();
 
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file frame_latency.hpp
+ * @brief MediaLibrary per-frame stage latency definitions
+ **/
+
+#pragma once
+#include <climits>
+#include <stdint.h>
+#include <time.h>
+
+/** @defgroup frame_latency_definitions MediaLibrary Frame Latency CPP API definitions
+ *  @{
+ */
+
+enum frame_latency_stage_t
+{
+    FRAME_LATENCY_STAGE_VISION_PRE_PROC = 0,
+    FRAME_LATENCY_STAGE_DEWARP,
+    FRAME_LATENCY_STAGE_DENOISE,
+    FRAME_LATENCY_STAGE_MULTI_RESIZE,
+    FRAME_LATENCY_STAGE_OSD_BLEND,
+    FRAME_LATENCY_STAGE_ENCODE,
+
+    /** Number of stages, used for sizing the latency records */
+    FRAME_LATENCY_STAGE_COUNT,
+
+    /** Max enum value to maintain ABI Integrity */
+    FRAME_LATENCY_STAGE_MAX = INT_MAX
+};
+
+/**
+ * @brief Fixed size record of the time a frame spent in each stage.
+ * Timestamps are CLOCK_MONOTONIC nanoseconds, 0 means the stage was not visited.
+ * The record is copied from the input frame to the output frames of every stage, so it
+ * follows the frame through the pipeline without any allocation.
+ */
+struct frame_latency_record_t
+{
+    // Time the frame entered the media library
+    uint64_t ingress_ns;
+    uint64_t stage_start_ns[FRAME_LATENCY_STAGE_COUNT];
+    uint64_t stage_end_ns[FRAME_LATENCY_STAGE_COUNT];
+
+    static uint64_t now_ns()
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    }
+
+    void reset()
+    {
+        *this = frame_latency_record_t{};
+    }
+
+    void stamp_ingress()
+    {
+        if (ingress_ns == 0)
+            ingress_ns = now_ns();
+    }
+
+    void stamp_start(frame_latency_stage_t stage)
+    {
+        stage_start_ns[stage] = now_ns();
+        if (ingress_ns == 0)
+            ingress_ns = stage_start_ns[stage];
+    }
+
+    void stamp_end(frame_latency_stage_t stage)
+    {
+        stage_end_ns[stage] = now_ns();
+    }
+
+    uint64_t stage_duration_ns(frame_latency_stage_t stage) const
+    {
+        if (stage_start_ns[stage] == 0 || stage_end_ns[stage] < stage_start_ns[stage])
+            return 0;
+        return stage_end_ns[stage] - stage_start_ns[stage];
+    }
+
+    // Time from ingress to the end of the given stage
+    uint64_t latency_until_ns(frame_latency_stage_t stage) const
+    {
+        if (ingress_ns == 0 || stage_end_ns[stage] < ingress_ns)
+            return 0;
+        return stage_end_ns[stage] - ingress_ns;
+    }
+};
+
+// Bucket i of a latency histogram counts latencies below (FRAME_LATENCY_HISTOGRAM_BASE_NS << i)
+#define FRAME_LATENCY_HISTOGRAM_BUCKETS (16)
+#define FRAME_LATENCY_HISTOGRAM_BASE_NS (250000ULL)
+
+/**
+ * @brief Log scale histogram of latencies, from 250us up to ~8s (the last bucket is unbounded).
+ */
+struct frame_latency_histogram_t
+{
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t buckets[FRAME_LATENCY_HISTOGRAM_BUCKETS];
+
+    void add(uint64_t latency_ns)
+    {
+        uint32_t bucket = 0;
+        while (bucket < FRAME_LATENCY_HISTOGRAM_BUCKETS - 1 && latency_ns >= (FRAME_LATENCY_HISTOGRAM_BASE_NS << bucket))
+            bucket++;
+        buckets[bucket]++;
+        count++;
+        total_ns += latency_ns;
+        if (latency_ns > max_ns)
+            max_ns = latency_ns;
+    }
+
+    uint64_t average_ns() const
+    {
+        return count == 0 ? 0 : total_ns / count;
+    }
+};
+
+/**
+ * @brief Latency histograms of a single stream - one per stage, and one from ingress to the
+ * end of the last stage the stream visits.
+ */
+struct frame_latency_stats_t
+{
+    frame_latency_histogram_t stages[FRAME_LATENCY_STAGE_COUNT];
+    frame_latency_histogram_t end_to_end;
+
+    void add(const frame_latency_record_t &record, frame_latency_stage_t last_stage)
+    {
+        for (int stage = 0; stage < FRAME_LATENCY_STAGE_COUNT; stage++)
+        {
+            if (record.stage_start_ns[stage] != 0)
+                stages[stage].add(record.stage_duration_ns((frame_latency_stage_t)stage));
+        }
+        if (record.ingress_ns != 0)
+            end_to_end.add(record.latency_until_ns(last_stage));
+    }
+};
+
+/** @} */ // end of frame_latency_definitions
@@ -28,6 +28,8 @@
 #pragma once
 #include "dis_common.h"
 #include "dsp_utils.hpp"
+#include <algorithm>
+#include <iterator>
 #include <string>
 
 /** @defgroup media_library_types_definitions MediaLibrary Types CPP API definitions
@@ -106,12 +108,86 @@ enum denoise_method_t
     DENOISE_METHOD_MAX = INT_MAX
 };
 
+enum scaling_mode_t
+{
+    SCALING_MODE_STRETCH = 0,   // Resize to the output dimensions, ignoring the aspect ratio
+    SCALING_MODE_LETTERBOX,     // Keep the aspect ratio, pad the remaining area with the pad color
+    SCALING_MODE_CROP_TO_FILL,  // Keep the aspect ratio, crop the source to the output aspect ratio
+
+    /** Max enum value to maintain ABI Integrity */
+    SCALING_MODE_MAX = INT_MAX
+};
+
+/*
+Color format of a multi-resize output. The DSP multi-resize writes only the format of the input frame,
+so RGB outputs are resized into an intermediate buffer of the output and then converted on the CPU.
+*/
+enum color_format_t
+{
+    COLOR_FORMAT_SOURCE = 0,   // Keep the format of the input frame
+    COLOR_FORMAT_RGB,          // Packed RGB, 3 bytes per pixel
+    COLOR_FORMAT_BGR,          // Packed BGR, 3 bytes per pixel
+    COLOR_FORMAT_RGB_PLANAR,   // Three separate R, G and B planes
+
+    /** Max enum value to maintain ABI Integrity */
+    COLOR_FORMAT_MAX = INT_MAX
+};
+
 struct roi_t
 {
     uint32_t x;
     uint32_t y;
     uint32_t width;
     uint32_t height;
+
+    bool operator==(const roi_t &other) const
+    {
+        return x == other.x && y == other.y && width == other.width && height == other.height;
+    }
+    bool operator!=(const roi_t &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+struct pad_color_t
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+
+    bool operator==(const pad_color_t &other) const
+    {
+        return r == other.r && g == other.g && b == other.b;
+    }
+};
+
+/*
+Per-channel normalization applied while converting to RGB: normalized = (in - mean) * scale.
+The normalized values are written quantized to 8 bits with a zero point, as in the input quantization
+of a network: out = round(normalized / quant_scale + quant_zero_point). The quantization must hold the
+normalized range of every channel within [0, 255] - normalizations which would clamp are rejected.
+Channels are always given in R, G, B order, regardless of the output color format.
+*/
+struct normalization_config_t
+{
+    bool enabled;
+    float mean[3];
+    float scale[3];
+    float quant_scale;
+    float quant_zero_point;
+
+    bool operator==(const normalization_config_t &other) const
+    {
+        return enabled == other.enabled &&
+               std::equal(std::begin(mean), std::end(mean), std::begin(other.mean)) &&
+               std::equal(std::begin(scale), std::end(scale), std::begin(other.scale)) &&
+               quant_scale == other.quant_scale && quant_zero_point == other.quant_zero_point;
+    }
+    bool operator!=(const normalization_config_t &other) const
+    {
+        return !(*this == other);
+    }
 };
 
 struct hailort_t
@@ -208,6 +284,10 @@ struct output_resolution_t
     uint32_t framerate;
     uint32_t pool_max_buffers;
     dsp_utils::crop_resize_dims_t dimensions;
+    scaling_mode_t scaling_mode = SCALING_MODE_STRETCH;
+    pad_color_t pad_color = {0, 0, 0};
+    color_format_t color_format = COLOR_FORMAT_SOURCE;
+    normalization_config_t normalization = {false, {0, 0, 0}, {1, 1, 1}, 1, 0};
     bool operator==(const output_resolution_t &other) const
     {
         return framerate == other.framerate && dimensions.destination_width == other.dimensions.destination_width && dimensions.destination_height == other.dimensions.destination_height;
@@ -230,6 +310,53 @@ struct output_resolution_t
             return dimensions.destination_width == other.dimensions.destination_height && dimensions.destination_height == other.dimensions.destination_width;
         return dimensions.destination_width == other.dimensions.destination_width && dimensions.destination_height == other.dimensions.destination_height;
     }
+    /*
+    Per-output crop region, in input frame coordinates. When perform_crop is set the output is
+    resized from this region instead of the shared (digital zoom) crop of the multi-resize element.
+    */
+    void set_crop_roi(const roi_t &roi)
+    {
+        dimensions.perform_crop = true;
+        dimensions.crop_start_x = roi.x;
+        dimensions.crop_start_y = roi.y;
+        dimensions.crop_end_x = roi.x + roi.width;
+        dimensions.crop_end_y = roi.y + roi.height;
+    }
+    void clear_crop_roi()
+    {
+        dimensions.perform_crop = false;
+        dimensions.crop_start_x = 0;
+        dimensions.crop_start_y = 0;
+        dimensions.crop_end_x = 0;
+        dimensions.crop_end_y = 0;
+    }
+    roi_t get_crop_roi() const
+    {
+        return roi_t{
+            .x = (uint32_t)dimensions.crop_start_x,
+            .y = (uint32_t)dimensions.crop_start_y,
+            .width = (uint32_t)(dimensions.crop_end_x - dimensions.crop_start_x),
+            .height = (uint32_t)(dimensions.crop_end_y - dimensions.crop_start_y),
+        };
+    }
+    void update_crop(const output_resolution_t &other)
+    {
+        dimensions.perform_crop = other.dimensions.perform_crop;
+        dimensions.crop_start_x = other.dimensions.crop_start_x;
+        dimensions.crop_start_y = other.dimensions.crop_start_y;
+        dimensions.crop_end_x = other.dimensions.crop_end_x;
+        dimensions.crop_end_y = other.dimensions.crop_end_y;
+    }
+    void update_scaling(const output_resolution_t &other)
+    {
+        scaling_mode = other.scaling_mode;
+        pad_color = other.pad_color;
+        normalization = other.normalization;
+    }
+    bool color_conversion_required() const
+    {
+        return color_format != COLOR_FORMAT_SOURCE;
+    }
 };
 
 struct output_video_config_t
@@ -319,6 +446,8 @@ public:
     output_video_config_t output_video_config;
     digital_zoom_config_t digital_zoom_config;
     rotation_angle_t rotation_config;
+    // video device of the sensor the frames come from, empty if not configured
+    std::string video_device;
 
     multi_resize_config_t()
     {
@@ -327,6 +456,7 @@ public:
         input_video_config.pool_max_buffers = 0;
         input_video_config.dimensions.destination_width = 0;
         input_video_config.dimensions.destination_height = 0;
+        input_video_config.clear_crop_roi();
         rotation_config = ROTATION_ANGLE_0;
         output_video_config.resolutions = std::vector<output_resolution_t>();
     }
@@ -346,7 +476,15 @@ public:
                 // Update output video dimensions is restricted
                 return MEDIA_LIBRARY_CONFIGURATION_ERROR;
             }
+            if (current_res.color_format != new_res.color_format)
+            {
+                // Update output color format is restricted, the buffer pools are allocated for it
+                return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+            }
             current_res.framerate = new_res.framerate;
+            // The crop region is in input frame coordinates, so it is not affected by output rotation
+            current_res.update_crop(new_res);
+            current_res.update_scaling(new_res);
         }
 
         // rotate if necessary
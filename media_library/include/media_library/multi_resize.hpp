@@ -57,6 +57,12 @@ public:
         std::function<void(std::vector<output_resolution_t> &)> on_output_resolutions_change = nullptr;
     };
 
+    /**
+     * @brief Receives the frames of a region of interest stream.
+     * The frame holds a reference that the receiver releases (decrease_ref_count) when done with it.
+     */
+    using roi_stream_callback_t = std::function<void(uint32_t stream_id, HailoMediaLibraryBufferPtr frame)>;
+
     /**
      * @brief Observes the media library by registering the provided callbacks.
      *
@@ -157,6 +163,66 @@ public:
      * @return The status of the operation.
      */
     media_library_return set_output_rotation(const rotation_angle_t &rotation);
+
+    /**
+     * @brief Sets the crop region of a specific output.
+     * Outputs with a crop region are resized from that region of the input frame instead of the
+     * shared digital zoom region. Outputs sharing the same region are resized in a single DSP operation.
+     *
+     * @param[in] output_index - index of the output in output_video_config.resolutions
+     * @param[in] enabled - whether the output has its own crop region
+     * @param[in] roi - the crop region, in input frame coordinates, must fit in the input frame
+     * @return media_library_return - status of the operation
+     */
+    media_library_return set_output_crop_roi(uint32_t output_index, bool enabled, const roi_t &roi);
+
+    /**
+     * @brief Reports the occupancy of the consumer of a specific output.
+     * An output whose consumer is saturated - its downstream queue is full, or it still holds
+     * pool_max_buffers buffers of the output - is skipped before acquiring a buffer and resizing, so a slow
+     * consumer does not fail the whole frame or waste DSP work on frames dropped later.
+     *
+     * @param[in] output_index - index of the output in output_video_config.resolutions
+     * @param[in] queued_buffers - number of buffers currently queued downstream
+     * @param[in] max_queued_buffers - capacity of the downstream queue, 0 if unbounded or unknown
+     * @return media_library_return - status of the operation
+     */
+    media_library_return set_output_consumer_level(uint32_t output_index, uint32_t queued_buffers, uint32_t max_queued_buffers);
+
+    /**
+     * @brief Adds a region of interest stream (digital PTZ sub-stream).
+     * ROI streams are resized from their region of the same input frame as the configured outputs,
+     * in the same handle_frame call, and are delivered through their callback rather than in the
+     * output frames. Streams can be added and removed at any time without affecting the configured
+     * outputs. Every stream has a buffer pool of its own, allocated here with pool_max_buffers
+     * buffers. ROI streams are produced in the input color format.
+     * The ROI must fit in the input frame. A stream whose ROI no longer fits after the input
+     * resolution changed is skipped, without failing the other outputs, until it is moved.
+     *
+     * @param[in] output_res - output resolution, framerate, pool size and scaling mode of the stream
+     * @param[in] roi - the region of the stream, in input frame coordinates
+     * @param[in] on_frame - callback receiving the frames of the stream, must not add or remove streams
+     * @return tl::expected<uint32_t, media_library_return> - the id of the new stream, or an error code
+     */
+    tl::expected<uint32_t, media_library_return> add_roi_stream(const output_resolution_t &output_res, const roi_t &roi, roi_stream_callback_t on_frame);
+
+    /**
+     * @brief Moves the region of a region of interest stream.
+     *
+     * @param[in] stream_id - id returned by add_roi_stream
+     * @param[in] roi - the new region of the stream, in input frame coordinates, must fit in the input frame
+     * @return media_library_return - status of the operation
+     */
+    media_library_return set_roi_stream_roi(uint32_t stream_id, const roi_t &roi);
+
+    /**
+     * @brief Removes a region of interest stream.
+     * Frames already delivered stay valid until released by the receiver.
+     *
+     * @param[in] stream_id - id returned by add_roi_stream
+     * @return media_library_return - status of the operation
+     */
+    media_library_return remove_roi_stream(uint32_t stream_id);
 };
 
 /** @} */ // end of multi_resize_type_definitions
@@ -29,7 +29,12 @@
 
 #include <tl/expected.hpp>
 #include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <list>
 #include <mutex>
+#include <thread>
 #include "media_library_types.hpp"
 #include "privacy_mask_types.hpp"
 #include "buffer_pool.hpp"
@@ -77,6 +82,8 @@ class PrivacyMaskBlender
 
         /**
           * @brief Add a new privacy mask
+          * The vertices are in pixels of the frame before rotation - the mask rotates with the frame, see
+          * set_rotation.
           * 
           * @param privacy_mask - privacy mask to add
           * @return media_library_return - error code
@@ -117,6 +124,9 @@ class PrivacyMaskBlender
 
         /**
          * @brief Set rotation
+         * The privacy masks are kept unrotated and rotated exactly when drawn. The bitmasks of the latest frame
+         * sizes and rotations are kept, so switching back to one of them publishes its bitmask instantly.
+         * Does not change the frame size - see set_frame_size, which takes the rotated frame size.
          * 
          * @param rotation - rotation angle
          * @return media_library_return - error code
@@ -125,12 +135,26 @@ class PrivacyMaskBlender
 
         /**
          * @brief Blend privacy masks
-         * Calculate the quantized bitmask representing the all the privacy masks combined
+         * Returns the latest quantized bitmask representing all the privacy masks combined. Does not wait - the
+         * bitmask is rasterized in the background after each change of the masks, and the previous one is returned
+         * until the new one is complete. The returned bitmask is not written to while it is referenced.
          * 
          * @return tl::expected<PrivacyMaskDataPtr, media_library_return> containing the bitmask and relevant metadata
         */
         tl::expected<PrivacyMaskDataPtr, media_library_return> blend();
 
+        /**
+         * @brief Blend privacy masks with rectangles masked in a single frame
+         * For masks which change every frame, such as detected faces. The rectangles are set directly in a copy of
+         * the latest bitmask of blend(), without polygon rasterization, and clustered with its ROIs into the DSP
+         * ROIs. Does not wait for the rasterization of the privacy masks.
+         *
+         * @param rects - rectangles to mask, in frame pixels
+         * @return tl::expected<PrivacyMaskDataPtr, media_library_return> containing the bitmask of this frame and
+         * relevant metadata, the bitmask of blend() if there are no rectangles
+        */
+        tl::expected<PrivacyMaskDataPtr, media_library_return> blend(const std::vector<roi_t> &rects);
+
         /**
          * @brief Get color
          * 
@@ -147,6 +171,7 @@ class PrivacyMaskBlender
 
         /**
          * @brief set_frame_size
+         * The size of the frame after rotation.
          * 
          * @param width - frame width
          * @param height - frame height
@@ -162,16 +187,86 @@ class PrivacyMaskBlender
         tl::expected<std::vector<polygon>, media_library_return> get_all_privacy_masks();
 
     private:
+        // One of the two bitmasks the privacy masks are rasterized to in turn
+        struct privacy_mask_slot_t
+        {
+            // Holds the bitmask buffer once drawn, released with the last reference
+            PrivacyMaskDataPtr data;
+            // Regions changed since the bitmask was drawn
+            std::vector<roi_t> dirty_rects;
+        };
+
+        // Bitmasks of one frame size and rotation, kept while it is one of the latest used
+        struct privacy_mask_state_t
+        {
+            // Frame size after rotation
+            uint frame_width;
+            uint frame_height;
+            rotation_angle_t rotation;
+            // Allocated on the first rasterization
+            MediaLibraryBufferPoolPtr buffer_pool;
+            // Bitmasks of the frames with rectangles of blend(rects), shared by the states of the same frame size
+            MediaLibraryBufferPoolPtr dynamic_buffer_pool;
+            // The slot not holding latest_data is drawn next
+            std::array<privacy_mask_slot_t, 2> slots;
+            uint back_slot;
+            // Latest complete bitmask
+            PrivacyMaskDataPtr latest_data;
+            // The masks or the color changed since latest_data was drawn
+            bool stale;
+        };
+        using PrivacyMaskStatePtr = std::shared_ptr<privacy_mask_state_t>;
+
+        // Notified when the frames release a published bitmask - see share_privacy_mask_data(). Shared with the
+        // frames, which may outlive the blender.
+        struct privacy_mask_release_t
+        {
+            std::mutex mutex;
+            std::condition_variable cv;
+        };
+
+        // Reference to a published bitmask, notifying on its release
+        struct shared_privacy_mask_data_t
+        {
+            PrivacyMaskDataPtr data;
+            std::shared_ptr<privacy_mask_release_t> release;
+            ~shared_privacy_mask_data_t();
+        };
+
+        // What blend() returns for the current state, replaced as a whole
+        struct published_privacy_mask_t
+        {
+            PrivacyMaskDataPtr data;
+            MediaLibraryBufferPoolPtr dynamic_buffer_pool;
+            uint frame_width;
+            uint frame_height;
+        };
+
         std::vector<PolygonPtr> m_privacy_masks;
         rgb_color_t m_color;
         uint m_frame_width;
         uint m_frame_height;
         rotation_angle_t m_rotation;
-        MediaLibraryBufferPoolPtr m_buffer_pool;
         std::shared_ptr<std::mutex> m_privacy_mask_mutex;
-        PrivacyMaskDataPtr m_latest_privacy_mask_data;
-        media_library_return init_buffer_pool();
-        void clean_latest_privacy_mask_data();
+        // LRU cache of the states (most recent first) - the first one is the current state
+        static constexpr size_t STATE_CACHE_SIZE = 4;
+        std::list<PrivacyMaskStatePtr> m_states;
+        // Accessed with std::atomic_load/std::atomic_store
+        std::shared_ptr<published_privacy_mask_t> m_published;
+        // Background rasterization of the stale states, the current one first
+        std::thread m_rasterize_worker;
+        std::condition_variable m_rasterize_cv;
+        std::shared_ptr<privacy_mask_release_t> m_release;
+        std::atomic<bool> m_stop_rasterize_worker;
+        void activate_state();
+        void publish_state(const PrivacyMaskStatePtr &state);
+        PrivacyMaskDataPtr share_privacy_mask_data(const PrivacyMaskDataPtr &privacy_mask_data);
+        media_library_return init_buffer_pools(const PrivacyMaskStatePtr &state);
+        void add_dirty_rect(const polygon &privacy_mask);
+        void request_rasterize();
+        PrivacyMaskStatePtr get_stale_state();
+        void rasterize_worker_loop();
+        void rasterize(const PrivacyMaskStatePtr &state);
 };
 using PrivacyMaskBlenderPtr = std::shared_ptr<PrivacyMaskBlender>;
 
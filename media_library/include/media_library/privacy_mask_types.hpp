@@ -32,7 +32,10 @@
 #include "media_library_types.hpp"
 #include "buffer_pool.hpp"
 
-#define MAX_NUM_OF_PRIVACY_MASKS  8
+// Number of privacy masks - the masks share one bitmask, blended by the DSP in up to MAX_NUM_OF_PRIVACY_MASK_ROIS
+// bounding boxes which the masks are clustered into
+#define MAX_NUM_OF_PRIVACY_MASKS  256
+#define MAX_NUM_OF_PRIVACY_MASK_ROIS  8
 
 /** @defgroup privacy_mask_types_definitions MediaLibrary Privacy Mask Types
  * API definitions
@@ -69,7 +72,7 @@ namespace privacy_mask_types
   {
         hailo_media_library_buffer bitmask;
         yuv_color_t color;
-        roi_t rois[MAX_NUM_OF_PRIVACY_MASKS];
+        roi_t rois[MAX_NUM_OF_PRIVACY_MASK_ROIS];
         uint rois_count;
   };
   using PrivacyMaskDataPtr = std::shared_ptr<privacy_mask_data_t>;
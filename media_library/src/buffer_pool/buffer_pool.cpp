@@ -136,8 +136,10 @@ media_library_return HailoBucket::release(intptr_t buffer_ptr)
 MediaLibraryBufferPool::MediaLibraryBufferPool(uint width, uint height,
                                                dsp_image_format_t format,
                                                size_t max_buffers,
-                                               HailoMemoryType memory_type, uint bytes_per_line)
-    : m_width(width), m_height(height), m_bytes_per_line(bytes_per_line), m_format(format)
+                                               HailoMemoryType memory_type, uint bytes_per_line,
+                                               bool planar)
+    : m_width(width), m_height(height), m_bytes_per_line(bytes_per_line), m_format(format),
+      m_planar(planar && format == DSP_IMAGE_FORMAT_RGB)
 {
     m_name = "";
     if (m_name.empty())
@@ -155,8 +157,17 @@ MediaLibraryBufferPool::MediaLibraryBufferPool(uint width, uint height,
             bytes_per_line * (height / 2), max_buffers, memory_type));
         break;
     case DSP_IMAGE_FORMAT_RGB:
-        m_buckets.emplace_back(std::make_shared<HailoBucket>(
-            bytes_per_line * height * 3, max_buffers, memory_type));
+        if (m_planar)
+        {
+            for (uint8_t i = 0; i < 3; i++)
+                m_buckets.emplace_back(std::make_shared<HailoBucket>(
+                    bytes_per_line * height, max_buffers, memory_type));
+        }
+        else
+        {
+            m_buckets.emplace_back(std::make_shared<HailoBucket>(
+                bytes_per_line * height * 3, max_buffers, memory_type));
+        }
         break;
     case DSP_IMAGE_FORMAT_GRAY8:
         m_buckets.emplace_back(std::make_shared<HailoBucket>(
@@ -232,6 +243,34 @@ media_library_return MediaLibraryBufferPool::swap_width_and_height()
     return MEDIA_LIBRARY_SUCCESS;
 }
 
+size_t MediaLibraryBufferPool::get_available_buffers_count()
+{
+    if (m_buckets.empty())
+        return 0;
+
+    // All planes of a buffer are acquired and released together, the first bucket represents the pool
+    HailoBucketPtr &bucket = m_buckets[0];
+    std::unique_lock<std::mutex> lock(*bucket->m_bucket_mutex);
+    return bucket->m_available_buffers.size();
+}
+
+uint64_t MediaLibraryBufferPool::get_buffer_tag(const hailo_media_library_buffer &buffer)
+{
+    std::unique_lock<std::mutex> lock(*m_buffer_pool_mutex);
+    auto it = m_buffer_tags.find((intptr_t)buffer.hailo_pix_buffer->planes[0].userptr);
+    return it == m_buffer_tags.end() ? 0 : it->second;
+}
+
+void MediaLibraryBufferPool::set_buffer_tag(const hailo_media_library_buffer &buffer, uint64_t tag)
+{
+    std::unique_lock<std::mutex> lock(*m_buffer_pool_mutex);
+    intptr_t buffer_ptr = (intptr_t)buffer.hailo_pix_buffer->planes[0].userptr;
+    if (tag == 0)
+        m_buffer_tags.erase(buffer_ptr);
+    else
+        m_buffer_tags[buffer_ptr] = tag;
+}
+
 media_library_return
 MediaLibraryBufferPool::acquire_buffer(hailo_media_library_buffer &buffer)
 {
@@ -306,7 +345,47 @@ MediaLibraryBufferPool::acquire_buffer(hailo_media_library_buffer &buffer)
     }
     case DSP_IMAGE_FORMAT_RGB:
     {
-        // TODO: implement
+        // Packed RGB uses a single plane of 3 bytes per pixel, planar RGB uses one plane per channel
+        uint32_t planes_count = m_planar ? 3 : 1;
+        size_t image_stride = m_planar ? m_bytes_per_line : m_bytes_per_line * 3;
+        size_t image_size = image_stride * m_height;
+
+        dsp_data_plane_t *planes = new dsp_data_plane_t[planes_count];
+        for (uint32_t i = 0; i < planes_count; i++)
+        {
+            intptr_t data_ptr;
+            ret = m_buckets[i]->acquire(&data_ptr);
+            if (ret != MEDIA_LIBRARY_SUCCESS)
+            {
+                for (uint32_t j = 0; j < i; j++)
+                    m_buckets[j]->release((intptr_t)planes[j].userptr - PAGE_ALIGN_OFFSET);
+                delete[] planes;
+                return MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
+            }
+
+            planes[i] = {
+                .userptr = (void *)(data_ptr + PAGE_ALIGN_OFFSET),
+                .bytesperline = image_stride,
+                .bytesused = image_size,
+            };
+        }
+
+        // Fill in dsp_image_properties_t values
+        DspImagePropertiesPtr hailo_pix_buffer = std::make_shared<dsp_image_properties_t>();
+        hailo_pix_buffer->width = m_width;
+        hailo_pix_buffer->height = m_height;
+        hailo_pix_buffer->planes = planes;
+        hailo_pix_buffer->planes_count = planes_count;
+        hailo_pix_buffer->format = DSP_IMAGE_FORMAT_RGB;
+
+        ret = buffer.create(shared_from_this(), hailo_pix_buffer);
+        if (ret != MEDIA_LIBRARY_SUCCESS)
+            return ret;
+
+        buffer.increase_ref_count();
+        LOGGER__DEBUG("RGB{} Buffer width {} height {} acquired", m_planar ? " planar" : "",
+                      buffer.hailo_pix_buffer->width,
+                      buffer.hailo_pix_buffer->height);
         break;
     }
     case DSP_IMAGE_FORMAT_GRAY8:
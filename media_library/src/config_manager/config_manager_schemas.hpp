@@ -778,6 +778,20 @@ namespace config_schemas
           "black_corners_threshold": {
             "type": "number"
           },
+          "fast_camera_model": {
+            "type": "boolean"
+          },
+          "mesh_reuse_threshold": {
+            "type": "number",
+            "minimum": 0
+          },
+          "mesh_correction_threshold": {
+            "type": "number",
+            "minimum": 0
+          },
+          "background_mesh_generation": {
+            "type": "boolean"
+          },
           "debug": {
             "type": "object",
             "properties": {
@@ -973,6 +987,120 @@ namespace config_schemas
                 },
                 "pool_max_buffers": {
                   "type": "number"
+                },
+                "roi": {
+                  "type": "object",
+                  "properties": {
+                    "x": {
+                      "type": "number",
+                      "minimum": 0
+                    },
+                    "y": {
+                      "type": "number",
+                      "minimum": 0
+                    },
+                    "width": {
+                      "type": "number",
+                      "minimum": 1
+                    },
+                    "height": {
+                      "type": "number",
+                      "minimum": 1
+                    }
+                  },
+                  "additionalProperties": false,
+                  "required": [
+                    "x",
+                    "y",
+                    "width",
+                    "height"
+                  ]
+                },
+                "scaling_mode": {
+                  "type": "string",
+                  "enum": [
+                    "SCALING_MODE_STRETCH",
+                    "SCALING_MODE_LETTERBOX",
+                    "SCALING_MODE_CROP_TO_FILL"
+                  ]
+                },
+                "pad_color": {
+                  "type": "object",
+                  "properties": {
+                    "r": {
+                      "type": "integer",
+                      "minimum": 0,
+                      "maximum": 255
+                    },
+                    "g": {
+                      "type": "integer",
+                      "minimum": 0,
+                      "maximum": 255
+                    },
+                    "b": {
+                      "type": "integer",
+                      "minimum": 0,
+                      "maximum": 255
+                    }
+                  },
+                  "additionalProperties": false,
+                  "required": [
+                    "r",
+                    "g",
+                    "b"
+                  ]
+                },
+                "color_format": {
+                  "type": "string",
+                  "enum": [
+                    "COLOR_FORMAT_SOURCE",
+                    "COLOR_FORMAT_RGB",
+                    "COLOR_FORMAT_BGR",
+                    "COLOR_FORMAT_RGB_PLANAR"
+                  ]
+                },
+                "normalization": {
+                  "type": "object",
+                  "properties": {
+                    "mean": {
+                      "type": "array",
+                      "items": {
+                        "type": "number"
+                      },
+                      "minItems": 3,
+                      "maxItems": 3
+                    },
+                    "scale": {
+                      "type": "array",
+                      "items": {
+                        "type": "number"
+                      },
+                      "minItems": 3,
+                      "maxItems": 3
+                    },
+                    "quantization": {
+                      "type": "object",
+                      "properties": {
+                        "scale": {
+                          "type": "number",
+                          "exclusiveMinimum": 0
+                        },
+                        "zero_point": {
+                          "type": "number"
+                        }
+                      },
+                      "additionalProperties": false,
+                      "required": [
+                        "scale",
+                        "zero_point"
+                      ]
+                    }
+                  },
+                  "additionalProperties": false,
+                  "required": [
+                    "mean",
+                    "scale"
+                  ]
                 }
               },
               "additionalProperties": false,
@@ -1116,6 +1244,20 @@ namespace config_schemas
           "black_corners_threshold": {
             "type": "number"
           },
+          "fast_camera_model": {
+            "type": "boolean"
+          },
+          "mesh_reuse_threshold": {
+            "type": "number",
+            "minimum": 0
+          },
+          "mesh_correction_threshold": {
+            "type": "number",
+            "minimum": 0
+          },
+          "background_mesh_generation": {
+            "type": "boolean"
+          },
           "debug": {
             "type": "object",
             "properties": {
@@ -112,6 +112,19 @@ MEDIALIB_JSON_SERIALIZE_ENUM(denoise_method_t, {
                                                    {DENOISE_METHOD_VD3, "HIGH_PERFORMANCE"},
                                                })
 
+MEDIALIB_JSON_SERIALIZE_ENUM(scaling_mode_t, {
+                                                 {SCALING_MODE_STRETCH, "SCALING_MODE_STRETCH"},
+                                                 {SCALING_MODE_LETTERBOX, "SCALING_MODE_LETTERBOX"},
+                                                 {SCALING_MODE_CROP_TO_FILL, "SCALING_MODE_CROP_TO_FILL"},
+                                             })
+
+MEDIALIB_JSON_SERIALIZE_ENUM(color_format_t, {
+                                                 {COLOR_FORMAT_SOURCE, "COLOR_FORMAT_SOURCE"},
+                                                 {COLOR_FORMAT_RGB, "COLOR_FORMAT_RGB"},
+                                                 {COLOR_FORMAT_BGR, "COLOR_FORMAT_BGR"},
+                                                 {COLOR_FORMAT_RGB_PLANAR, "COLOR_FORMAT_RGB_PLANAR"},
+                                             })
+
 //------------------------ roi_t ------------------------
 
 void to_json(nlohmann::json &j, const roi_t &roi)
@@ -132,6 +145,49 @@ void from_json(const nlohmann::json &j, roi_t &roi)
     j.at("height").get_to(roi.height);
 }
 
+//------------------------ pad_color_t ------------------------
+
+void to_json(nlohmann::json &j, const pad_color_t &color)
+{
+    j = nlohmann::json{
+        {"r", color.r},
+        {"g", color.g},
+        {"b", color.b},
+    };
+}
+
+void from_json(const nlohmann::json &j, pad_color_t &color)
+{
+    j.at("r").get_to(color.r);
+    j.at("g").get_to(color.g);
+    j.at("b").get_to(color.b);
+}
+
+//------------------------ normalization_config_t ------------------------
+
+void to_json(nlohmann::json &j, const normalization_config_t &normalization)
+{
+    j = nlohmann::json{
+        {"mean", normalization.mean},
+        {"scale", normalization.scale},
+        {"quantization", {{"scale", normalization.quant_scale}, {"zero_point", normalization.quant_zero_point}}},
+    };
+}
+
+void from_json(const nlohmann::json &j, normalization_config_t &normalization)
+{
+    normalization.enabled = true;
+    j.at("mean").get_to(normalization.mean);
+    j.at("scale").get_to(normalization.scale);
+    normalization.quant_scale = 1;
+    normalization.quant_zero_point = 0;
+    if (j.contains("quantization"))
+    {
+        j.at("quantization").at("scale").get_to(normalization.quant_scale);
+        j.at("quantization").at("zero_point").get_to(normalization.quant_zero_point);
+    }
+}
+
 //------------------------ dewarp_config_t ------------------------
 
 void to_json(nlohmann::json &j, const dewarp_config_t &dewarp)
@@ -187,6 +243,10 @@ void to_json(nlohmann::json &j, const dis_config_t &dis)
         {"std_multiplier", dis.std_multiplier},
         {"black_corners_correction_enabled", dis.black_corners_correction_enabled},
         {"black_corners_threshold", dis.black_corners_threshold},
+        {"fast_camera_model", dis.fast_camera_model},
+        {"mesh_reuse_threshold", dis.mesh_reuse_threshold},
+        {"mesh_correction_threshold", dis.mesh_correction_threshold},
+        {"background_mesh_generation", dis.background_mesh_generation},
         {"debug", dis.debug},
     };
 }
@@ -201,6 +261,18 @@ void from_json(const nlohmann::json &j, dis_config_t &dis)
     j.at("std_multiplier").get_to(dis.std_multiplier);
     j.at("black_corners_correction_enabled").get_to(dis.black_corners_correction_enabled);
     j.at("black_corners_threshold").get_to(dis.black_corners_threshold);
+    dis.fast_camera_model = false;
+    if (j.contains("fast_camera_model"))
+        j.at("fast_camera_model").get_to(dis.fast_camera_model);
+    dis.mesh_reuse_threshold = 0;
+    if (j.contains("mesh_reuse_threshold"))
+        j.at("mesh_reuse_threshold").get_to(dis.mesh_reuse_threshold);
+    dis.mesh_correction_threshold = 0;
+    if (j.contains("mesh_correction_threshold"))
+        j.at("mesh_correction_threshold").get_to(dis.mesh_correction_threshold);
+    dis.background_mesh_generation = false;
+    if (j.contains("background_mesh_generation"))
+        j.at("background_mesh_generation").get_to(dis.background_mesh_generation);
     j.at("debug").get_to(dis.debug);
 }
 
@@ -282,6 +354,17 @@ void to_json(nlohmann::json &j, const output_resolution_t &out_res)
         {"height", out_res.dimensions.destination_height},
         {"pool_max_buffers", out_res.pool_max_buffers},
     };
+    if (out_res.dimensions.perform_crop)
+        j["roi"] = out_res.get_crop_roi();
+    if (out_res.scaling_mode != SCALING_MODE_STRETCH)
+    {
+        j["scaling_mode"] = out_res.scaling_mode;
+        j["pad_color"] = out_res.pad_color;
+    }
+    if (out_res.color_format != COLOR_FORMAT_SOURCE)
+        j["color_format"] = out_res.color_format;
+    if (out_res.normalization.enabled)
+        j["normalization"] = out_res.normalization;
 }
 
 void from_json(const nlohmann::json &j, output_resolution_t &out_res)
@@ -290,7 +373,13 @@ void from_json(const nlohmann::json &j, output_resolution_t &out_res)
     j.at("width").get_to(out_res.dimensions.destination_width);
     j.at("height").get_to(out_res.dimensions.destination_height);
     j.at("pool_max_buffers").get_to(out_res.pool_max_buffers);
-    out_res.dimensions.perform_crop = false;
+    out_res.clear_crop_roi();
+    if (j.contains("roi"))
+        out_res.set_crop_roi(j.at("roi").get<roi_t>());
+    out_res.scaling_mode = j.value("scaling_mode", SCALING_MODE_STRETCH);
+    out_res.pad_color = j.value("pad_color", pad_color_t{0, 0, 0});
+    out_res.color_format = j.value("color_format", COLOR_FORMAT_SOURCE);
+    out_res.normalization = j.value("normalization", normalization_config_t{false, {0, 0, 0}, {1, 1, 1}, 1, 0});
 }
 
 //------------------------ output_video_config_t ------------------------
@@ -377,6 +466,9 @@ void from_json(const nlohmann::json &j, multi_resize_config_t &mresize_conf)
     // not to be set/changed from json. It is set by the application.
     j.at("output_video").get_to(mresize_conf.output_video_config);
     j.at("digital_zoom").get_to(mresize_conf.digital_zoom_config);
+    // The source of a front end configuration names the sensor, for sharing the DSP with other sensors
+    if (j.contains("input_stream") && j.at("input_stream").contains("source"))
+        j.at("input_stream").at("source").get_to(mresize_conf.video_device);
 }
 
 //------------------------ ldc_config_t ------------------------
@@ -403,6 +495,9 @@ void from_json(const nlohmann::json &j, ldc_config_t &ldc_conf)
     j.at("optical_zoom").get_to(ldc_conf.optical_zoom_config);
     j.at("rotation").get_to(ldc_conf.rotation_config);
     j.at("flip").get_to(ldc_conf.flip_config);
+    // The source of a front end configuration names the sensor, for sharing the DSP with other sensors
+    if (j.contains("input_stream") && j.at("input_stream").contains("source"))
+        j.at("input_stream").at("source").get_to(ldc_conf.input_video_config.video_device);
 }
 
 //------------------------ hailort_t ------------------------
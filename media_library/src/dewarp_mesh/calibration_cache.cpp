@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file calibration_cache.cpp
+ * @brief Binary sensor calibration and dewarp mesh cache
+ **/
+
+#include "calibration_cache.hpp"
+#include "media_library_logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary calibration file layout:
+//   calibration_file_header_t
+//   float theta2radius[theta2radius_size]
+//   mesh_count times: calibration_file_mesh_t, int32_t mesh_table[mesh_width * mesh_height * 2]
+// All fields are in the native byte order of the target.
+static constexpr char CALIBRATION_FILE_MAGIC[8] = {'H', 'L', 'O', 'C', 'A', 'L', 'I', 'B'};
+// Bump when the file layout or the generated meshes change, older files are then regenerated
+static constexpr uint32_t CALIBRATION_FILE_VERSION = 3;
+
+struct calibration_file_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t source_size;
+    int64_t source_mtime;
+    int32_t res_x;
+    int32_t res_y;
+    float oc_x;
+    float oc_y;
+    uint32_t theta2radius_size;
+    uint32_t mesh_count;
+};
+
+struct calibration_file_mesh_t
+{
+    calibration_mesh_key_t key;
+    uint32_t mesh_width;
+    uint32_t mesh_height;
+};
+
+// Calibrations shared between the mesh contexts of the process, by calibration file. Held weakly, so a calibration
+// is closed with its last user.
+static std::mutex shared_calibrations_mutex;
+static std::map<std::string, std::weak_ptr<CalibrationCache>> shared_calibrations;
+
+static size_t mesh_table_bytes(uint32_t mesh_width, uint32_t mesh_height)
+{
+    return static_cast<size_t>(mesh_width) * mesh_height * 2 * sizeof(int32_t);
+}
+
+/**
+ * @brief Checks a calibration read from a binary file as read_text_file() checks a text one - starting at 0, positive
+ * and monotonically increasing
+ */
+static bool is_valid_theta2radius(const std::vector<float> &theta2radius)
+{
+    if (theta2radius[0] != 0)
+    {
+        LOGGER__ERROR("Improper calibration file theta2radius[0] must be 0, but it is {}", theta2radius[0]);
+        return false;
+    }
+    for (size_t i = 1; i < theta2radius.size(); i++)
+    {
+        if (!std::isfinite(theta2radius[i]) || theta2radius[i] <= 0 || theta2radius[i] < theta2radius[i - 1])
+        {
+            LOGGER__ERROR("Improper calibration file theta2radius[{}] must be positive and monotonically increasing, but it is {}",
+                          i, theta2radius[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+tl::expected<std::unique_ptr<CalibrationCache>, media_library_return> CalibrationCache::create(const std::string &calib_path)
+{
+    std::unique_ptr<CalibrationCache> cache(new CalibrationCache());
+    cache->m_calib_path = calib_path;
+
+    // A binary calibration file is used as is, and caches the meshes itself
+    if (is_binary_file(calib_path))
+    {
+        cache->m_cache_path = calib_path;
+        if (cache->map_file(calib_path) != MEDIA_LIBRARY_SUCCESS)
+        {
+            LOGGER__ERROR("Invalid binary calibration file {}", calib_path);
+            return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+        }
+        LOGGER__INFO("Loaded binary calibration file {} with {} meshes", calib_path, cache->m_meshes.size());
+        return cache;
+    }
+
+    struct stat source_stat;
+    if (stat(calib_path.c_str(), &source_stat) != 0)
+    {
+        LOGGER__ERROR("read_calibration_file failed, could not open file {}", calib_path);
+        return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+    }
+    uint64_t source_size = source_stat.st_size;
+    int64_t source_mtime = static_cast<int64_t>(source_stat.st_mtim.tv_sec) * 1000000000 + source_stat.st_mtim.tv_nsec;
+
+    // Use the binary file generated from this text file, if it is still up to date
+    cache->m_cache_path = calib_path + ".bin";
+    if (cache->map_file(cache->m_cache_path) == MEDIA_LIBRARY_SUCCESS)
+    {
+        if (cache->m_source_size == source_size && cache->m_source_mtime == source_mtime)
+        {
+            LOGGER__INFO("Loaded binary calibration file {} with {} meshes", cache->m_cache_path, cache->m_meshes.size());
+            return cache;
+        }
+        LOGGER__INFO("Binary calibration file {} is out of date, regenerating it", cache->m_cache_path);
+        cache->unmap_file();
+        cache->m_meshes.clear();
+    }
+
+    auto expected_calib = read_text_file(calib_path);
+    if (!expected_calib.has_value())
+        return tl::make_unexpected(expected_calib.error());
+    cache->m_calibration = std::move(expected_calib.value());
+    cache->m_source_size = source_size;
+    cache->m_source_mtime = source_mtime;
+
+    if (cache->write_file({}, {}) == MEDIA_LIBRARY_SUCCESS)
+        LOGGER__INFO("Generated binary calibration file {}", cache->m_cache_path);
+    return cache;
+}
+
+CalibrationCache::~CalibrationCache()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    flush_meshes_locked();
+    unmap_file();
+}
+
+tl::expected<std::shared_ptr<CalibrationCache>, media_library_return> CalibrationCache::acquire(const std::string &calib_path)
+{
+    std::unique_lock<std::mutex> lock(shared_calibrations_mutex);
+    std::shared_ptr<CalibrationCache> cache = shared_calibrations[calib_path].lock();
+    if (cache != nullptr)
+    {
+        LOGGER__DEBUG("Sharing calibration of {}", calib_path);
+        return cache;
+    }
+
+    auto expected_cache = create(calib_path);
+    if (!expected_cache.has_value())
+        return tl::make_unexpected(expected_cache.error());
+    cache = std::move(expected_cache.value());
+    shared_calibrations[calib_path] = cache;
+    return cache;
+}
+
+dis_calibration_t CalibrationCache::get_calibration() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_calibration;
+}
+
+bool CalibrationCache::find_mesh(const calibration_mesh_key_t &key, uint32_t &mesh_width, uint32_t &mesh_height,
+                                 std::vector<int32_t> *mesh_table) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (auto pending = m_pending_meshes.rbegin(); pending != m_pending_meshes.rend(); ++pending)
+    {
+        if (pending->key == key)
+        {
+            mesh_width = pending->mesh_width;
+            mesh_height = pending->mesh_height;
+            if (mesh_table != nullptr)
+                *mesh_table = pending->mesh_table;
+            return true;
+        }
+    }
+    for (const mesh_entry_t &mesh : m_meshes)
+    {
+        if (mesh.key == key)
+        {
+            mesh_width = mesh.mesh_width;
+            mesh_height = mesh.mesh_height;
+            if (mesh_table != nullptr)
+            {
+                const int32_t *table = reinterpret_cast<const int32_t *>(m_data + mesh.offset);
+                mesh_table->assign(table, table + static_cast<size_t>(mesh_width) * mesh_height * 2);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void CalibrationCache::store_mesh(const calibration_mesh_key_t &key, uint32_t mesh_width, uint32_t mesh_height,
+                                  const int32_t *mesh_table)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::erase_if(m_pending_meshes, [&key](const pending_mesh_t &mesh) { return mesh.key == key; });
+    if (m_pending_meshes.size() >= MAX_MESHES)
+        m_pending_meshes.erase(m_pending_meshes.begin());
+    m_pending_meshes.push_back({key, mesh_width, mesh_height,
+                                std::vector<int32_t>(mesh_table, mesh_table + static_cast<size_t>(mesh_width) * mesh_height * 2)});
+}
+
+media_library_return CalibrationCache::flush_meshes()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return flush_meshes_locked();
+}
+
+media_library_return CalibrationCache::flush_meshes_locked()
+{
+    if (m_pending_meshes.empty())
+        return MEDIA_LIBRARY_SUCCESS;
+
+    // Keep the newest meshes of the file, other than the ones replaced
+    std::vector<mesh_entry_t> meshes;
+    for (const mesh_entry_t &mesh : m_meshes)
+    {
+        if (std::none_of(m_pending_meshes.begin(), m_pending_meshes.end(),
+                         [&mesh](const pending_mesh_t &pending) { return pending.key == mesh.key; }))
+            meshes.push_back(mesh);
+    }
+    if (meshes.size() + m_pending_meshes.size() > MAX_MESHES)
+        meshes.erase(meshes.begin(), meshes.begin() + (meshes.size() + m_pending_meshes.size() - MAX_MESHES));
+
+    if (write_file(meshes, m_pending_meshes) != MEDIA_LIBRARY_SUCCESS)
+        return MEDIA_LIBRARY_ERROR;
+
+    LOGGER__DEBUG("Stored {} meshes in binary calibration file {}", m_pending_meshes.size(), m_cache_path);
+    m_pending_meshes.clear();
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+/**
+ * @brief Maps a binary calibration file and parses its calibration and mesh entries
+ */
+media_library_return CalibrationCache::map_file(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return MEDIA_LIBRARY_ERROR;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(calibration_file_header_t))
+    {
+        close(fd);
+        return MEDIA_LIBRARY_ERROR;
+    }
+    void *data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        LOGGER__ERROR("Failed mapping binary calibration file {}", path);
+        return MEDIA_LIBRARY_ERROR;
+    }
+    m_data = static_cast<const uint8_t *>(data);
+    m_data_size = file_stat.st_size;
+
+    // Nothing of the file is used before its whole layout is checked against its size
+    calibration_file_header_t header;
+    memcpy(&header, m_data, sizeof(header));
+    if (memcmp(header.magic, CALIBRATION_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CALIBRATION_FILE_VERSION || header.header_size != sizeof(header))
+    {
+        LOGGER__INFO("Binary calibration file {} has an unsupported format or version", path);
+        unmap_file();
+        return MEDIA_LIBRARY_ERROR;
+    }
+    if (header.theta2radius_size == 0 || header.theta2radius_size > CALIBRATION_VECTOR_SIZE ||
+        header.mesh_count > MAX_MESHES ||
+        m_data_size < sizeof(header) + static_cast<size_t>(header.theta2radius_size) * sizeof(float))
+    {
+        LOGGER__ERROR("Binary calibration file {} is corrupted ({} calibration values, {} meshes in {} bytes)",
+                      path, header.theta2radius_size, header.mesh_count, m_data_size);
+        unmap_file();
+        return MEDIA_LIBRARY_ERROR;
+    }
+
+    m_source_size = header.source_size;
+    m_source_mtime = header.source_mtime;
+    m_calibration.res = ivec2(header.res_x, header.res_y);
+    m_calibration.oc = vec2(header.oc_x, header.oc_y);
+    m_calibration.theta2radius.resize(header.theta2radius_size);
+    memcpy(m_calibration.theta2radius.data(), m_data + sizeof(header), header.theta2radius_size * sizeof(float));
+    if (!is_valid_theta2radius(m_calibration.theta2radius))
+    {
+        unmap_file();
+        return MEDIA_LIBRARY_ERROR;
+    }
+
+    m_meshes.clear();
+    size_t offset = sizeof(header) + header.theta2radius_size * sizeof(float);
+    for (uint32_t i = 0; i < header.mesh_count; i++)
+    {
+        calibration_file_mesh_t mesh;
+        if (m_data_size - offset < sizeof(mesh))
+            break;
+        memcpy(&mesh, m_data + offset, sizeof(mesh));
+        offset += sizeof(mesh);
+        size_t table_bytes = mesh_table_bytes(mesh.mesh_width, mesh.mesh_height);
+        if (table_bytes == 0 || m_data_size - offset < table_bytes)
+            break;
+        m_meshes.push_back({mesh.key, mesh.mesh_width, mesh.mesh_height, offset});
+        offset += table_bytes;
+    }
+    if (m_meshes.size() != header.mesh_count || offset != m_data_size)
+    {
+        LOGGER__ERROR("Binary calibration file {} is corrupted, {} of {} meshes are valid in {} of {} bytes",
+                      path, m_meshes.size(), header.mesh_count, offset, m_data_size);
+        m_meshes.clear();
+        unmap_file();
+        return MEDIA_LIBRARY_ERROR;
+    }
+
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+void CalibrationCache::unmap_file()
+{
+    if (m_data != nullptr)
+        munmap(const_cast<uint8_t *>(m_data), m_data_size);
+    m_data = nullptr;
+    m_data_size = 0;
+}
+
+/**
+ * @brief Writes the calibration, the given mapped meshes and the new meshes to the binary file, replacing it
+ * atomically, and maps the new file
+ */
+media_library_return CalibrationCache::write_file(const std::vector<mesh_entry_t> &meshes,
+                                                  const std::vector<pending_mesh_t> &new_meshes)
+{
+    calibration_file_header_t header = {};
+    memcpy(header.magic, CALIBRATION_FILE_MAGIC, sizeof(header.magic));
+    header.version = CALIBRATION_FILE_VERSION;
+    header.header_size = sizeof(header);
+    header.source_size = m_source_size;
+    header.source_mtime = m_source_mtime;
+    header.res_x = m_calibration.res.x;
+    header.res_y = m_calibration.res.y;
+    header.oc_x = m_calibration.oc.x;
+    header.oc_y = m_calibration.oc.y;
+    header.theta2radius_size = m_calibration.theta2radius.size();
+    header.mesh_count = meshes.size() + new_meshes.size();
+
+    // Build the whole file before unmapping the current one, the meshes kept are copied from it
+    std::vector<uint8_t> data;
+    auto append = [&data](const void *src, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(src);
+        data.insert(data.end(), bytes, bytes + size);
+    };
+    append(&header, sizeof(header));
+    append(m_calibration.theta2radius.data(), m_calibration.theta2radius.size() * sizeof(float));
+    for (const mesh_entry_t &mesh : meshes)
+    {
+        calibration_file_mesh_t entry = {mesh.key, mesh.mesh_width, mesh.mesh_height};
+        append(&entry, sizeof(entry));
+        append(m_data + mesh.offset, mesh_table_bytes(mesh.mesh_width, mesh.mesh_height));
+    }
+    for (const pending_mesh_t &mesh : new_meshes)
+    {
+        calibration_file_mesh_t entry = {mesh.key, mesh.mesh_width, mesh.mesh_height};
+        append(&entry, sizeof(entry));
+        append(mesh.mesh_table.data(), mesh_table_bytes(mesh.mesh_width, mesh.mesh_height));
+    }
+
+    // Write a temporary file of a unique name next to it and rename it, so that readers never see a partial file and
+    // processes writing at the same time do not write into each other's file
+    std::string tmp_path = m_cache_path + ".XXXXXX";
+    int fd = mkstemp(tmp_path.data());
+    if (fd < 0)
+    {
+        LOGGER__INFO("Could not write binary calibration file {}, meshes will not be cached", m_cache_path);
+        return MEDIA_LIBRARY_ERROR;
+    }
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            break;
+        written += result;
+    }
+    // mkstemp() creates the file readable by its owner only
+    bool write_failed = written != data.size() || fchmod(fd, 0644) != 0;
+    if (close(fd) != 0 || write_failed)
+    {
+        LOGGER__ERROR("Failed writing binary calibration file {}", tmp_path);
+        unlink(tmp_path.c_str());
+        return MEDIA_LIBRARY_ERROR;
+    }
+    if (std::rename(tmp_path.c_str(), m_cache_path.c_str()) != 0)
+    {
+        LOGGER__ERROR("Failed replacing binary calibration file {}", m_cache_path);
+        std::remove(tmp_path.c_str());
+        return MEDIA_LIBRARY_ERROR;
+    }
+
+    unmap_file();
+    return map_file(m_cache_path);
+}
+
+bool CalibrationCache::is_binary_file(const std::string &path)
+{
+    char magic[sizeof(CALIBRATION_FILE_MAGIC)] = {};
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(magic, sizeof(magic)))
+        return false;
+    return memcmp(magic, CALIBRATION_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+tl::expected<dis_calibration_t, media_library_return> CalibrationCache::read_text_file(const std::string &path)
+{
+    dis_calibration_t calib{{}, {1, 1}, {}};
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        LOGGER__ERROR("read_calibration_file failed, could not open file {}", path);
+        return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+    }
+
+    file.seekg(0);
+
+    // Ignore first line - it is a comment
+    file.ignore(1024, '\n');
+
+    std::string row;
+    std::getline(file, row);
+    calib.res.x = atoi(row.c_str());
+    if (file.eof())
+        return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+    std::getline(file, row);
+    calib.res.y = atoi(row.c_str());
+    if (file.eof())
+        return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+    std::getline(file, row);
+    calib.oc.x = atof(row.c_str());
+    if (file.eof())
+        return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+    std::getline(file, row);
+    calib.oc.y = atof(row.c_str());
+    if (file.eof())
+        return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+    std::getline(file, row);
+    calib.theta2radius.push_back(atof(row.c_str()));
+    if (file.eof())
+    {
+        LOGGER__ERROR("read_calibration_file failed, invalid data");
+        return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+    }
+    if (calib.theta2radius[0] != 0)
+    {
+        LOGGER__ERROR("Improper calibration file theta2radius[0] must be 0, but it is {}", calib.theta2radius[0]);
+        return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+    }
+
+    for (uint32_t i = 1; !file.eof() && i < CALIBRATION_VECTOR_SIZE; ++i)
+    {
+        std::getline(file, row);
+        calib.theta2radius.push_back(atof(row.c_str()));
+
+        if (calib.theta2radius[i] <= 0)
+        {
+            LOGGER__ERROR("theta2radius[{}] contain positive radii. is {}", i, calib.theta2radius[i]);
+            return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+        }
+        if (calib.theta2radius[i] < calib.theta2radius[i - 1])
+        {
+            LOGGER__ERROR("Improper calibration file theta2radius[{}] must be monotonically increasing, but it is not ({})", i, calib.theta2radius[i]);
+            return tl::make_unexpected(MEDIA_LIBRARY_CONFIGURATION_ERROR);
+        }
+    }
+    return calib;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file calibration_cache.hpp
+ * @brief Binary sensor calibration and dewarp mesh cache
+ **/
+
+#pragma once
+#include "interface_types.h"
+#include "media_library_types.hpp"
+#include <compare>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tl/expected.hpp>
+#include <vector>
+
+/**
+ * @brief State a dewarp (no DIS) mesh depends on, besides the sensor calibration, a key of the meshes stored
+ * in the binary calibration file. Stored as is in the file - fixed size fields only.
+ */
+struct calibration_mesh_key_t
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t camera_type;
+    float camera_fov;
+    float magnification;
+    uint32_t flip_mirror_rot;
+    // CALIBRATION_MESH_FLAG_* of the DIS configuration
+    uint32_t flags;
+
+    auto operator<=>(const calibration_mesh_key_t &other) const = default;
+};
+
+// number of theta2radius values of a sensor calibration
+static constexpr size_t CALIBRATION_VECTOR_SIZE = 1024;
+
+static constexpr uint32_t CALIBRATION_MESH_FLAG_FAST_CAMERA_MODEL = 1 << 0;
+static constexpr uint32_t CALIBRATION_MESH_FLAG_RESIZE_GRID = 1 << 1;
+
+/**
+ * @brief Sensor calibration backed by a compact, versioned binary file, which also caches the dewarp meshes
+ * generated from it.
+ *
+ * The binary file is memory mapped. It is either configured directly as the sensor calibration file, or it is
+ * generated from the text calibration file on first use as "<text file>.bin" next to it, and regenerated when the
+ * text file changes. Generating it offline amounts to creating a CalibrationCache of the text file and copying
+ * the resulting binary file to the target.
+ *
+ * The mesh contexts of a process share one CalibrationCache per calibration file - see acquire(). It is thread
+ * safe.
+ */
+class CalibrationCache
+{
+public:
+    // maximal number of meshes kept in the file, the oldest one is dropped first
+    static constexpr size_t MAX_MESHES = 8;
+
+    /**
+     * @brief Opens the binary calibration of a sensor calibration file, generating it if needed
+     *
+     * @param[in] calib_path - path of a text or binary sensor calibration file
+     * @return tl::expected<std::unique_ptr<CalibrationCache>, media_library_return> - the cache, or an error if
+     * the calibration could not be read
+     */
+    static tl::expected<std::unique_ptr<CalibrationCache>, media_library_return> create(const std::string &calib_path);
+
+    /**
+     * @brief Returns the CalibrationCache of a sensor calibration file shared by the whole process, opening it if
+     * no one holds it. Held weakly, so it is closed with its last user.
+     *
+     * @param[in] calib_path - path of a text or binary sensor calibration file
+     * @return tl::expected<std::shared_ptr<CalibrationCache>, media_library_return> - the cache, or an error if
+     * the calibration could not be read
+     */
+    static tl::expected<std::shared_ptr<CalibrationCache>, media_library_return> acquire(const std::string &calib_path);
+    ~CalibrationCache();
+
+    CalibrationCache(const CalibrationCache &) = delete;
+    CalibrationCache &operator=(const CalibrationCache &) = delete;
+
+    const std::string &get_calib_path() const { return m_calib_path; }
+    dis_calibration_t get_calibration() const;
+
+    /**
+     * @brief Looks up a stored mesh
+     *
+     * @param[in] key - the mesh state
+     * @param[out] mesh_width - width of the stored mesh
+     * @param[out] mesh_height - height of the stored mesh
+     * @param[out] mesh_table - if not null, receives a copy of the mesh table (mesh_width * mesh_height * 2 values)
+     * @return true if there is such a mesh
+     */
+    bool find_mesh(const calibration_mesh_key_t &key, uint32_t &mesh_width, uint32_t &mesh_height,
+                   std::vector<int32_t> *mesh_table = nullptr) const;
+
+    /**
+     * @brief Stores a mesh. It is found by find_mesh() right away, and written to the binary file by the next
+     * flush_meshes(), or when the cache is closed.
+     *
+     * @param[in] key - the mesh state
+     * @param[in] mesh_width - width of the mesh
+     * @param[in] mesh_height - height of the mesh
+     * @param[in] mesh_table - the mesh table (mesh_width * mesh_height * 2 values)
+     */
+    void store_mesh(const calibration_mesh_key_t &key, uint32_t mesh_width, uint32_t mesh_height,
+                    const int32_t *mesh_table);
+
+    /**
+     * @brief Writes the meshes stored since the last write to the binary file, in one replacement of the file.
+     * The meshes stay stored in memory if the file could not be written.
+     *
+     * @return media_library_return - MEDIA_LIBRARY_ERROR if the file could not be written
+     */
+    media_library_return flush_meshes();
+
+private:
+    struct mesh_entry_t
+    {
+        calibration_mesh_key_t key;
+        uint32_t mesh_width;
+        uint32_t mesh_height;
+        size_t offset; // of the mesh table in the mapped file
+    };
+
+    struct pending_mesh_t
+    {
+        calibration_mesh_key_t key;
+        uint32_t mesh_width;
+        uint32_t mesh_height;
+        std::vector<int32_t> mesh_table;
+    };
+
+    std::string m_calib_path;
+    std::string m_cache_path;
+    // identity of the text calibration file the binary file was generated from, 0 for a binary calibration file
+    uint64_t m_source_size = 0;
+    int64_t m_source_mtime = 0;
+    dis_calibration_t m_calibration;
+    std::vector<mesh_entry_t> m_meshes;
+    // stored meshes not written to the file yet, oldest first
+    std::vector<pending_mesh_t> m_pending_meshes;
+    const uint8_t *m_data = nullptr;
+    size_t m_data_size = 0;
+    // guards the mapping, which flush_meshes() replaces
+    mutable std::mutex m_mutex;
+
+    CalibrationCache() = default;
+    media_library_return map_file(const std::string &path);
+    void unmap_file();
+    media_library_return write_file(const std::vector<mesh_entry_t> &meshes, const std::vector<pending_mesh_t> &new_meshes);
+    media_library_return flush_meshes_locked();
+    static bool is_binary_file(const std::string &path);
+    static tl::expected<dis_calibration_t, media_library_return> read_text_file(const std::string &path);
+};
@@ -0,0 +1,900 @@
+#include "dewarp_mesh_context.hpp"
+#include "dis_interface.h"
+#include "media_library_logger.hpp"
+#include "media_library_utils.hpp"
+#include <cmath>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <stdio.h>
+
+// Dewarp meshes shared between the mesh contexts of the process, by calibration file and mesh state. Held weakly, so a
+// mesh is freed with its last user.
+struct shared_mesh_entry_t
+{
+    std::weak_ptr<shared_dewarp_mesh_t> mesh;
+    // A context is loading or generating the mesh, outside of the lock - the others needing it wait for it
+    bool in_flight;
+};
+static std::mutex shared_meshes_mutex;
+static std::condition_variable shared_meshes_cv;
+static std::map<std::pair<std::string, calibration_mesh_key_t>, shared_mesh_entry_t> shared_meshes;
+
+shared_dewarp_mesh_t::~shared_dewarp_mesh_t()
+{
+    if (mesh.mesh_table == nullptr)
+        return;
+    dsp_status result = dsp_utils::release_hailo_dsp_buffer(mesh.mesh_table);
+    if (result != DSP_SUCCESS)
+    {
+        LOGGER__ERROR("failed releasing mesh dsp buffer on error {}", result);
+    }
+}
+
+DewarpMeshContext::DewarpMeshContext(pre_proc_op_configurations &config)
+{
+    if (!config.dewarp_config.enabled)
+        return;
+
+    configure(config);
+}
+
+DewarpMeshContext::DewarpMeshContext(ldc_config_t &config)
+{
+    // The output resolution of hailodewarp is known only once its input video configuration is set
+    if (!config.dewarp_config.enabled ||
+        config.output_video_config.dimensions.destination_width == 0 ||
+        config.output_video_config.dimensions.destination_height == 0)
+        return;
+
+    configure(config);
+}
+
+DewarpMeshContext::~DewarpMeshContext()
+{
+    stop_mesh_worker();
+    free_dis_context();
+
+    if (m_mesh_cache_hits + m_mesh_cache_misses > 0)
+        LOGGER__INFO("dewarp mesh cache: {} hits, {} misses", m_mesh_cache_hits, m_mesh_cache_misses);
+    if (m_skipped_vsm_meshes > 0)
+        LOGGER__INFO("dewarp mesh worker: {} VSMs without a mesh", m_skipped_vsm_meshes);
+
+    // The meshes of the ring and of the cache are freed with their last user
+}
+
+/**
+ * @brief Converts the configuration of hailodewarp to the one the mesh context keeps
+ */
+pre_proc_op_configurations DewarpMeshContext::to_pre_proc_configs(const ldc_config_t &ldc_configs)
+{
+    pre_proc_op_configurations pre_proc_configs;
+    pre_proc_configs.rotation_config = ldc_configs.rotation_config;
+    pre_proc_configs.flip_config = ldc_configs.flip_config;
+    pre_proc_configs.dewarp_config = ldc_configs.dewarp_config;
+    pre_proc_configs.dis_config = ldc_configs.dis_config;
+    pre_proc_configs.optical_zoom_config = ldc_configs.optical_zoom_config;
+    pre_proc_configs.input_video_config = ldc_configs.input_video_config;
+    return pre_proc_configs;
+}
+
+/**
+ * @brief Allocates a mesh for the ring, in size of m_ring_mesh_size
+ *
+ * @return SharedDewarpMeshPtr - the mesh, or nullptr on allocation failure
+ */
+SharedDewarpMeshPtr DewarpMeshContext::create_ring_mesh()
+{
+    auto mesh = std::make_shared<shared_dewarp_mesh_t>();
+    dsp_status result = dsp_utils::create_hailo_dsp_buffer(m_ring_mesh_size, (void **)&mesh->mesh.mesh_table);
+    if (result != DSP_SUCCESS)
+    {
+        LOGGER__ERROR("dewarp mesh initialization failed in the buffer allocation process (tried to allocate buffer in size of {})", m_ring_mesh_size);
+        return nullptr;
+    }
+    return mesh;
+}
+
+/**
+ * @brief Returns a mesh of the ring which is neither published nor held by a DSP operation. The ring grows if there
+ * is none.
+ *
+ * @return SharedDewarpMeshPtr - the mesh, or nullptr on allocation failure
+ */
+SharedDewarpMeshPtr DewarpMeshContext::get_free_ring_mesh()
+{
+    for (auto &mesh : m_meshes)
+    {
+        // Only the ring holds it - published and held meshes share its reference count
+        if (mesh.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return mesh;
+        }
+    }
+
+    SharedDewarpMeshPtr mesh = create_ring_mesh();
+    if (mesh == nullptr)
+        return nullptr;
+    m_meshes.push_back(mesh);
+    LOGGER__DEBUG("dewarp mesh ring grown to {} meshes", m_meshes.size());
+    return mesh;
+}
+
+/**
+ * @brief Makes a mesh generated by DIS the one returned by get()
+ *
+ * @param[in] dsp_mesh - the mesh of the ring to publish
+ * @param[in] mesh - the generated mesh, its dimensions may be swapped by rotation
+ */
+void DewarpMeshContext::publish_mesh(SharedDewarpMeshPtr dsp_mesh, const DewarpT &mesh)
+{
+    dsp_mesh->mesh.mesh_width = mesh.mesh_width;
+    dsp_mesh->mesh.mesh_height = mesh.mesh_height;
+    // DIS swaps the dimensions it gets according to the last rotation it generated
+    m_mesh_width = mesh.mesh_width;
+    m_mesh_height = mesh.mesh_height;
+    std::atomic_store(&m_published_mesh, DspDewarpMeshPtr(dsp_mesh, &dsp_mesh->mesh));
+}
+
+FlipMirrorRot DewarpMeshContext::get_flip_mirror_rot()
+{
+    flip_direction_t flip_dir = FLIP_DIRECTION_NONE;
+    rotation_angle_t rotation_angle = ROTATION_ANGLE_0;
+    if (m_pre_proc_configs.flip_config.enabled)
+        flip_dir = m_pre_proc_configs.flip_config.direction;
+    if (m_pre_proc_configs.rotation_config.enabled)
+        rotation_angle = m_pre_proc_configs.rotation_config.angle;
+    return get_flip_value(flip_dir, rotation_angle);
+}
+
+/**
+ * @brief Returns the state the dewarp mesh depends on, besides the sensor calibration
+ */
+calibration_mesh_key_t DewarpMeshContext::get_mesh_key()
+{
+    uint32_t flags = 0;
+    if (m_pre_proc_configs.dis_config.fast_camera_model)
+        flags |= CALIBRATION_MESH_FLAG_FAST_CAMERA_MODEL;
+    if (m_pre_proc_configs.dis_config.debug.generate_resize_grid)
+        flags |= CALIBRATION_MESH_FLAG_RESIZE_GRID;
+    // The calibration is zoomed only when optical zoom is enabled - see initialize_dis_context()
+    float magnification = m_pre_proc_configs.optical_zoom_config.enabled ? m_magnification : 1.0f;
+
+    return {static_cast<uint32_t>(m_input_width),
+            static_cast<uint32_t>(m_input_height),
+            static_cast<uint32_t>(m_pre_proc_configs.dewarp_config.camera_type),
+            m_pre_proc_configs.dewarp_config.camera_fov,
+            magnification,
+            static_cast<uint32_t>(get_flip_mirror_rot()),
+            flags};
+}
+
+/**
+ * @brief Returns the state the meshes of the DIS context depend on - the mesh state but the flip and rotation, which
+ * DIS gets per mesh
+ */
+calibration_mesh_key_t DewarpMeshContext::get_dis_context_key()
+{
+    calibration_mesh_key_t key = get_mesh_key();
+    key.flip_mirror_rot = 0;
+    return key;
+}
+
+/**
+ * @brief Returns whether DIS stabilizes differently with one configuration than with another
+ */
+static bool dis_stabilization_changed(const dis_config_t &previous, const dis_config_t &current)
+{
+    return previous.minimun_coefficient_filter != current.minimun_coefficient_filter ||
+           previous.decrement_coefficient_threshold != current.decrement_coefficient_threshold ||
+           previous.increment_coefficient_threshold != current.increment_coefficient_threshold ||
+           previous.running_average_coefficient != current.running_average_coefficient ||
+           previous.std_multiplier != current.std_multiplier ||
+           previous.black_corners_correction_enabled != current.black_corners_correction_enabled ||
+           previous.black_corners_threshold != current.black_corners_threshold ||
+           previous.mesh_reuse_threshold != current.mesh_reuse_threshold ||
+           previous.mesh_correction_threshold != current.mesh_correction_threshold ||
+           previous.debug.fix_stabilization != current.debug.fix_stabilization ||
+           previous.debug.fix_stabilization_longitude != current.debug.fix_stabilization_longitude ||
+           previous.debug.fix_stabilization_latitude != current.debug.fix_stabilization_latitude;
+}
+
+/**
+ * @brief Publishes the cached mesh of the current state, if there is one
+ *
+ * @return true on a cache hit
+ */
+bool DewarpMeshContext::publish_cached_mesh()
+{
+    calibration_mesh_key_t key = get_mesh_key();
+    auto entry = std::find_if(m_mesh_cache.begin(), m_mesh_cache.end(),
+                              [&key](const auto &cached) { return cached.first == key; });
+    if (entry == m_mesh_cache.end())
+    {
+        m_mesh_cache_misses++;
+        return false;
+    }
+
+    m_mesh_cache_hits++;
+    m_mesh_cache.splice(m_mesh_cache.begin(), m_mesh_cache, entry);
+    SharedDewarpMeshPtr &mesh = m_mesh_cache.front().second;
+    std::atomic_store(&m_published_mesh, DspDewarpMeshPtr(mesh, &mesh->mesh));
+    LOGGER__INFO("dewarp mesh cache hit ({} hits, {} misses)", m_mesh_cache_hits, m_mesh_cache_misses);
+    return true;
+}
+
+/**
+ * @brief Adds a mesh to the cache and publishes it. When the cache is full, drops the least recently used entry - a
+ * DSP operation still holding it keeps it alive.
+ */
+void DewarpMeshContext::cache_mesh(const calibration_mesh_key_t &key, SharedDewarpMeshPtr mesh)
+{
+    if (m_mesh_cache.size() >= MESH_CACHE_SIZE)
+        m_mesh_cache.pop_back();
+
+    std::atomic_store(&m_published_mesh, DspDewarpMeshPtr(mesh, &mesh->mesh));
+    m_mesh_cache.emplace_front(key, std::move(mesh));
+}
+
+/**
+ * @brief Returns the mesh of a state shared by the process - the one another context holds, the one stored in the
+ * binary calibration file by a previous run, or a newly generated one. The mesh is loaded or generated outside of the
+ * lock, while its entry is marked in flight - contexts needing the same mesh at the same time wait for it rather than
+ * generate it again, and contexts needing other meshes are not held.
+ *
+ * @param[in] key - the mesh state
+ */
+tl::expected<SharedDewarpMeshPtr, media_library_return> DewarpMeshContext::acquire_shared_mesh(const calibration_mesh_key_t &key)
+{
+    auto shared_key = std::make_pair(m_pre_proc_configs.dewarp_config.sensor_calib_path, key);
+    std::unique_lock<std::mutex> lock(shared_meshes_mutex);
+    shared_meshes_cv.wait(lock, [&shared_key] {
+        auto entry = shared_meshes.find(shared_key);
+        return entry == shared_meshes.end() || !entry->second.in_flight;
+    });
+    SharedDewarpMeshPtr mesh = shared_meshes[shared_key].mesh.lock();
+    if (mesh != nullptr)
+    {
+        LOGGER__INFO("sharing dewarp mesh grid {}x{} with another mesh context", mesh->mesh.mesh_width, mesh->mesh.mesh_height);
+        return mesh;
+    }
+    shared_meshes[shared_key].in_flight = true;
+    lock.unlock();
+
+    media_library_return status = MEDIA_LIBRARY_SUCCESS;
+    mesh = load_stored_mesh(key);
+    if (mesh == nullptr)
+    {
+        auto expected_mesh = generate_mesh(key);
+        if (expected_mesh.has_value())
+            mesh = expected_mesh.value();
+        else
+            status = expected_mesh.error();
+    }
+
+    lock.lock();
+    // Forget the meshes no one holds anymore
+    std::erase_if(shared_meshes, [](const auto &entry) { return !entry.second.in_flight && entry.second.mesh.expired(); });
+    // On failure the entry is left empty, a waiting context tries on its own
+    shared_meshes[shared_key] = {mesh, false};
+    lock.unlock();
+    shared_meshes_cv.notify_all();
+
+    if (status != MEDIA_LIBRARY_SUCCESS)
+        return tl::make_unexpected(status);
+    return mesh;
+}
+
+/**
+ * @brief Returns the size in bytes of the mesh of a state which is available without generating it - shared by
+ * another context or stored in the binary calibration file - or 0 if it has to be generated
+ */
+size_t DewarpMeshContext::get_known_mesh_size(const calibration_mesh_key_t &key)
+{
+    {
+        std::unique_lock<std::mutex> lock(shared_meshes_mutex);
+        auto shared_mesh = shared_meshes.find(std::make_pair(m_pre_proc_configs.dewarp_config.sensor_calib_path, key));
+        SharedDewarpMeshPtr mesh = shared_mesh != shared_meshes.end() ? shared_mesh->second.mesh.lock() : nullptr;
+        if (mesh != nullptr)
+            return mesh->mesh.mesh_width * mesh->mesh.mesh_height * 2 * 4;
+    }
+
+    uint32_t stored_width, stored_height;
+    if (m_calibration_cache != nullptr && m_calibration_cache->find_mesh(key, stored_width, stored_height))
+        return stored_width * stored_height * 2 * 4;
+    return 0;
+}
+
+/**
+ * @brief Loads the mesh of a state stored in the binary calibration file by a previous run, if there is one
+ *
+ * @return SharedDewarpMeshPtr - the mesh, or nullptr if the file does not have it
+ */
+SharedDewarpMeshPtr DewarpMeshContext::load_stored_mesh(const calibration_mesh_key_t &key)
+{
+    if (m_calibration_cache == nullptr)
+        return nullptr;
+
+    uint32_t mesh_width, mesh_height;
+    std::vector<int32_t> mesh_table;
+    if (!m_calibration_cache->find_mesh(key, mesh_width, mesh_height, &mesh_table))
+        return nullptr;
+
+    auto mesh = std::make_shared<shared_dewarp_mesh_t>();
+    size_t mesh_size = mesh_table.size() * sizeof(int32_t);
+    dsp_status result = dsp_utils::create_hailo_dsp_buffer(mesh_size, (void **)&mesh->mesh.mesh_table);
+    if (result != DSP_SUCCESS)
+    {
+        LOGGER__ERROR("dewarp mesh cache failed allocating a buffer in size of {}", mesh_size);
+        return nullptr;
+    }
+    memcpy(mesh->mesh.mesh_table, mesh_table.data(), mesh_size);
+    mesh->mesh.mesh_width = mesh_width;
+    mesh->mesh.mesh_height = mesh_height;
+
+    // Not generated by DIS, so m_mesh_width and m_mesh_height (DIS's view of the dimensions) are kept
+    LOGGER__INFO("loaded dewarp mesh grid {}x{} from the binary calibration file", mesh_width, mesh_height);
+    return mesh;
+}
+
+/**
+ * @brief Generates the mesh of a state with the DIS context, and stores it in the binary calibration file for the
+ * next runs
+ */
+tl::expected<SharedDewarpMeshPtr, media_library_return> DewarpMeshContext::generate_mesh(const calibration_mesh_key_t &key)
+{
+    if (m_dis_ctx_stale)
+    {
+        media_library_return status = reinitialize_dis_context();
+        if (status != MEDIA_LIBRARY_SUCCESS)
+            return tl::make_unexpected(status);
+    }
+
+    auto mesh = std::make_shared<shared_dewarp_mesh_t>();
+    size_t mesh_size = m_mesh_width * m_mesh_height * 2 * 4;
+    dsp_status result = dsp_utils::create_hailo_dsp_buffer(mesh_size, (void **)&mesh->mesh.mesh_table);
+    if (result != DSP_SUCCESS)
+    {
+        LOGGER__ERROR("dewarp mesh cache failed allocating a buffer in size of {}", mesh_size);
+        return tl::make_unexpected(MEDIA_LIBRARY_DSP_OPERATION_ERROR);
+    }
+
+    DewarpT dewarp_mesh = {(int)m_mesh_width,
+                           (int)m_mesh_height,
+                           (int *)mesh->mesh.mesh_table};
+    RetCodes ret = dis_dewarp_only_grid(m_dis_ctx, m_input_width, m_input_height,
+                                        static_cast<FlipMirrorRot>(key.flip_mirror_rot), &dewarp_mesh);
+    if (ret != DIS_OK)
+    {
+        LOGGER__ERROR("Failed to generate mesh, status: {}", ret);
+        return tl::make_unexpected(MEDIA_LIBRARY_ERROR);
+    }
+
+    mesh->mesh.mesh_width = dewarp_mesh.mesh_width;
+    mesh->mesh.mesh_height = dewarp_mesh.mesh_height;
+    // DIS swaps the dimensions it gets according to the last rotation it generated
+    m_mesh_width = dewarp_mesh.mesh_width;
+    m_mesh_height = dewarp_mesh.mesh_height;
+    LOGGER__INFO("generated base dewarp mesh grid {}x{}", dewarp_mesh.mesh_width, dewarp_mesh.mesh_height);
+
+    // Store it for the next runs
+    if (m_calibration_cache != nullptr)
+        m_calibration_cache->store_mesh(key, dewarp_mesh.mesh_width, dewarp_mesh.mesh_height, dewarp_mesh.mesh_table);
+    return mesh;
+}
+
+/**
+ * @brief Generates the mesh of a frame from its VSM into a free mesh of the ring and publishes it.
+ * m_mutex must be locked by the caller.
+ *
+ * @param[in] vsm - the VSM of the frame
+ */
+media_library_return DewarpMeshContext::generate_dis_mesh(struct hailo15_vsm &vsm)
+{
+    // Update dewarp mesh with the VSM data to perform DIS
+    LOGGER__DEBUG("Updating mesh with VSM");
+    if (m_dis_ctx_stale)
+    {
+        media_library_return status = reinitialize_dis_context();
+        if (status != MEDIA_LIBRARY_SUCCESS)
+            return status;
+    }
+    // A reconfigured DIS context may generate larger meshes, the held ones of the previous size are freed with their
+    // last user
+    size_t mesh_size = m_mesh_width * m_mesh_height * 2 * 4;
+    if (mesh_size > m_ring_mesh_size)
+    {
+        m_ring_mesh_size = mesh_size;
+        m_meshes.clear();
+    }
+    SharedDewarpMeshPtr dsp_mesh = get_free_ring_mesh();
+    if (dsp_mesh == nullptr)
+        return MEDIA_LIBRARY_DSP_OPERATION_ERROR;
+    DewarpT mesh = {(int)m_mesh_width,
+                    (int)m_mesh_height,
+                    (int *)dsp_mesh->mesh.mesh_table};
+
+    RetCodes ret = dis_generate_grid(m_dis_ctx, m_input_width, m_input_height, vsm.dx,
+                                     vsm.dy, 0, get_flip_mirror_rot(), &mesh);
+    if (ret != DIS_OK)
+    {
+        LOGGER__ERROR("Failed to update mesh with VSM, status: {}", ret);
+        return MEDIA_LIBRARY_ERROR;
+    }
+
+    publish_mesh(dsp_mesh, mesh);
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+/**
+ * @brief Advances DIS by the VSM of a frame whose mesh is not needed, as generate_dis_mesh() would.
+ * m_mutex must be locked by the caller.
+ *
+ * @param[in] vsm - the VSM of the frame
+ */
+media_library_return DewarpMeshContext::filter_dis_motion(struct hailo15_vsm &vsm)
+{
+    if (m_dis_ctx_stale)
+    {
+        media_library_return status = reinitialize_dis_context();
+        if (status != MEDIA_LIBRARY_SUCCESS)
+            return status;
+    }
+
+    RetCodes ret = dis_filter_motion(m_dis_ctx, vsm.dx, vsm.dy, 0);
+    if (ret != DIS_OK)
+    {
+        LOGGER__ERROR("Failed to update DIS with VSM, status: {}", ret);
+        return MEDIA_LIBRARY_ERROR;
+    }
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+/**
+ * @brief Passes the pending VSMs to DIS one by one and generates the mesh of the last one
+ */
+void DewarpMeshContext::mesh_worker_loop()
+{
+    std::vector<struct hailo15_vsm> vsms;
+    std::unique_lock<std::mutex> vsm_lock(m_vsm_mutex);
+    while (true)
+    {
+        m_vsm_cv.wait(vsm_lock, [this] { return m_stop_mesh_worker || !m_pending_vsms.empty(); });
+        if (m_stop_mesh_worker)
+            return;
+
+        vsms.swap(m_pending_vsms);
+        vsm_lock.unlock();
+        {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            for (size_t i = 0; i + 1 < vsms.size(); i++)
+                filter_dis_motion(vsms[i]);
+            generate_dis_mesh(vsms.back());
+        }
+        vsms.clear();
+        vsm_lock.lock();
+    }
+}
+
+void DewarpMeshContext::stop_mesh_worker()
+{
+    if (!m_mesh_worker.joinable())
+        return;
+
+    {
+        std::unique_lock<std::mutex> vsm_lock(m_vsm_mutex);
+        m_stop_mesh_worker = true;
+    }
+    m_vsm_cv.notify_one();
+    m_mesh_worker.join();
+}
+
+FlipMirrorRot DewarpMeshContext::get_flip_value(flip_direction_t flip_dir, rotation_angle_t rotation_angle)
+{
+    FlipMirrorRot flip_mirror_rot;
+
+    switch (rotation_angle)
+    {
+    case ROTATION_ANGLE_90:
+    {
+        switch (flip_dir)
+        {
+        case FLIP_DIRECTION_HORIZONTAL:
+        {
+            flip_mirror_rot = ROT90_MIRROR;
+            break;
+        }
+        case FLIP_DIRECTION_VERTICAL:
+        {
+            flip_mirror_rot = ROT90_FLIPV;
+            break;
+        }
+        case FLIP_DIRECTION_BOTH:
+        {
+            flip_mirror_rot = ROT90_FLIPV_MIRROR;
+            break;
+        }
+        default:
+        {
+            flip_mirror_rot = ROT90;
+            break;
+        }
+        }
+        break;
+    }
+    case ROTATION_ANGLE_180:
+    {
+        switch (flip_dir)
+        {
+        case FLIP_DIRECTION_HORIZONTAL:
+        {
+            flip_mirror_rot = ROT180_MIRROR;
+            break;
+        }
+        case FLIP_DIRECTION_VERTICAL:
+        {
+            flip_mirror_rot = ROT180_FLIPV;
+            break;
+        }
+        case FLIP_DIRECTION_BOTH:
+        {
+            flip_mirror_rot = ROT180_FLIPV_MIRROR;
+            break;
+        }
+        default:
+        {
+            flip_mirror_rot = ROT180;
+            break;
+        }
+        }
+        break;
+    }
+    case ROTATION_ANGLE_270:
+    {
+        switch (flip_dir)
+        {
+        case FLIP_DIRECTION_HORIZONTAL:
+        {
+            flip_mirror_rot = ROT270_MIRROR;
+            break;
+        }
+        case FLIP_DIRECTION_VERTICAL:
+        {
+            flip_mirror_rot = ROT270_FLIPV;
+            break;
+        }
+        case FLIP_DIRECTION_BOTH:
+        {
+            flip_mirror_rot = ROT270_FLIPV_MIRROR;
+            break;
+        }
+        default:
+        {
+            flip_mirror_rot = ROT270;
+            break;
+        }
+        }
+        break;
+    }
+    default:
+    {
+        switch (flip_dir)
+        {
+        case FLIP_DIRECTION_HORIZONTAL:
+        {
+            flip_mirror_rot = MIRROR;
+            break;
+        }
+        case FLIP_DIRECTION_VERTICAL:
+        {
+            flip_mirror_rot = FLIPV;
+            break;
+        }
+        case FLIP_DIRECTION_BOTH:
+        {
+            flip_mirror_rot = FLIPV_MIRROR;
+            break;
+        }
+        default:
+        {
+            flip_mirror_rot = NATURAL;
+            break;
+        }
+        }
+        break;
+    }
+    }
+
+    return flip_mirror_rot;
+}
+
+/**
+ * @brief Acquires the shared binary calibration of the configured sensor calibration file, unless it is already held
+ */
+media_library_return DewarpMeshContext::open_calibration_cache()
+{
+    const std::string &calib_path = m_pre_proc_configs.dewarp_config.sensor_calib_path;
+    if (m_calibration_cache != nullptr && m_calibration_cache->get_calib_path() == calib_path)
+        return MEDIA_LIBRARY_SUCCESS;
+
+    auto expected_cache = CalibrationCache::acquire(calib_path);
+    if (!expected_cache.has_value())
+    {
+        m_calibration_cache = nullptr;
+        return expected_cache.error();
+    }
+    m_calibration_cache = std::move(expected_cache.value());
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+media_library_return DewarpMeshContext::initialize_dis_context()
+{
+    DewarpT dewarp_mesh;
+
+    // Read the sensor calibration file
+    if (open_calibration_cache() != MEDIA_LIBRARY_SUCCESS)
+    {
+        LOGGER__ERROR("dewarp mesh initialization failed when reading calib_file");
+        return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+    }
+    auto calib = m_calibration_cache->get_calibration();
+
+    if (m_pre_proc_configs.optical_zoom_config.enabled && m_magnification != 1.0) // set calibration according to zoom
+    {
+        // crop
+        auto cropped = calib.theta2radius;
+        size_t crop_size = static_cast<size_t>(CALIBRATION_VECTOR_SIZE / m_magnification);
+        cropped.erase(cropped.begin() + crop_size, cropped.end());
+
+        // convert cropped to difference series
+        for (size_t i = 0; i < cropped.size() - 1; ++i)
+        {
+            cropped[i] = cropped[i + 1] - cropped[i];
+        }
+
+        // Resize the matrix using cv::resize
+        cv::Mat originalMat(1, crop_size, CV_32FC1, cropped.data());
+        cv::Mat resizedMat;
+        cv::resize(originalMat, resizedMat, cv::Size(CALIBRATION_VECTOR_SIZE, 1));
+        std::vector<float> resizedVector(resizedMat.begin<float>(), resizedMat.end<float>());
+
+        // convert resizedVector from difference series to cumulative series
+        calib.theta2radius = std::vector<float>{0};
+        for (size_t i = 0; i < CALIBRATION_VECTOR_SIZE; ++i)
+        {
+            calib.theta2radius.push_back(resizedVector[i] + calib.theta2radius[i]);
+        }
+    }
+
+    // Initialize dis dewarp mesh object using DIS library
+    RetCodes ret = dis_init(&m_dis_ctx, m_pre_proc_configs.dis_config, calib,
+                            m_input_width, m_input_height,
+                            m_pre_proc_configs.dewarp_config.camera_type, m_pre_proc_configs.dewarp_config.camera_fov, &dewarp_mesh);
+    if (ret != DIS_OK)
+    {
+        LOGGER__ERROR("dewarp mesh initialization failed on error {}", ret);
+        return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+    }
+
+    // Convert stuct to dsp_dewarp_mesh_t
+    m_mesh_width = dewarp_mesh.mesh_width;
+    m_mesh_height = dewarp_mesh.mesh_height;
+    m_dis_ctx_stale = false;
+    dis_mesh_density_t density;
+    dis_get_mesh_density(m_dis_ctx, &density);
+    LOGGER__INFO("dewarp mesh initialization finished {}x{}, cell size {}, max interpolation error {:.3f} pixels",
+                 dewarp_mesh.mesh_width, dewarp_mesh.mesh_height, density.cell_size, density.max_error);
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+media_library_return DewarpMeshContext::reinitialize_dis_context()
+{
+    free_dis_context();
+    // Stays stale if the initialization fails, so that no mesh is generated from the freed context
+    m_dis_ctx_stale = true;
+    return initialize_dis_context();
+}
+
+media_library_return DewarpMeshContext::free_dis_context()
+{
+    // not initialized when the meshes were loaded from the binary calibration file
+    if (m_dis_ctx == nullptr)
+        return MEDIA_LIBRARY_SUCCESS;
+
+    dis_mesh_stats_t stats;
+    if (dis_get_mesh_stats(m_dis_ctx, &stats) == DIS_OK)
+    {
+        LOGGER__INFO("dewarp mesh updates: {} skipped, {} corrected, {} regenerated",
+                     stats.skipped, stats.corrected, stats.regenerated);
+    }
+
+    RetCodes ret = dis_deinit(&m_dis_ctx);
+    if (ret != DIS_OK)
+    {
+        LOGGER__ERROR("dewarp mesh free failed on error {}", ret);
+    }
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+media_library_return DewarpMeshContext::initialize_dewarp_mesh()
+{
+    if (publish_cached_mesh())
+        return MEDIA_LIBRARY_SUCCESS;
+
+    calibration_mesh_key_t key = get_mesh_key();
+    auto expected_mesh = acquire_shared_mesh(key);
+    if (!expected_mesh.has_value())
+        return expected_mesh.error();
+
+    cache_mesh(key, expected_mesh.value());
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+media_library_return DewarpMeshContext::configure(pre_proc_op_configurations &pre_proc_op_configs)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    // The DIS context generates the meshes of the configuration it was initialized with
+    calibration_mesh_key_t previous_dis_key = {};
+    dis_config_t previous_dis_config = {};
+    std::string previous_calib_path;
+    if (m_is_initialized)
+    {
+        previous_dis_key = get_dis_context_key();
+        previous_dis_config = m_pre_proc_configs.dis_config;
+        previous_calib_path = m_pre_proc_configs.dewarp_config.sensor_calib_path;
+    }
+
+    m_pre_proc_configs = pre_proc_op_configs;
+    if (!m_pre_proc_configs.dewarp_config.enabled)
+        return MEDIA_LIBRARY_SUCCESS;
+
+    if (pre_proc_op_configs.dewarp_config.enabled &&
+        pre_proc_op_configs.rotation_config.enabled &&
+        (pre_proc_op_configs.rotation_config.angle == ROTATION_ANGLE_90 ||
+         pre_proc_op_configs.rotation_config.angle == ROTATION_ANGLE_270))
+    {
+        // Swap width and height for rotation 90 or 270
+        m_dewarp_output_width = pre_proc_op_configs.input_video_config.resolution.dimensions.destination_height;
+        m_dewarp_output_height = pre_proc_op_configs.input_video_config.resolution.dimensions.destination_width;
+        LOGGER__INFO("DewarpMeshContext::configure - ROTATION ANGLE {}", pre_proc_op_configs.rotation_config.angle);
+    }
+    else
+    {
+        m_dewarp_output_width = pre_proc_op_configs.input_video_config.resolution.dimensions.destination_width;
+        m_dewarp_output_height = pre_proc_op_configs.input_video_config.resolution.dimensions.destination_height;
+    }
+
+    m_pre_proc_configs = pre_proc_op_configs;
+    m_input_width = m_pre_proc_configs.input_video_config.resolution.dimensions.destination_width;
+    m_input_height = m_pre_proc_configs.input_video_config.resolution.dimensions.destination_height;
+    m_magnification = m_pre_proc_configs.optical_zoom_config.magnification;
+
+    if (m_is_initialized)
+    {
+        // The cached meshes are of the previous calibration, their state does not include it
+        if (m_pre_proc_configs.dewarp_config.sensor_calib_path != previous_calib_path)
+            m_mesh_cache.clear();
+        if (m_pre_proc_configs.dewarp_config.sensor_calib_path != previous_calib_path ||
+            get_dis_context_key() != previous_dis_key ||
+            dis_stabilization_changed(previous_dis_config, m_pre_proc_configs.dis_config))
+        {
+            LOGGER__INFO("DIS configuration changed, reinitializing the DIS context");
+            m_dis_ctx_stale = true;
+        }
+    }
+
+    if (!m_is_initialized) // initialize mesh for the first time
+    {
+        LOGGER__INFO("Initiazing dewarp mesh context");
+
+        // Without DIS, a mesh another context holds or a previous run stored in the binary calibration file is all
+        // that is needed - the DIS context is initialized on the first mesh cache miss
+        size_t mesh_size = 0;
+        if (!m_pre_proc_configs.dis_config.enabled && open_calibration_cache() == MEDIA_LIBRARY_SUCCESS)
+            mesh_size = get_known_mesh_size(get_mesh_key());
+        if (mesh_size != 0)
+        {
+            m_dis_ctx_stale = true;
+        }
+        else
+        {
+            media_library_return status = initialize_dis_context();
+            if (status != MEDIA_LIBRARY_SUCCESS)
+                return status;
+            mesh_size = m_mesh_width * m_mesh_height * 2 * 4;
+        }
+
+        // Allocate memory for mesh tables - doing it outside of initialize_dewarp_mesh for reuse of the buffers
+        m_ring_mesh_size = mesh_size;
+        for (size_t i = 0; i < MESH_RING_SIZE; i++)
+        {
+            SharedDewarpMeshPtr mesh = create_ring_mesh();
+            if (mesh == nullptr)
+                return MEDIA_LIBRARY_DSP_OPERATION_ERROR;
+            m_meshes.push_back(mesh);
+        }
+
+        m_mesh_worker = std::thread(&DewarpMeshContext::mesh_worker_loop, this);
+
+        m_is_initialized = true;
+        LOGGER__INFO("Dewarp mesh init done.");
+    }
+
+    // DIS generates the meshes from the context
+    if (m_pre_proc_configs.dis_config.enabled && m_dis_ctx_stale)
+    {
+        media_library_return status = reinitialize_dis_context();
+        if (status != MEDIA_LIBRARY_SUCCESS)
+            return status;
+    }
+
+    if (!m_pre_proc_configs.dewarp_config.enabled)
+        return MEDIA_LIBRARY_SUCCESS;
+
+    media_library_return status = initialize_dewarp_mesh();
+    // The meshes generated by this configuration are written to the binary calibration file at once
+    if (m_calibration_cache != nullptr && m_calibration_cache->flush_meshes() != MEDIA_LIBRARY_SUCCESS)
+        LOGGER__WARNING("Failed storing the dewarp meshes in the binary calibration file, the next run generates them again");
+    return status;
+}
+
+media_library_return DewarpMeshContext::configure(ldc_config_t &ldc_configs)
+{
+    pre_proc_op_configurations pre_proc_configs = to_pre_proc_configs(ldc_configs);
+    return configure(pre_proc_configs);
+}
+
+media_library_return DewarpMeshContext::on_frame_vsm_update(struct hailo15_vsm &vsm)
+{
+    if (!m_pre_proc_configs.dis_config.enabled)
+        return MEDIA_LIBRARY_SUCCESS;
+
+    if (!m_pre_proc_configs.dis_config.background_mesh_generation)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return generate_dis_mesh(vsm);
+    }
+
+    // The mesh is generated by the worker while the DSP dewarps with the published one. If the worker is still busy
+    // with an earlier VSM, the earlier one advances DIS without a mesh.
+    {
+        std::unique_lock<std::mutex> vsm_lock(m_vsm_mutex);
+        if (!m_pending_vsms.empty())
+            m_skipped_vsm_meshes++;
+        m_pending_vsms.push_back(vsm);
+    }
+    m_vsm_cv.notify_one();
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+media_library_return DewarpMeshContext::set_optical_zoom(float magnification)
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_magnification = magnification;
+
+    // Without DIS, a cached or stored mesh of this zoom is all that is needed - the context is reinitialized on a
+    // cache miss
+    if (!m_pre_proc_configs.dis_config.enabled)
+    {
+        m_dis_ctx_stale = true;
+        return initialize_dewarp_mesh();
+    }
+
+    // upon optical zoom, dis_library should be reinitialized with modified calibration
+    media_library_return status = reinitialize_dis_context();
+    if (status != MEDIA_LIBRARY_SUCCESS)
+    {
+        LOGGER__ERROR("Failed to reinitialize DIS for optical zoom magnification {}", magnification);
+        return status;
+    }
+
+    return initialize_dewarp_mesh();
+}
+
+DspDewarpMeshPtr DewarpMeshContext::get()
+{
+    return std::atomic_load(&m_published_mesh);
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+#include "calibration_cache.hpp"
+#include "dewarp.h"
+#include "dsp_utils.hpp"
+#include "interface_types.h"
+#include "media_library_types.hpp"
+#include "media_library_utils.hpp"
+#include "hailo_v4l2/hailo_vsm.h"
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <tl/expected.hpp>
+#include <vector>
+
+// A dewarp (no DIS) mesh in its own DSP buffer, shared by reference between the mesh contexts of the process which
+// need the same mesh of the same sensor calibration. The buffer is released with the last reference.
+struct shared_dewarp_mesh_t
+{
+    dsp_dewarp_mesh_t mesh = {};
+
+    shared_dewarp_mesh_t() = default;
+    shared_dewarp_mesh_t(const shared_dewarp_mesh_t &) = delete;
+    shared_dewarp_mesh_t &operator=(const shared_dewarp_mesh_t &) = delete;
+    ~shared_dewarp_mesh_t();
+};
+using SharedDewarpMeshPtr = std::shared_ptr<shared_dewarp_mesh_t>;
+// A mesh returned by get(), held by the DSP operation using it - the mesh is not reused before it is released
+using DspDewarpMeshPtr = std::shared_ptr<dsp_dewarp_mesh_t>;
+
+// Mesh service of a dewarping element - hailovisionpreproc (pre_proc_op_configurations) or hailodewarp
+// (ldc_config_t). The sensor calibration and the dewarp meshes are shared across the contexts of the process,
+// while DIS, which follows the motion of its own stream, is per context.
+class DewarpMeshContext
+{
+private:
+    size_t m_input_width;
+    size_t m_input_height;
+    pre_proc_op_configurations m_pre_proc_configs;
+    // Pointer to internally allocated DIS instance. used for DIS library mesh generation
+    void *m_dis_ctx = nullptr;
+    // ring of dewarp mesh objects - the DSP reads the published one while the next one is generated in another.
+    // A mesh is free once only the ring holds it, the ring grows when all of them are held.
+    static constexpr size_t MESH_RING_SIZE = 3;
+    std::vector<SharedDewarpMeshPtr> m_meshes;
+    size_t m_ring_mesh_size = 0;
+    // mesh returned by get() - one of m_meshes or of the meshes of m_mesh_cache. Accessed with std::atomic_load and
+    // std::atomic_store.
+    DspDewarpMeshPtr m_published_mesh;
+    // LRU cache of dewarp meshes (most recent first), holding them so that switching between known
+    // rotation/flip/zoom states only publishes a pointer
+    static constexpr size_t MESH_CACHE_SIZE = 4;
+    std::list<std::pair<calibration_mesh_key_t, SharedDewarpMeshPtr>> m_mesh_cache;
+    uint64_t m_mesh_cache_hits = 0;
+    uint64_t m_mesh_cache_misses = 0;
+    // sensor calibration shared by the process, and the dewarp meshes stored with it across runs
+    std::shared_ptr<CalibrationCache> m_calibration_cache;
+    // DIS context not initialized, or initialized with a configuration or a magnification other than the current
+    // ones - see configure() and set_optical_zoom()
+    bool m_dis_ctx_stale = false;
+    // dimensions of the latest generated mesh (swapped by rotation)
+    size_t m_mesh_width = 0;
+    size_t m_mesh_height = 0;
+    // background mesh generation from the VSMs passed by on_frame_vsm_update(), oldest first. The VSMs of the frames
+    // which arrive while a mesh is generated each advance DIS, and only the mesh of the last one is generated.
+    std::thread m_mesh_worker;
+    std::mutex m_vsm_mutex;
+    std::condition_variable m_vsm_cv;
+    std::vector<struct hailo15_vsm> m_pending_vsms;
+    uint64_t m_skipped_vsm_meshes = 0;
+    bool m_stop_mesh_worker = false;
+    // optical zoom magnification level - used for dewarping
+    float m_magnification;
+    bool m_is_initialized = false;
+    std::shared_mutex m_mutex;
+
+    media_library_return
+    initialize_dewarp_mesh();
+    media_library_return generate_dis_mesh(struct hailo15_vsm &vsm);
+    media_library_return filter_dis_motion(struct hailo15_vsm &vsm);
+    SharedDewarpMeshPtr create_ring_mesh();
+    SharedDewarpMeshPtr get_free_ring_mesh();
+    void publish_mesh(SharedDewarpMeshPtr dsp_mesh, const DewarpT &mesh);
+    FlipMirrorRot get_flip_mirror_rot();
+    calibration_mesh_key_t get_mesh_key();
+    calibration_mesh_key_t get_dis_context_key();
+    bool publish_cached_mesh();
+    void cache_mesh(const calibration_mesh_key_t &key, SharedDewarpMeshPtr mesh);
+    tl::expected<SharedDewarpMeshPtr, media_library_return> acquire_shared_mesh(const calibration_mesh_key_t &key);
+    size_t get_known_mesh_size(const calibration_mesh_key_t &key);
+    SharedDewarpMeshPtr load_stored_mesh(const calibration_mesh_key_t &key);
+    tl::expected<SharedDewarpMeshPtr, media_library_return> generate_mesh(const calibration_mesh_key_t &key);
+    void mesh_worker_loop();
+    void stop_mesh_worker();
+    media_library_return open_calibration_cache();
+    media_library_return initialize_dis_context();
+    media_library_return reinitialize_dis_context();
+    media_library_return free_dis_context();
+    FlipMirrorRot get_flip_value(flip_direction_t flip_dir, rotation_angle_t rotation_angle);
+    static pre_proc_op_configurations to_pre_proc_configs(const ldc_config_t &ldc_configs);
+
+public:
+    size_t m_dewarp_output_width;
+    size_t m_dewarp_output_height;
+
+    DewarpMeshContext(pre_proc_op_configurations &config);
+    DewarpMeshContext(ldc_config_t &config);
+    ~DewarpMeshContext();
+    media_library_return configure(pre_proc_op_configurations &pre_proc_op_configs);
+    media_library_return configure(ldc_config_t &ldc_configs);
+    // Passes the VSM of a frame to DIS. With dis_config_t::background_mesh_generation, the mesh is generated in the
+    // background without waiting for it, so the frame is dewarped with the mesh of the previous VSMs.
+    media_library_return on_frame_vsm_update(struct hailo15_vsm &vsm);
+    media_library_return set_optical_zoom(float magnification);
+    // Returns the latest published mesh. It is not reused while the returned pointer is held.
+    DspDewarpMeshPtr get();
+};
\ No newline at end of file
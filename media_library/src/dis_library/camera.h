@@ -33,6 +33,7 @@
 #include "dis_math.h"
 
 #include <algorithm>
+#include <vector>
 
 struct Camera
 {
@@ -64,6 +65,11 @@ struct Camera
     /// @param pt point on camera sensor
     virtual vec3 point2ray(const vec2 &pt) const = 0;
 
+    /// @brief Selects between the exact projection and the faster, approximated one (lookup tables and polynomials).
+    /// Cameras without costly projection ignore it.
+    /// @param enable true for the fast projection
+    virtual void set_fast_projection(bool enable) { (void)enable; }
+
     virtual ~Camera(){};
 };
 
@@ -115,6 +121,18 @@ struct FishEye : Camera
     static constexpr float inv_theta_step = 1.f / theta_step;
     float theta2r[theta2r_size];
 
+    /// uniform radius step inverse LUTs, used by the fast projection
+    static constexpr int r2theta_size = 4097;
+    /// whether the fast projection is used, see set_fast_projection()
+    bool fast_projection = false;
+    /// radius covered by the inverse LUTs. Larger radii use the exact functions.
+    float r2theta_max = 0.f;
+    float inv_r_step = 0.f;
+    /// theta for radius = i * r2theta_max / (r2theta_size - 1)
+    std::vector<float> r2theta;
+    /// z coordinate of point2ray() for the same radii
+    std::vector<float> r2z;
+
     FishEye() { std::fill_n(theta2r, theta2r_size, 0.f); };
     FishEye(vec2 oc_, ivec2 res_, float (&theta2r_)[theta2r_size])
     {
@@ -128,6 +146,8 @@ struct FishEye : Camera
         std::copy_n(theta2r_, theta2r_size, theta2r);
         diag = vec2(res.x, res.y).len();
         flen = theta2r[1] / theta_step;
+        // the LUTs of the fast projection belong to the previous calibration - see set_fast_projection()
+        fast_projection = false;
         fov = 2 * rad2theta(diag / 2);
 
         // calc input camera left,top,bottom,right FOVs
@@ -144,10 +164,50 @@ struct FishEye : Camera
         diag_ltrb[3] = rad2theta(std::hypotf(oc.x, res.y - oc.y));
     };
 
+    void set_fast_projection(bool enable) override
+    {
+        fast_projection = enable;
+        if (fast_projection)
+            build_inverse_luts();
+    }
+
+    /// @brief Fills the uniform radius step LUTs r2theta and r2z from the exact functions. They cover radii up to
+    /// the image diagonal - further than any point of the image from the optical center - but stop before theta
+    /// gets close to 180 deg, where r / tan(theta) of point2ray() diverges.
+    void build_inverse_luts()
+    {
+        r2theta_max = std::min(theta2rad(RADIANS(160.f)), diag);
+        if (r2theta_max <= 0.f)
+        {
+            fast_projection = false;
+            return;
+        }
+        float r_step = r2theta_max / (r2theta_size - 1);
+        inv_r_step = 1.f / r_step;
+        r2theta.resize(r2theta_size);
+        r2z.resize(r2theta_size);
+        for (int i = 0; i < r2theta_size; i++)
+        {
+            float radius = i * r_step;
+            float theta = rad2theta_exact(radius);
+            r2theta[i] = theta;
+            r2z[i] = theta == 0 ? flen : radius / std::tan(theta);
+        }
+    }
+
     /// @brief Finds radius corresponding to an angle
     ///
     /// @param radius radius
     float rad2theta(float radius) const
+    {
+        if (fast_projection && radius >= 0.f && radius < r2theta_max)
+            return interpolate_inverse_lut(r2theta, radius);
+        return rad2theta_exact(radius);
+    }
+    /// @brief rad2theta() by a binary search in theta2r
+    ///
+    /// @param radius radius
+    float rad2theta_exact(float radius) const
     {
         int i = std::lower_bound(std::begin(theta2r), std::end(theta2r) - 2,
                                  radius) -
@@ -165,6 +225,17 @@ struct FishEye : Camera
         fi -= i;
         return theta2r[i] * (1.f - fi) + theta2r[i + 1] * fi;
     }
+    /// @brief Linear interpolation in one of the uniform radius step LUTs
+    ///
+    /// @param lut r2theta or r2z
+    /// @param radius radius in [0, r2theta_max)
+    float interpolate_inverse_lut(const std::vector<float> &lut, float radius) const
+    {
+        float fi = radius * inv_r_step;
+        int i = std::min(int(fi), r2theta_size - 2);
+        fi -= i;
+        return lut[i] * (1.f - fi) + lut[i + 1] * fi;
+    }
 
     vec2 ray2point(const vec3 &ray) const override
     {
@@ -172,7 +243,7 @@ struct FishEye : Camera
         float rad = pt.len();
         if (rad == 0)
             return oc;
-        float theta = atan2f(rad, ray.z);
+        float theta = fast_projection ? fast_atan2(rad, ray.z) : atan2f(rad, ray.z);
         return oc + pt * (theta2rad(theta) / rad);
     }
 
@@ -180,6 +251,8 @@ struct FishEye : Camera
     {
         vec2 pc(pt.x - oc.x, pt.y - oc.y);
         float rad = pc.len();
+        if (fast_projection && rad < r2theta_max)
+            return vec3(pc.x, pc.y, interpolate_inverse_lut(r2z, rad));
         float theta = rad2theta(rad);
         if (theta == 0)
             return vec3(0, 0, flen);
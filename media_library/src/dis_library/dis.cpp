@@ -31,6 +31,13 @@
 
 #include <map>
 #include <sstream>
+#include <thread>
+
+/// Maximal number of threads sharing the projection of a grid.
+static constexpr int MAX_GRID_THREADS = 4;
+/// Minimal number of vertexes given to a single thread. Smaller grids are not worth the synchronization - a 4K grid
+/// of 64 pixel cells (61x35 vertexes) is projected faster on a single thread.
+static constexpr int MIN_VERTEXES_PER_THREAD = 4096;
 
 /// Map from the possible FlipMirrorRot values to their corresponding rotation matrices.
 const std::map<int, mat2> ROT_MAT_MAP = {
@@ -190,6 +197,11 @@ RetCodes DIS::init(int out_width, int out_height, camera_type_t camera_type, flo
         out_cam = std::make_unique<FishEye>(FishEye(oc, ivec2(out_width, out_height), theta2r));
     }
 
+    // the interpolation error is measured against the exact camera models, before switching to the fast ones
+    report_mesh_density();
+    in_cam.set_fast_projection(cfg.fast_camera_model);
+    out_cam->set_fast_projection(cfg.fast_camera_model);
+
     const float ONE_DEG_IN_RADS = RADIANS(1.0f);
 
     room4stab[0] = in_cam.ltrb[0] - out_cam->ltrb[0];
@@ -229,11 +241,83 @@ RetCodes DIS::init(int out_width, int out_height, camera_type_t camera_type, flo
     //    for (int i = 0; i < cfg.FMV_HISTORY_LEN; i++)
     //        motion_vecs.push_back(vec2{0,0});
 
+    // rays depend on out_cam
+    out_rays = RaysSoA();
+    out_rays_cache.clear();
+
+    if (!grid_workers)
+    {
+        int num_threads = clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, MAX_GRID_THREADS);
+        grid_workers = std::make_unique<GridWorkerPool>(num_threads);
+    }
+
     last_flip_mirror_rot = NATURAL;
     initialized = true;
     return DIS_OK;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// report_mesh_density()
+///////////////////////////////////////////////////////////////////////////////
+void DIS::report_mesh_density()
+{
+    cell_max_error = interpolation_error(cell_size);
+    LOG("mesh cell %d pix (grid %dx%d), max interpolation error %.3f pix", cell_size,
+        1 + (out_cam->res.x + cell_size - 1) / cell_size, 1 + (out_cam->res.y + cell_size - 1) / cell_size,
+        cell_max_error);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// interpolation_error()
+///////////////////////////////////////////////////////////////////////////////
+float DIS::interpolation_error(int cell) const
+{
+    // The DSP interpolates the input coordinates bilinearly between the grid vertexes. Compare that with the exact
+    // projection at the cell centers and edge midpoints, where the interpolation error peaks, in the natural
+    // orientation without stabilization. Points projected outside of the input image are black anyway - skipped.
+    auto project = [this](float x, float y) {
+        vec2 pt(x, y);
+#if GRID_IS_IN_PIX_INDEXES
+        pt = pt + vec2(0.5f, 0.5f); // convert index to coordinate
+#endif
+        return in_cam.ray2point(out_cam->point2ray(pt));
+    };
+
+    const int grid_w = 1 + (out_cam->res.x + cell - 1) / cell;
+    const int grid_h = 1 + (out_cam->res.y + cell - 1) / cell;
+    std::vector<vec2> vertexes(grid_w * grid_h);
+    for (int y = 0; y < grid_h; y++)
+        for (int x = 0; x < grid_w; x++)
+            vertexes[y * grid_w + x] = project(x * cell, y * cell);
+
+    const vec2 samples[] = {{0.5f, 0.5f}, {0.5f, 0.f}, {0.f, 0.5f}};
+    float max_error = 0.f;
+    for (int y = 0; y < grid_h - 1; y++)
+    {
+        for (int x = 0; x < grid_w - 1; x++)
+        {
+            const vec2 &v00 = vertexes[y * grid_w + x];
+            const vec2 &v10 = vertexes[y * grid_w + x + 1];
+            const vec2 &v01 = vertexes[(y + 1) * grid_w + x];
+            const vec2 &v11 = vertexes[(y + 1) * grid_w + x + 1];
+            for (const vec2 &f : samples)
+            {
+                float px = (x + f.x) * cell;
+                float py = (y + f.y) * cell;
+                if (px >= out_cam->res.x || py >= out_cam->res.y)
+                    continue;
+                vec2 exact = project(px, py);
+                if (exact.x < 0.f || exact.y < 0.f || exact.x >= in_cam.res.x || exact.y >= in_cam.res.y)
+                    continue;
+                vec2 interpolated = v00 * ((1 - f.x) * (1 - f.y)) + v10 * (f.x * (1 - f.y)) +
+                                    v01 * ((1 - f.x) * f.y) + v11 * (f.x * f.y);
+                max_error = std::max(max_error, (interpolated - exact).len());
+            }
+        }
+    }
+    return max_error;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // gen_resize_grid()
 // Osed for debug. generate grid, which only resizes the input image into the output one
@@ -244,7 +328,7 @@ void DIS::gen_resize_grid(DewarpT &grid)
     for (int r = 0; r < grid.mesh_height; r++)
         for (int c = 0; c < grid.mesh_width; c++)
         {
-            vec2 pt(c * MESH_CELL_SIZE_PIX, r * MESH_CELL_SIZE_PIX);
+            vec2 pt(c * cell_size, r * cell_size);
 #if GRID_IS_IN_PIX_INDEXES
             pt = pt + vec2(0.5f, 0.5f); // convert index to coordinate
 #endif
@@ -268,9 +352,51 @@ RetCodes DIS::generate_grid(vec2 fmv, int32_t panning,
     if (cfg.debug.generate_resize_grid)
     { // generate grid, which only resizes the input image into the output one
         gen_resize_grid(grid);
+        num_bases = 0;
         return DIS_OK;
     }
 
+    float stab_lo, stab_la;
+    RetCodes ret = stabilize(fmv, stab_lo, stab_la);
+    if (ret != DIS_OK)
+        return ret;
+
+    // if the output rotation is changed, swap the grid size and re-calculate output rays - see calc_out_rays()
+    int cur_flip_mirror_rot = static_cast<int>(flip_mirror_rot);
+    if (cur_flip_mirror_rot != last_flip_mirror_rot)
+    {
+        if ((cur_flip_mirror_rot - last_flip_mirror_rot) % 2 != 0)
+        {
+            std::swap(grid.mesh_width, grid.mesh_height);
+        }
+        last_flip_mirror_rot = cur_flip_mirror_rot;
+        calc_out_rays(grid.mesh_width, grid.mesh_height, cell_size, flip_mirror_rot);
+        num_bases = 0;
+    }
+
+    // project out-vertexes rays and generate grid
+    update_grid(stab_lo, stab_la, grid);
+
+    return DIS_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// filter_motion()
+///////////////////////////////////////////////////////////////////////////////
+RetCodes DIS::filter_motion(vec2 fmv, int32_t panning)
+{
+    if (cfg.debug.generate_resize_grid)
+        return DIS_OK; // resize grids are not stabilized
+
+    float stab_lo, stab_la;
+    return stabilize(fmv, stab_lo, stab_la);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// stabilize()
+///////////////////////////////////////////////////////////////////////////////
+RetCodes DIS::stabilize(vec2 fmv, float &stab_lo, float &stab_la)
+{
     if (std::abs(fmv.x) > in_cam.res.x * 0.5f || std::abs(fmv.y) > in_cam.res.y * 0.5f)
     {
         LOGE("fmv with impossible value %f.1 %.1f", fmv.x, fmv.y);
@@ -329,8 +455,8 @@ RetCodes DIS::generate_grid(vec2 fmv, int32_t panning,
     }
 
     // stabilizing rotation is the difference between actual and stabilized orientation
-    float stab_la = filt_la - in_la;
-    float stab_lo = filt_lo - in_lo;
+    stab_la = filt_la - in_la;
+    stab_lo = filt_lo - in_lo;
 
     if (!cfg.debug.fix_stabilization && cfg.black_corners_correction_enabled)
     {
@@ -375,44 +501,6 @@ RetCodes DIS::generate_grid(vec2 fmv, int32_t panning,
         k = std::max(cfg.minimun_coefficient_filter, k - cfg.decrement_coefficient_threshold);
     }
 
-    // convert stabilizing rotation from longitude/latitude to rotation matrix
-    float cos_lo = std::cos(stab_lo);
-    float sin_lo = std::sin(stab_lo);
-    float cos_la = std::cos(stab_la);
-    float sin_la = std::sin(stab_la);
-    mat3 stab_rot = {cos_lo, 0, sin_lo,
-                     -sin_la * sin_lo, cos_la, sin_la * cos_lo,
-                     -cos_la * sin_lo, -sin_la, cos_la * cos_lo};
-
-    // if the output rotation is changed, swap the grid size and re-calculate output rays - see calc_out_rays()
-    int cur_flip_mirror_rot = static_cast<int>(flip_mirror_rot);
-    if (cur_flip_mirror_rot != last_flip_mirror_rot)
-    {
-        if ((cur_flip_mirror_rot - last_flip_mirror_rot) % 2 != 0)
-        {
-            std::swap(grid.mesh_width, grid.mesh_height);
-        }
-        last_flip_mirror_rot = cur_flip_mirror_rot;
-        calc_out_rays(grid.mesh_width, grid.mesh_height, MESH_CELL_SIZE_PIX, flip_mirror_rot);
-    }
-
-    // project out-vertexes rays and generate grid
-    for (int y = 0; y < grid.mesh_height; y++)
-    {
-        for (int x = 0; x < grid.mesh_width; x++)
-        {
-            int ind = y * grid.mesh_width + x;
-
-            vec2 pt = in_cam.ray2point(stab_rot * out_rays[ind]);
-#if GRID_IS_IN_PIX_INDEXES
-            pt = pt - vec2(0.5f, 0.5f); // convert coordinate to index
-#endif
-
-            grid.mesh_table[ind * 2] = pt.x * (1 << MESH_FRACT_BITS);     // x
-            grid.mesh_table[ind * 2 + 1] = pt.y * (1 << MESH_FRACT_BITS); // y
-        }
-    }
-
     frame_cnt++;
 
     return DIS_OK;
@@ -427,6 +515,7 @@ RetCodes DIS::dewarp_only_grid(FlipMirrorRot flip_mirror_rot,
     if (cfg.debug.generate_resize_grid)
     { // generate grid, which only resizes the input image into the output one
         gen_resize_grid(grid);
+        num_bases = 0;
         return DIS_OK;
     }
 
@@ -439,28 +528,175 @@ RetCodes DIS::dewarp_only_grid(FlipMirrorRot flip_mirror_rot,
             std::swap(grid.mesh_width, grid.mesh_height);
         }
         last_flip_mirror_rot = cur_flip_mirror_rot;
-        calc_out_rays(grid.mesh_width, grid.mesh_height, MESH_CELL_SIZE_PIX, flip_mirror_rot);
+        calc_out_rays(grid.mesh_width, grid.mesh_height, cell_size, flip_mirror_rot);
     }
 
-    for (int y = 0; y < grid.mesh_height; y++)
+    const mat3 no_rot = {1, 0, 0,
+                         0, 1, 0,
+                         0, 0, 1};
+    project_grid(no_rot, grid);
+    num_bases = 0;
+
+    frame_cnt++;
+
+    return DIS_OK;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// stab_rotation
+///////////////////////////////////////////////////////////////////////////////
+/// converts stabilizing rotation from longitude/latitude to rotation matrix
+static mat3 stab_rotation(float stab_lo, float stab_la)
+{
+    float cos_lo = std::cos(stab_lo);
+    float sin_lo = std::sin(stab_lo);
+    float cos_la = std::cos(stab_la);
+    float sin_la = std::sin(stab_la);
+    return {cos_lo, 0, sin_lo,
+            -sin_la * sin_lo, cos_la, sin_la * cos_lo,
+            -cos_la * sin_lo, -sin_la, cos_la * cos_lo};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// update_grid
+///////////////////////////////////////////////////////////////////////////////
+void DIS::update_grid(float stab_lo, float stab_la, DewarpT &grid)
+{
+    // thresholds are configured in input pixels near the optical center, where 1 rad ~ flen pixels
+    const float reuse_thr = cfg.mesh_reuse_threshold / in_cam.flen;
+    const float correction_thr = cfg.mesh_correction_threshold / in_cam.flen;
+
+    if (num_bases > 0)
     {
-        for (int x = 0; x < grid.mesh_width; x++)
+        if (std::abs(stab_lo - grid_lo) < reuse_thr && std::abs(stab_la - grid_la) < reuse_thr)
         {
-            int ind = y * grid.mesh_width + x;
-
-            vec2 pt = in_cam.ray2point(out_rays[ind]); // xi, yi
-#if GRID_IS_IN_PIX_INDEXES
-            pt = pt - vec2(0.5f, 0.5f); // convert coordinate to index
-#endif
+            // sub-threshold motion (e.g. static camera) - the last grid is good enough. The caller may rotate
+            // between a few mesh buffers, so write it again if mesh_table is not the one written last time.
+            if (grid.mesh_table != last_mesh_table)
+            {
+                write_base_grid(grid_lo, grid_la, grid);
+                last_mesh_table = grid.mesh_table;
+            }
+            mesh_stats.skipped++;
+            return;
+        }
 
-            grid.mesh_table[ind * 2] = pt.x * (1 << MESH_FRACT_BITS);     // x
-            grid.mesh_table[ind * 2 + 1] = pt.y * (1 << MESH_FRACT_BITS); // y
+        const grid_base_t &base = bases[base_index];
+        if (std::abs(stab_lo - base.lo) < correction_thr && std::abs(stab_la - base.la) < correction_thr &&
+            calc_base_derivatives())
+        {
+            write_base_grid(stab_lo, stab_la, grid);
+            grid_lo = stab_lo;
+            grid_la = stab_la;
+            last_mesh_table = grid.mesh_table;
+            mesh_stats.corrected++;
+            return;
         }
     }
 
-    frame_cnt++;
+    project_grid(stab_rotation(stab_lo, stab_la), grid);
+    mesh_stats.regenerated++;
+    grid_lo = stab_lo;
+    grid_la = stab_la;
 
-    return DIS_OK;
+    // keep the grid as a base for the next frames only if they may use it
+    if (reuse_thr > 0.f || correction_thr > 0.f)
+    {
+        base_index = (base_index + 1) % NUM_GRID_BASES;
+        grid_base_t &base = bases[base_index];
+        base.lo = stab_lo;
+        base.la = stab_la;
+        base.table.assign(grid.mesh_table, grid.mesh_table + grid.mesh_width * grid.mesh_height * 2);
+        num_bases = std::min(num_bases + 1, NUM_GRID_BASES);
+        base_derivatives_state = 0;
+        last_mesh_table = grid.mesh_table;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// write_base_grid
+///////////////////////////////////////////////////////////////////////////////
+void DIS::write_base_grid(float lo, float la, DewarpT &grid)
+{
+    const grid_base_t &base = bases[base_index];
+    const int num_values = static_cast<int>(base.table.size());
+    if (lo == base.lo && la == base.la)
+    {
+        std::copy(base.table.begin(), base.table.end(), grid.mesh_table);
+        return;
+    }
+
+    const float d_lo = lo - base.lo;
+    const float d_la = la - base.la;
+    for (int i = 0; i < num_values; i++)
+    {
+        grid.mesh_table[i] = base.table[i] + static_cast<int>(base_d_lo[i] * d_lo + base_d_la[i] * d_la);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// calc_base_derivatives
+///////////////////////////////////////////////////////////////////////////////
+bool DIS::calc_base_derivatives()
+{
+    if (base_derivatives_state != 0)
+        return base_derivatives_state > 0;
+    base_derivatives_state = -1;
+    if (num_bases < NUM_GRID_BASES)
+        return false;
+
+    // The derivatives are the affine model through the last three fully generated grids - no extra projection.
+    // The previous grids must be close to the latest one for a linear model, and in different directions from it.
+    const grid_base_t &base = bases[base_index];
+    const grid_base_t &prev1 = bases[(base_index + NUM_GRID_BASES - 1) % NUM_GRID_BASES];
+    const grid_base_t &prev2 = bases[(base_index + NUM_GRID_BASES - 2) % NUM_GRID_BASES];
+    const float v1_lo = prev1.lo - base.lo, v1_la = prev1.la - base.la;
+    const float v2_lo = prev2.lo - base.lo, v2_la = prev2.la - base.la;
+    const float len1 = std::hypot(v1_lo, v1_la);
+    const float len2 = std::hypot(v2_lo, v2_la);
+    const float det = v1_lo * v2_la - v1_la * v2_lo;
+    const float max_span = GRID_BASES_MAX_SPAN * cfg.mesh_correction_threshold / in_cam.flen;
+    if (len1 > max_span || len2 > max_span || std::abs(det) < GRID_BASES_MIN_SIN * len1 * len2)
+        return false;
+
+    const int num_values = static_cast<int>(base.table.size());
+    const float inv_det = 1.f / det;
+    base_d_lo.resize(num_values);
+    base_d_la.resize(num_values);
+    for (int i = 0; i < num_values; i++)
+    {
+        float d1 = static_cast<float>(prev1.table[i] - base.table[i]);
+        float d2 = static_cast<float>(prev2.table[i] - base.table[i]);
+        base_d_lo[i] = (d1 * v2_la - d2 * v1_la) * inv_det;
+        base_d_la[i] = (d2 * v1_lo - d1 * v2_lo) * inv_det;
+    }
+    base_derivatives_state = 1;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// project_grid
+///////////////////////////////////////////////////////////////////////////////
+void DIS::project_grid(const mat3 &rot, DewarpT &grid)
+{
+    const int width = grid.mesh_width;
+    const int height = grid.mesh_height;
+    int num_threads = grid_workers ? grid_workers->size() : 1;
+    num_threads = clamp(width * height / MIN_VERTEXES_PER_THREAD, 1, std::min(num_threads, height));
+    if (num_threads == 1)
+    {
+        project_rays(in_cam, rot, out_rays, 0, width * height, grid.mesh_table);
+        return;
+    }
+
+    // split by rows, each thread writes its own part of mesh_table
+    const int rows_per_thread = (height + num_threads - 1) / num_threads;
+    grid_workers->run(num_threads, [&](int task) {
+        int row_begin = task * rows_per_thread;
+        int row_end = std::min(height, row_begin + rows_per_thread);
+        if (row_begin < row_end)
+            project_rays(in_cam, rot, out_rays, row_begin * width, row_end * width, grid.mesh_table);
+    });
 }
 ///////////////////////////////////////////////////////////////////////////////
 // calc_out_rays
@@ -473,10 +709,21 @@ void DIS::calc_out_rays(int grid_w, int grid_h, int grid_sq, FlipMirrorRot flip_
     // Output image rotation is not related to the output camera - it is implemented as output image rotation,
     // i.e. es if the output image is generated without rotation (out_cam does not knoa about it) and then the
     // image is rotated/flipped/mirrored.
-    if (out_rays.size() != (uint32_t)(grid_w * grid_h))
+    auto key = std::make_tuple(static_cast<int>(flip_mirror_rot), grid_w, grid_h);
+    if (out_rays.size() > 0)
+    {
+        out_rays_cache[out_rays_key] = std::move(out_rays);
+    }
+    out_rays_key = key;
+    auto cached = out_rays_cache.find(key);
+    if (cached != out_rays_cache.end())
     {
-        out_rays.resize(grid_w * grid_h);
+        out_rays = std::move(cached->second);
+        out_rays_cache.erase(cached);
+        return;
     }
+    out_rays = RaysSoA();
+    out_rays.resize(grid_w * grid_h);
 
     mat2 rot_mat = ROT_MAT_MAP.at(static_cast<int>(flip_mirror_rot));
 
@@ -498,7 +745,7 @@ void DIS::calc_out_rays(int grid_w, int grid_h, int grid_sq, FlipMirrorRot flip_
             vec2 pt = rot_mat * pto + gc_cam;
 
             vec3 ray = out_cam->point2ray(pt);
-            out_rays[y * grid_w + x] = ray;
+            out_rays.set(y * grid_w + x, ray);
         }
     }
 }
@@ -33,10 +33,14 @@
 #include "dewarp.h"
 #include "dis_common.h"
 #include "dis_math.h"
+#include "grid_projection.h"
+#include "grid_worker_pool.h"
 #include "interface_types.h"
 #include <array>
 #include <deque>
+#include <map>
 #include <memory>
+#include <tuple>
 #include <vector>
 
 #ifndef GRID_IS_IN_PIX_INDEXES
@@ -73,7 +77,19 @@ private:
     /// out_cam orientation does not depend on the flip/mirrir/rot. Its resolution is as passed to dis_init()
     std::unique_ptr<Camera> out_cam;
     /// Rays in output camera through grid vertices
-    std::vector<vec3> out_rays;
+    RaysSoA out_rays;
+    /// (flip_mirror_rot, grid width, grid height) out_rays were calculated for
+    std::tuple<int, int, int> out_rays_key{-1, 0, 0};
+    /// out_rays of the other flip/mirror/rot states calculated so far, so that switching back to one of them does
+    /// not recalculate the rays. At most 8 entries - one per FlipMirrorRot.
+    std::map<std::tuple<int, int, int>, RaysSoA> out_rays_cache;
+    /// Output grid cell size in pixels. dsp_dewarp_mesh_t does not carry the cell size, the DSP dewarp assumes
+    /// MESH_CELL_SIZE_PIX.
+    int cell_size = MESH_CELL_SIZE_PIX;
+    /// Maximal interpolation error of a grid of cell_size, pixels of the input image
+    float cell_max_error = 0.f;
+    /// Threads sharing the per-frame grid projection. Created in init().
+    std::unique_ptr<GridWorkerPool> grid_workers;
 
     /// actual camera orientation, accumulated from frame-to-frame MVs, radians
     float in_la = 0;
@@ -115,6 +131,33 @@ private:
     /// stabilized frame counter
     int frame_cnt = 0;
 
+    /// Change detection of the stabilizing rotation, see update_grid().
+    /// A fully generated grid and the stabilizing rotation it was generated for
+    struct grid_base_t
+    {
+        float lo = 0.f, la = 0.f;
+        std::vector<int> table;
+    };
+    static constexpr int NUM_GRID_BASES = 3;
+    /// previous bases may be used for the derivatives up to this many correction thresholds from the latest one
+    static constexpr float GRID_BASES_MAX_SPAN = 4.f;
+    /// minimal sine of the angle between the directions of the previous bases from the latest one
+    static constexpr float GRID_BASES_MIN_SIN = 0.25f;
+    /// the last fully generated grids of the current flip/mirror/rot, the latest at base_index
+    std::array<grid_base_t, NUM_GRID_BASES> bases;
+    int base_index = 0;
+    int num_bases = 0;
+    /// mesh_table last written by update_grid(). The caller may pass a different buffer on each frame.
+    const int *last_mesh_table = nullptr;
+    /// stabilizing rotation the grid in mesh_table currently corresponds to
+    float grid_lo = 0.f, grid_la = 0.f;
+    /// derivatives of the latest base wrt the longitude/latitude of the stabilizing rotation, see
+    /// calc_base_derivatives(). State 0 - not calculated yet, 1 - calculated, -1 - the bases do not allow them.
+    std::vector<float> base_d_lo, base_d_la;
+    int base_derivatives_state = 0;
+    /// how the grids were produced
+    dis_mesh_stats_t mesh_stats;
+
 public:
     DIS(){};
 
@@ -148,12 +191,62 @@ public:
     /// @param grid output grid
     RetCodes generate_grid(vec2 fmv, int32_t panning, FlipMirrorRot flip_mirror_rot, DewarpT &grid);
 
+    /// @brief Advances the stabilization filter by the frame motion vector like generate_grid(), without
+    /// calculating the grid. Used for frames whose grid is not needed.
+    /// @param fmv motion vector per frame
+    /// @param panning panning per frame
+    RetCodes filter_motion(vec2 fmv, int32_t panning);
+
+    /// @brief Returns how the grids were produced by generate_grid() so far
+    dis_mesh_stats_t get_mesh_stats() const { return mesh_stats; }
+
+    /// @brief Returns the output grid cell size and its interpolation error, measured by init()
+    dis_mesh_density_t get_mesh_density() const { return {cell_size, cell_max_error}; }
+
+    /// @brief Returns the orientation tracked by generate_grid() after the last frame
+    dis_stabilization_t get_stabilization() const { return {in_lo, in_la, filt_lo, filt_la, k}; }
+
     /// @brief Calculates grid for dewarping the input frame only.
     /// @param flip_mirror_rot as applied on the output image
     /// @param grid output grid
     RetCodes dewarp_only_grid(FlipMirrorRot flip_mirror_rot, DewarpT &grid);
 
 private:
+    /// @brief Advances the stabilization filter by the frame motion vector and calculates the stabilizing rotation
+    /// of the frame.
+    /// @param fmv motion vector per frame
+    /// @param stab_lo output stabilizing rotation angle (longitude)
+    /// @param stab_la output stabilizing rotation angle (latitude)
+    RetCodes stabilize(vec2 fmv, float &stab_lo, float &stab_la);
+
+    /// @brief Projects the output rays rotated by rot onto the input camera and fills grid.mesh_table. Large grids
+    /// are split into row ranges executed in parallel by grid_workers.
+    /// @param rot rotation applied on the output rays
+    /// @param grid output grid
+    void project_grid(const mat3 &rot, DewarpT &grid);
+
+    /// @brief Brings grid to the stabilizing rotation stab_lo, stab_la. According to how much the rotation moved, the
+    /// grid is either left as is, corrected to the first order from the last fully generated one, or fully projected.
+    /// @param stab_lo stabilizing rotation angle (longitude)
+    /// @param stab_la stabilizing rotation angle (latitude)
+    /// @param grid output grid
+    void update_grid(float stab_lo, float stab_la, DewarpT &grid);
+
+    /// @brief Writes the latest base corrected to the first order to the rotation lo, la into grid.
+    void write_base_grid(float lo, float la, DewarpT &grid);
+
+    /// @brief Fills base_d_lo, base_d_la from the differences between the last three bases, once per base.
+    /// @return whether the derivatives are available - the previous bases may be too far or on a line
+    bool calc_base_derivatives();
+
+    /// @brief Sets cell_max_error of the grid and logs the grid density. out_cam must be created first.
+    void report_mesh_density();
+
+    /// @brief Maximal distance between the bilinear interpolation of a grid of the given cell size and the exact
+    /// projection of the output pixels onto the input image, in pixels.
+    /// @param cell grid cell size in pixels
+    float interpolation_error(int cell) const;
+
     /// @brief Generates grid, which only resizes the input image into the output one. Used for debug.
     void gen_resize_grid(DewarpT &grid);
 
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file dis_grid_benchmark.cpp
+ * @brief Measures the per-frame cost of the DIS grid projection at 4K output and checks the vectorized
+ * implementation against the scalar reference. Does the same for the fast camera model functions (lookup tables and
+ * polynomials) against the exact ones.
+ *
+ * Usage: dis_grid_benchmark [frames]
+ **/
+#include "dewarp.h"
+#include "grid_projection.h"
+#include "grid_worker_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+constexpr int OUT_WIDTH = 3840;
+constexpr int OUT_HEIGHT = 2160;
+/// Maximal allowed difference from the reference - 1/256 pixel
+constexpr int MAX_DIFF = (1 << MESH_FRACT_BITS) / 256;
+/// Maximal allowed angle error of the fast camera model, rad
+constexpr float MAX_ANGLE_ERR = 1e-5f;
+
+template <typename Func>
+double measure_us(int frames, Func func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+        func(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / frames;
+}
+
+mat3 stab_rotation(int frame)
+{
+    // small shaking rotation, different on every frame
+    float lo = 0.01f * std::sin(frame * 0.37f);
+    float la = 0.01f * std::cos(frame * 0.23f);
+    float cos_lo = std::cos(lo), sin_lo = std::sin(lo);
+    float cos_la = std::cos(la), sin_la = std::sin(la);
+    return {cos_lo, 0, sin_lo,
+            -sin_la * sin_lo, cos_la, sin_la * cos_lo,
+            -cos_la * sin_lo, -sin_la, cos_la * cos_lo};
+}
+
+/// @brief Compares the fast camera model of a copy of cam with the exact one, prints the errors and timings.
+/// @return true if the errors are within the limits
+bool check_fast_camera_model(const FishEye &cam, int samples)
+{
+    FishEye fast_cam = cam;
+    fast_cam.set_fast_projection(true);
+    const float max_radius = cam.diag * 0.5f;
+    volatile float sink = 0.f;
+
+    float rad2theta_err = 0.f;
+    for (int i = 0; i < samples; i++)
+    {
+        float radius = max_radius * i / samples;
+        rad2theta_err = std::max(rad2theta_err, std::abs(fast_cam.rad2theta(radius) - cam.rad2theta(radius)));
+    }
+    float point_err = 0.f, ray_err = 0.f;
+    for (int i = 0; i < samples; i++)
+    {
+        vec2 pt(cam.res.x * float(i % 97) / 96, cam.res.y * float(i % 89) / 88);
+        vec3 exact_ray = cam.point2ray(pt);
+        vec3 fast_ray = fast_cam.point2ray(pt);
+        // compare directions - the rays are not normalized
+        ray_err = std::max(ray_err, std::abs(std::atan2(vec2(fast_ray.x, fast_ray.y).len(), fast_ray.z) -
+                                             std::atan2(vec2(exact_ray.x, exact_ray.y).len(), exact_ray.z)));
+        vec2 exact_pt = cam.ray2point(exact_ray);
+        vec2 fast_pt = fast_cam.ray2point(exact_ray);
+        point_err = std::max(point_err, (fast_pt - exact_pt).len());
+    }
+
+    auto time_ns = [&](const FishEye &c, int func) {
+        return 1000.0 * measure_us(samples, [&](int i) {
+                   float radius = max_radius * i / samples;
+                   vec2 pt(c.oc.x + radius * 0.6f, c.oc.y + radius * 0.8f);
+                   if (func == 0)
+                       sink = sink + c.rad2theta(radius);
+                   else if (func == 1)
+                       sink = sink + c.point2ray(pt).z;
+                   else
+                       sink = sink + c.ray2point(vec3(pt.x - c.oc.x, pt.y - c.oc.y, c.flen)).x;
+               });
+    };
+    printf("camera model       exact ns   fast ns   max error\n");
+    printf("rad2theta        %9.2f %9.2f   %.2e rad\n", time_ns(cam, 0), time_ns(fast_cam, 0), rad2theta_err);
+    printf("point2ray        %9.2f %9.2f   %.2e rad\n", time_ns(cam, 1), time_ns(fast_cam, 1), ray_err);
+    printf("ray2point        %9.2f %9.2f   %.2e pixels\n", time_ns(cam, 2), time_ns(fast_cam, 2), point_err);
+
+    return rad2theta_err < MAX_ANGLE_ERR && ray_err < MAX_ANGLE_ERR && point_err < 1.f / 256;
+}
+
+int max_diff(const std::vector<int> &a, const std::vector<int> &b)
+{
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); i++)
+        diff = std::max(diff, std::abs(a[i] - b[i]));
+    return diff;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 1000;
+    if (frames <= 0)
+    {
+        printf("Usage: %s [frames]\n", argv[0]);
+        return 1;
+    }
+
+    // input fisheye camera with mild barrel distortion on top of the equidistant model
+    float theta2r[FishEye::theta2r_size];
+    for (int i = 0; i < FishEye::theta2r_size; i++)
+    {
+        float theta = i * FishEye::theta_step;
+        theta2r[i] = 1100.f * (theta + 0.02f * theta * theta * theta);
+    }
+    FishEye in_cam(vec2(1920.f, 1080.f), ivec2(3840, 2160), theta2r);
+    PinHole out_cam(1800.f, vec2(OUT_WIDTH * 0.5f, OUT_HEIGHT * 0.5f), ivec2(OUT_WIDTH, OUT_HEIGHT));
+
+    const int width = 1 + (OUT_WIDTH + MESH_CELL_SIZE_PIX - 1) / MESH_CELL_SIZE_PIX;
+    const int height = 1 + (OUT_HEIGHT + MESH_CELL_SIZE_PIX - 1) / MESH_CELL_SIZE_PIX;
+    const int vertexes = width * height;
+    RaysSoA rays;
+    rays.resize(vertexes);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            rays.set(y * width + x, out_cam.point2ray(vec2(x * MESH_CELL_SIZE_PIX + 0.5f, y * MESH_CELL_SIZE_PIX + 0.5f)));
+
+    std::vector<int> reference(vertexes * 2), simd(vertexes * 2), pooled(vertexes * 2);
+    GridWorkerPool pool(std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, 4));
+    const int rows_per_thread = (height + pool.size() - 1) / pool.size();
+
+    double reference_us = measure_us(frames, [&](int frame) {
+        project_rays_reference(in_cam, stab_rotation(frame), rays, 0, vertexes, reference.data());
+    });
+    double simd_us = measure_us(frames, [&](int frame) {
+        project_rays(in_cam, stab_rotation(frame), rays, 0, vertexes, simd.data());
+    });
+    double pooled_us = measure_us(frames, [&](int frame) {
+        mat3 rot = stab_rotation(frame);
+        pool.run(pool.size(), [&](int task) {
+            int row_begin = task * rows_per_thread;
+            int row_end = std::min(height, row_begin + rows_per_thread);
+            if (row_begin < row_end)
+                project_rays(in_cam, rot, rays, row_begin * width, row_end * width, pooled.data());
+        });
+    });
+
+    int diff = std::max(max_diff(reference, simd), max_diff(reference, pooled));
+    printf("grid %dx%d (%d vertexes), %d frames\n", width, height, vertexes, frames);
+    printf("reference:        %8.2f us/frame\n", reference_us);
+    printf("vectorized:       %8.2f us/frame\n", simd_us);
+    printf("vectorized x %d:   %8.2f us/frame\n", pool.size(), pooled_us);
+    printf("max difference:   %d (%.5f pixels)\n", diff, float(diff) / (1 << MESH_FRACT_BITS));
+
+    bool camera_ok = check_fast_camera_model(in_cam, 100000);
+
+    return diff <= MAX_DIFF && camera_ok ? 0 : 1;
+}
@@ -70,10 +70,11 @@ RetCodes dis_init(void **ctx,
         return ret;
 
     // init grid structure: it tells the outer world what the grid will be
-    grid->mesh_width = 1 + (out_width + MESH_CELL_SIZE_PIX - 1) / MESH_CELL_SIZE_PIX;   // ceil(width/cell)
-    grid->mesh_height = 1 + (out_height + MESH_CELL_SIZE_PIX - 1) / MESH_CELL_SIZE_PIX; // ceil(width/cell)
+    const int cell_size = dis.get_mesh_density().cell_size;
+    grid->mesh_width = 1 + (out_width + cell_size - 1) / cell_size;   // ceil(width/cell)
+    grid->mesh_height = 1 + (out_height + cell_size - 1) / cell_size; // ceil(width/cell)
 
-    dis.calc_out_rays(grid->mesh_width, grid->mesh_height, MESH_CELL_SIZE_PIX, NATURAL);
+    dis.calc_out_rays(grid->mesh_width, grid->mesh_height, cell_size, NATURAL);
 
     return DIS_OK;
 }
@@ -120,6 +121,18 @@ RetCodes dis_generate_grid(void *ctx,
     return ret;
 }
 
+RetCodes dis_filter_motion(void *ctx, float motion_x, float motion_y, int32_t panning)
+{
+    if (ctx == nullptr)
+        return ERROR_CTX;
+
+    DIS &dis = *reinterpret_cast<DIS *>(ctx);
+    if (!dis.initialized)
+        return ERROR_INIT;
+
+    return dis.filter_motion(vec2{motion_x, motion_y}, panning);
+}
+
 RetCodes dis_dewarp_only_grid(void *ctx,
                               int in_width, int in_height,
                               FlipMirrorRot flip_mirror_rot,
@@ -143,3 +156,42 @@ RetCodes dis_dewarp_only_grid(void *ctx,
 
     return DIS_OK;
 }
+
+RetCodes dis_get_mesh_stats(void *ctx, dis_mesh_stats_t *stats)
+{
+    if (ctx == nullptr)
+        return ERROR_CTX;
+    if (stats == nullptr)
+        return ERROR_INPUT_DATA;
+
+    DIS &dis = *reinterpret_cast<DIS *>(ctx);
+    *stats = dis.get_mesh_stats();
+
+    return DIS_OK;
+}
+
+RetCodes dis_get_stabilization(void *ctx, dis_stabilization_t *stabilization)
+{
+    if (ctx == nullptr)
+        return ERROR_CTX;
+    if (stabilization == nullptr)
+        return ERROR_INPUT_DATA;
+
+    DIS &dis = *reinterpret_cast<DIS *>(ctx);
+    *stabilization = dis.get_stabilization();
+
+    return DIS_OK;
+}
+
+RetCodes dis_get_mesh_density(void *ctx, dis_mesh_density_t *density)
+{
+    if (ctx == nullptr)
+        return ERROR_CTX;
+    if (density == nullptr)
+        return ERROR_INPUT_DATA;
+
+    DIS &dis = *reinterpret_cast<DIS *>(ctx);
+    *density = dis.get_mesh_density();
+
+    return DIS_OK;
+}
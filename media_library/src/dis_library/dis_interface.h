@@ -40,7 +40,7 @@ extern "C"
 #endif // __cplusplus
 
     /// @brief Initialization of Dis library. Call this API first!
-    /// dis_init will fill grid width, height, cell_size. Then the caller should
+    /// dis_init will fill grid width, height. Then the caller should
     /// allocate memory for the mesh_table buffer of the grid (width*height*sizeof(int) bytes). The caller
     /// may create a few DewarpT structures and assign each one to a frame in an external frame buffer queue.
     /// DIS does not use the frames, but only the frame motion vector calculated by the HW.
@@ -88,6 +88,16 @@ extern "C"
                                FlipMirrorRot flip_mirror_rot,
                                DewarpT *grid);
 
+    /// @brief Advances the stabilization by the motion of a frame like dis_generate_grid(), without calculating its
+    /// grid. Used when only the grid of a later frame is needed - the following dis_generate_grid() then stabilizes
+    /// the same as if the grids of all the frames were generated.
+    ///
+    /// @param ctx pointer to DIS instance, returned by dis_init
+    /// @param motion_x x component current-to-previous frame motion vector in pixels
+    /// @param motion_y y component current-to-previous frame motion vector in pixels
+    /// @param panning 0 or 1, shows whether the panning motor rotates the camera intentionally
+    RetCodes dis_filter_motion(void *ctx, float motion_x, float motion_y, int32_t panning);
+
     /// @brief Calculates grid for dewarping the input frame only.
     ///
     /// @param ctx pointer to DIS instance, returned by dis_init
@@ -101,6 +111,26 @@ extern "C"
                                   FlipMirrorRot flip_mirror_rot,
                                   DewarpT *grid);
 
+    /// @brief Returns how the grids were produced by dis_generate_grid() - skipped, corrected or fully generated.
+    /// See dis_config_t::mesh_reuse_threshold and dis_config_t::mesh_correction_threshold.
+    ///
+    /// @param ctx pointer to DIS instance, returned by dis_init
+    /// @param stats output
+    RetCodes dis_get_mesh_stats(void *ctx, dis_mesh_stats_t *stats);
+
+    /// @brief Returns the output grid cell size and the maximal interpolation error of the grid, measured by
+    /// dis_init().
+    ///
+    /// @param ctx pointer to DIS instance, returned by dis_init
+    /// @param density output
+    RetCodes dis_get_mesh_density(void *ctx, dis_mesh_density_t *density);
+
+    /// @brief Returns the camera orientation and the stabilized orientation after the last dis_generate_grid().
+    ///
+    /// @param ctx pointer to DIS instance, returned by dis_init
+    /// @param stabilization output
+    RetCodes dis_get_stabilization(void *ctx, dis_stabilization_t *stabilization);
+
 #ifdef __cplusplus
 };
 #endif // __cplusplus
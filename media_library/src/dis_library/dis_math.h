@@ -31,7 +31,9 @@
 #include "vec2.h"
 #include "vec3.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <stdint.h>
 
 /// @brief radians to degrees
@@ -60,6 +62,45 @@ static inline val_t clamp(val_t val, val_t min, val_t max)
     return std::min(std::max(val, min), max);
 }
 
+/// Coefficients of the odd minimax polynomial approximating atan(a) for a in [0, 1]
+/// (Abramowitz & Stegun 4.4.49): atan(a) ~ a * (C1 + C3 * a^2 + ... + C15 * a^14). Max error 2e-8 rad.
+static constexpr float ATAN_C1 = 0.9999993329f;
+static constexpr float ATAN_C3 = -0.3332985605f;
+static constexpr float ATAN_C5 = 0.1994653599f;
+static constexpr float ATAN_C7 = -0.1390853351f;
+static constexpr float ATAN_C9 = 0.0964200441f;
+static constexpr float ATAN_C11 = -0.0559098861f;
+static constexpr float ATAN_C13 = 0.0218612288f;
+static constexpr float ATAN_C15 = -0.0040540580f;
+
+/// @brief polynomial approximation of atan2f(y, x), max error about 1e-7 rad
+///
+/// @param y y coordinate
+/// @param x x coordinate
+static inline float fast_atan2(float y, float x)
+{
+    float ax = std::abs(x);
+    float ay = std::abs(y);
+    float mx = std::max(ay, ax);
+    float mn = std::min(ay, ax);
+    float a = mx > 0.f ? mn / mx : 0.f;
+    float s = a * a;
+    float t = ATAN_C15;
+    t = t * s + ATAN_C13;
+    t = t * s + ATAN_C11;
+    t = t * s + ATAN_C9;
+    t = t * s + ATAN_C7;
+    t = t * s + ATAN_C5;
+    t = t * s + ATAN_C3;
+    t = t * s + ATAN_C1;
+    t *= a;
+    if (ay > ax)
+        t = float(M_PI_2) - t;
+    if (x < 0.f)
+        t = float(M_PI) - t;
+    return y < 0.f ? -t : t;
+}
+
 typedef Vec3T<float> vec3;
 typedef Vec2T<float> vec2;
 
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file dis_replay.cpp
+ * @brief Replays a recorded motion vector trace through the DIS library on the host, as the dewarp stage does on
+ * the camera, to benchmark the mesh generation and catch regressions without hardware.
+ *
+ * The trace has a frame per line: "dx dy [isp_ae_fps [flip_mirror_rot]]" - the hailo15_vsm motion vector, the
+ * sensor framerate of the frame (-1 if unknown) and the FlipMirrorRot value of the output. Empty lines and lines
+ * starting with '#' are ignored. Like the dewarp stage, frames with a known framerate not above
+ * MIN_ISP_AE_FPS_FOR_DIS keep the previous mesh. Without a trace, a synthetic shake of --frames frames is replayed.
+ * With --dewarp-only the meshes are generated by dis_dewarp_only_grid(), as LDC does without DIS.
+ *
+ * Writes a CSV line per frame - timing, camera and stabilized orientation and a mesh checksum - and prints a summary
+ * with the mesh density and its interpolation error, and the checksum of all the meshes, which --expect-checksum
+ * compares to.
+ *
+ * Usage: dis_replay <calibration file> [trace file] [options]
+ **/
+#include "dis_interface.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+/// Same as MIN_ISP_AE_FPS_FOR_DIS of the media library, see dsp_utils.hpp
+constexpr int MIN_ISP_AE_FPS_FOR_DIS = 20;
+constexpr int CALIBRATION_VECTOR_SIZE = 1024;
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+struct replay_frame_t
+{
+    float dx;
+    float dy;
+    int isp_ae_fps;
+    int flip_mirror_rot;
+};
+
+struct replay_options_t
+{
+    const char *calib_path = nullptr;
+    const char *trace_path = nullptr;
+    const char *output_path = "dis_replay.csv";
+    int out_width = 1920;
+    int out_height = 1080;
+    camera_type_t camera_type = CAMERA_TYPE_PINHOLE;
+    float camera_fov = 100.f;
+    int frames = 1000;
+    bool dewarp_only = false;
+    bool has_expected_checksum = false;
+    uint64_t expected_checksum = 0;
+    dis_config_t dis_config;
+};
+
+void usage(const char *name)
+{
+    printf("Usage: %s <calibration file> [trace file] [options]\n"
+           "  --output <file>             per frame CSV, default dis_replay.csv\n"
+           "  --resolution <w>x<h>        output resolution, default 1920x1080\n"
+           "  --camera <type> [fov]       pinhole, fisheye or input, and FOV in degrees, default pinhole 100\n"
+           "  --frames <n>                frames of the synthetic shake when there is no trace, default 1000\n"
+           "  --dewarp-only               generate the meshes with dis_dewarp_only_grid()\n"
+           "  --fast-camera-model         dis_config_t::fast_camera_model\n"
+           "  --reuse-threshold <px>      dis_config_t::mesh_reuse_threshold\n"
+           "  --correction-threshold <px> dis_config_t::mesh_correction_threshold\n"
+           "  --no-black-corners          disable black corners correction\n"
+           "  --expect-checksum <hex>     fail unless the checksum of all the meshes matches\n",
+           name);
+}
+
+/// DIS configuration of the media library examples (frontend_config.json)
+dis_config_t default_dis_config()
+{
+    dis_config_t cfg = {};
+    cfg.enabled = true;
+    cfg.minimun_coefficient_filter = 0.1f;
+    cfg.decrement_coefficient_threshold = 0.001f;
+    cfg.increment_coefficient_threshold = 0.01f;
+    cfg.running_average_coefficient = 0.033f;
+    cfg.std_multiplier = 3.0f;
+    cfg.black_corners_correction_enabled = true;
+    cfg.black_corners_threshold = 0.5f;
+    return cfg;
+}
+
+bool parse_options(int argc, char *argv[], replay_options_t &options)
+{
+    options.dis_config = default_dis_config();
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--output" && has_value)
+            options.output_path = argv[++i];
+        else if (arg == "--resolution" && has_value)
+        {
+            if (sscanf(argv[++i], "%dx%d", &options.out_width, &options.out_height) != 2)
+                return false;
+        }
+        else if (arg == "--camera" && has_value)
+        {
+            std::string type = argv[++i];
+            if (type == "pinhole")
+                options.camera_type = CAMERA_TYPE_PINHOLE;
+            else if (type == "fisheye")
+                options.camera_type = CAMERA_TYPE_FISHEYE;
+            else if (type == "input")
+                options.camera_type = CAMERA_TYPE_INPUT_DISTORTIONS;
+            else
+                return false;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                options.camera_fov = std::atof(argv[++i]);
+        }
+        else if (arg == "--frames" && has_value)
+            options.frames = std::atoi(argv[++i]);
+        else if (arg == "--dewarp-only")
+            options.dewarp_only = true;
+        else if (arg == "--fast-camera-model")
+            options.dis_config.fast_camera_model = true;
+        else if (arg == "--reuse-threshold" && has_value)
+            options.dis_config.mesh_reuse_threshold = std::atof(argv[++i]);
+        else if (arg == "--correction-threshold" && has_value)
+            options.dis_config.mesh_correction_threshold = std::atof(argv[++i]);
+        else if (arg == "--no-black-corners")
+            options.dis_config.black_corners_correction_enabled = false;
+        else if (arg == "--expect-checksum" && has_value)
+        {
+            options.has_expected_checksum = true;
+            options.expected_checksum = std::strtoull(argv[++i], nullptr, 16);
+        }
+        else if (arg[0] != '-' && options.calib_path == nullptr)
+            options.calib_path = argv[i];
+        else if (arg[0] != '-' && options.trace_path == nullptr)
+            options.trace_path = argv[i];
+        else
+            return false;
+    }
+    return options.calib_path != nullptr && options.frames > 0;
+}
+
+/// @brief Reads a text calibration file - a comment line, width, height, optical center x, y and theta2radius
+/// values, one per line, each optionally followed by a comment.
+bool read_calibration(const char *path, dis_calibration_t &calib)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        printf("could not open calibration file %s\n", path);
+        return false;
+    }
+    std::string row;
+    std::getline(file, row); // comment
+    std::vector<float> values;
+    while (std::getline(file, row) && values.size() < 4 + CALIBRATION_VECTOR_SIZE)
+    {
+        if (!row.empty())
+            values.push_back(std::atof(row.c_str()));
+    }
+    if (values.size() < 6 || values[4] != 0.f)
+    {
+        printf("invalid calibration file %s\n", path);
+        return false;
+    }
+    calib.res = ivec2(static_cast<int>(values[0]), static_cast<int>(values[1]));
+    calib.oc = vec2(values[2], values[3]);
+    calib.theta2radius.assign(values.begin() + 4, values.end());
+    return true;
+}
+
+bool read_trace(const char *path, std::vector<replay_frame_t> &frames)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        printf("could not open trace file %s\n", path);
+        return false;
+    }
+    std::string row;
+    while (std::getline(file, row))
+    {
+        std::replace(row.begin(), row.end(), ',', ' ');
+        if (row.empty() || row[0] == '#' || row.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        std::istringstream line(row);
+        replay_frame_t frame = {0.f, 0.f, -1, NATURAL};
+        if (!(line >> frame.dx >> frame.dy))
+        {
+            printf("invalid trace line %zu: %s\n", frames.size() + 1, row.c_str());
+            return false;
+        }
+        line >> frame.isp_ae_fps >> frame.flip_mirror_rot;
+        frames.push_back(frame);
+    }
+    return true;
+}
+
+/// Hand-held like shake - a few sines of different frequencies, a few pixels per frame, and occasional spikes
+std::vector<replay_frame_t> synthetic_trace(int frames)
+{
+    std::vector<replay_frame_t> trace;
+    for (int i = 0; i < frames; i++)
+    {
+        float dx = 4.f * std::sin(i * 0.37f) + 1.5f * std::sin(i * 1.91f);
+        float dy = 3.f * std::cos(i * 0.23f) + 1.f * std::sin(i * 2.71f);
+        if (i % 97 == 50)
+            dx += 40.f;
+        trace.push_back({dx, dy, 30, NATURAL});
+    }
+    return trace;
+}
+
+uint64_t checksum(const int *values, size_t count, uint64_t hash = FNV_OFFSET)
+{
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(values);
+    for (size_t i = 0; i < count * sizeof(int); i++)
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    return hash;
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0.;
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    replay_options_t options;
+    if (!parse_options(argc, argv, options))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    dis_calibration_t calib;
+    if (!read_calibration(options.calib_path, calib))
+        return 1;
+
+    std::vector<replay_frame_t> trace;
+    if (options.trace_path != nullptr)
+    {
+        if (!read_trace(options.trace_path, trace))
+            return 1;
+    }
+    else
+    {
+        trace = synthetic_trace(options.frames);
+    }
+
+    void *ctx = nullptr;
+    DewarpT grid = {};
+    auto init_start = std::chrono::steady_clock::now();
+    RetCodes ret = dis_init(&ctx, options.dis_config, calib, options.out_width, options.out_height,
+                            options.camera_type, options.camera_fov, &grid);
+    auto init_end = std::chrono::steady_clock::now();
+    if (ret != DIS_OK)
+    {
+        printf("dis_init failed on error %d\n", ret);
+        dis_deinit(&ctx);
+        return 1;
+    }
+    std::vector<int> mesh_table(grid.mesh_width * grid.mesh_height * 2);
+    grid.mesh_table = mesh_table.data();
+
+    FILE *output = fopen(options.output_path, "w");
+    if (output == nullptr)
+    {
+        printf("could not open output file %s\n", options.output_path);
+        dis_deinit(&ctx);
+        return 1;
+    }
+    fprintf(output, "frame,dx,dy,isp_ae_fps,flip_mirror_rot,updated,time_us,"
+                    "orientation_lo,orientation_la,stabilized_lo,stabilized_la,filter_coefficient,checksum\n");
+
+    std::vector<double> times_us;
+    uint64_t total_checksum = FNV_OFFSET;
+    int failures = 0;
+    for (size_t i = 0; i < trace.size(); i++)
+    {
+        const replay_frame_t &frame = trace[i];
+        FlipMirrorRot flip_mirror_rot = static_cast<FlipMirrorRot>(frame.flip_mirror_rot);
+        bool update = options.dewarp_only || frame.isp_ae_fps > MIN_ISP_AE_FPS_FOR_DIS || frame.isp_ae_fps == -1;
+        double time_us = 0.;
+        if (update)
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (options.dewarp_only)
+                ret = dis_dewarp_only_grid(ctx, calib.res.x, calib.res.y, flip_mirror_rot, &grid);
+            else
+                ret = dis_generate_grid(ctx, calib.res.x, calib.res.y, frame.dx, frame.dy, 0, flip_mirror_rot, &grid);
+            auto end = std::chrono::steady_clock::now();
+            time_us = std::chrono::duration<double, std::micro>(end - start).count();
+            times_us.push_back(time_us);
+            if (ret != DIS_OK)
+            {
+                printf("frame %zu: mesh generation failed on error %d\n", i, ret);
+                failures++;
+            }
+        }
+
+        dis_stabilization_t stab;
+        dis_get_stabilization(ctx, &stab);
+        uint64_t frame_checksum = checksum(grid.mesh_table, mesh_table.size());
+        total_checksum = checksum(grid.mesh_table, mesh_table.size(), total_checksum);
+        fprintf(output, "%zu,%.3f,%.3f,%d,%d,%d,%.2f,%.7f,%.7f,%.7f,%.7f,%.5f,%016" PRIx64 "\n",
+                i, frame.dx, frame.dy, frame.isp_ae_fps, frame.flip_mirror_rot, update ? 1 : 0, time_us,
+                stab.orientation_lo, stab.orientation_la, stab.stabilized_lo, stab.stabilized_la,
+                stab.filter_coefficient, frame_checksum);
+    }
+    fclose(output);
+
+    dis_mesh_stats_t stats;
+    dis_get_mesh_stats(ctx, &stats);
+    dis_mesh_density_t density;
+    dis_get_mesh_density(ctx, &density);
+    dis_deinit(&ctx);
+
+    double mean_us = 0.;
+    for (double t : times_us)
+        mean_us += t;
+    mean_us = times_us.empty() ? 0. : mean_us / times_us.size();
+    printf("mesh %dx%d, cell %d px, max interpolation error %.3f px\n", grid.mesh_width, grid.mesh_height,
+           density.cell_size, density.max_error);
+    printf("%zu frames (%zu updated), dis_init %.2f ms\n", trace.size(), times_us.size(),
+           std::chrono::duration<double, std::milli>(init_end - init_start).count());
+    printf("mesh update us: mean %.2f, p50 %.2f, p99 %.2f, max %.2f\n", mean_us, percentile(times_us, 0.5),
+           percentile(times_us, 0.99), percentile(times_us, 1.));
+    printf("meshes: %" PRIu64 " skipped, %" PRIu64 " corrected, %" PRIu64 " regenerated\n",
+           stats.skipped, stats.corrected, stats.regenerated);
+    printf("checksum: %016" PRIx64 "\n", total_checksum);
+
+    if (failures > 0)
+        return 1;
+    if (options.has_expected_checksum && options.expected_checksum != total_checksum)
+    {
+        printf("checksum mismatch, expected %016" PRIx64 "\n", options.expected_checksum);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "grid_projection.h"
+
+#include "dewarp.h"
+#include "dis.h"
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define GRID_PROJECTION_NEON (1)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define GRID_PROJECTION_SSE (1)
+#endif
+
+namespace
+{
+/// Vertexes processed together by the SIMD kernels.
+constexpr int LANES = 4;
+
+/// Q15.16 scale of the mesh_table values.
+constexpr float MESH_SCALE = float(1 << MESH_FRACT_BITS);
+
+/// Origin of the projected points in the mesh_table coordinates.
+vec2 grid_origin(const FishEye &cam)
+{
+#if GRID_IS_IN_PIX_INDEXES
+    return cam.oc - vec2(0.5f, 0.5f); // convert coordinate to index
+#else
+    return cam.oc;
+#endif
+}
+
+/// @brief Projects the rays [begin, end) one by one. Used for the tail of the SIMD kernels.
+void project_rays_scalar(const FishEye &cam, const mat3 &m, const RaysSoA &rays, int begin, int end,
+                         int *mesh_table)
+{
+    const vec2 origin = grid_origin(cam);
+    for (int i = begin; i < end; i++)
+    {
+        float x = rays.x[i], y = rays.y[i], z = rays.z[i];
+        float rx = m[0] * x + m[1] * y + m[2] * z;
+        float ry = m[3] * x + m[4] * y + m[5] * z;
+        float rz = m[6] * x + m[7] * y + m[8] * z;
+        float rad = std::sqrt(rx * rx + ry * ry);
+        float s = rad > 0.f ? cam.theta2rad(fast_atan2(rad, rz)) / rad : 0.f;
+
+        mesh_table[i * 2] = (origin.x + rx * s) * MESH_SCALE;     // x
+        mesh_table[i * 2 + 1] = (origin.y + ry * s) * MESH_SCALE; // y
+    }
+}
+
+#if defined(GRID_PROJECTION_NEON)
+/// @brief fast_atan2() of 4 lanes, for y >= 0
+inline float32x4_t fast_atan2_pos(float32x4_t y, float32x4_t x)
+{
+    float32x4_t ax = vabsq_f32(x);
+    float32x4_t mx = vmaxq_f32(y, ax);
+    float32x4_t mn = vminq_f32(y, ax);
+    uint32x4_t valid = vcgtq_f32(mx, vdupq_n_f32(0.f));
+    float32x4_t a = vbslq_f32(valid, vdivq_f32(mn, mx), vdupq_n_f32(0.f));
+    float32x4_t s = vmulq_f32(a, a);
+    float32x4_t t = vdupq_n_f32(ATAN_C15);
+    t = vmlaq_f32(vdupq_n_f32(ATAN_C13), t, s);
+    t = vmlaq_f32(vdupq_n_f32(ATAN_C11), t, s);
+    t = vmlaq_f32(vdupq_n_f32(ATAN_C9), t, s);
+    t = vmlaq_f32(vdupq_n_f32(ATAN_C7), t, s);
+    t = vmlaq_f32(vdupq_n_f32(ATAN_C5), t, s);
+    t = vmlaq_f32(vdupq_n_f32(ATAN_C3), t, s);
+    t = vmlaq_f32(vdupq_n_f32(ATAN_C1), t, s);
+    t = vmulq_f32(t, a);
+    t = vbslq_f32(vcgtq_f32(y, ax), vsubq_f32(vdupq_n_f32(float(M_PI_2)), t), t);
+    t = vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.f)), vsubq_f32(vdupq_n_f32(float(M_PI)), t), t);
+    return t;
+}
+
+int project_rays_simd(const FishEye &cam, const mat3 &m, const RaysSoA &rays, int begin, int end, int *mesh_table)
+{
+    const vec2 origin = grid_origin(cam);
+    const float32x4_t origin_x = vdupq_n_f32(origin.x);
+    const float32x4_t origin_y = vdupq_n_f32(origin.y);
+    const float32x4_t zero = vdupq_n_f32(0.f);
+    float theta[LANES], radius[LANES];
+
+    int i = begin;
+    for (; i + LANES <= end; i += LANES)
+    {
+        float32x4_t x = vld1q_f32(&rays.x[i]);
+        float32x4_t y = vld1q_f32(&rays.y[i]);
+        float32x4_t z = vld1q_f32(&rays.z[i]);
+        float32x4_t rx = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, m[0]), y, m[1]), z, m[2]);
+        float32x4_t ry = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, m[3]), y, m[4]), z, m[5]);
+        float32x4_t rz = vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(x, m[6]), y, m[7]), z, m[8]);
+        float32x4_t rad = vsqrtq_f32(vmlaq_f32(vmulq_f32(rx, rx), ry, ry));
+
+        // the theta2r LUT lookup is a gather - do it per lane
+        vst1q_f32(theta, fast_atan2_pos(rad, rz));
+        for (int l = 0; l < LANES; l++)
+            radius[l] = cam.theta2rad(theta[l]);
+
+        float32x4_t s = vbslq_f32(vcgtq_f32(rad, zero), vdivq_f32(vld1q_f32(radius), rad), zero);
+        int32x4x2_t pt;
+        pt.val[0] = vcvtq_s32_f32(vmulq_n_f32(vmlaq_f32(origin_x, rx, s), MESH_SCALE));
+        pt.val[1] = vcvtq_s32_f32(vmulq_n_f32(vmlaq_f32(origin_y, ry, s), MESH_SCALE));
+        vst2q_s32(&mesh_table[i * 2], pt); // interleave to x,y,x,y,...
+    }
+    return i;
+}
+#elif defined(GRID_PROJECTION_SSE)
+/// @brief fast_atan2() of 4 lanes, for y >= 0
+inline __m128 fast_atan2_pos(__m128 y, __m128 x)
+{
+    const __m128 sign_mask = _mm_set1_ps(-0.f);
+    __m128 ax = _mm_andnot_ps(sign_mask, x);
+    __m128 mx = _mm_max_ps(y, ax);
+    __m128 mn = _mm_min_ps(y, ax);
+    __m128 valid = _mm_cmpgt_ps(mx, _mm_setzero_ps());
+    __m128 a = _mm_and_ps(valid, _mm_div_ps(mn, mx));
+    __m128 s = _mm_mul_ps(a, a);
+    __m128 t = _mm_set1_ps(ATAN_C15);
+    t = _mm_add_ps(_mm_mul_ps(t, s), _mm_set1_ps(ATAN_C13));
+    t = _mm_add_ps(_mm_mul_ps(t, s), _mm_set1_ps(ATAN_C11));
+    t = _mm_add_ps(_mm_mul_ps(t, s), _mm_set1_ps(ATAN_C9));
+    t = _mm_add_ps(_mm_mul_ps(t, s), _mm_set1_ps(ATAN_C7));
+    t = _mm_add_ps(_mm_mul_ps(t, s), _mm_set1_ps(ATAN_C5));
+    t = _mm_add_ps(_mm_mul_ps(t, s), _mm_set1_ps(ATAN_C3));
+    t = _mm_add_ps(_mm_mul_ps(t, s), _mm_set1_ps(ATAN_C1));
+    t = _mm_mul_ps(t, a);
+    __m128 above = _mm_cmpgt_ps(y, ax);
+    t = _mm_or_ps(_mm_and_ps(above, _mm_sub_ps(_mm_set1_ps(float(M_PI_2)), t)), _mm_andnot_ps(above, t));
+    __m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+    t = _mm_or_ps(_mm_and_ps(negative, _mm_sub_ps(_mm_set1_ps(float(M_PI)), t)), _mm_andnot_ps(negative, t));
+    return t;
+}
+
+int project_rays_simd(const FishEye &cam, const mat3 &m, const RaysSoA &rays, int begin, int end, int *mesh_table)
+{
+    const vec2 origin = grid_origin(cam);
+    const __m128 origin_x = _mm_set1_ps(origin.x);
+    const __m128 origin_y = _mm_set1_ps(origin.y);
+    const __m128 scale = _mm_set1_ps(MESH_SCALE);
+    float theta[LANES], radius[LANES];
+
+    int i = begin;
+    for (; i + LANES <= end; i += LANES)
+    {
+        __m128 x = _mm_loadu_ps(&rays.x[i]);
+        __m128 y = _mm_loadu_ps(&rays.y[i]);
+        __m128 z = _mm_loadu_ps(&rays.z[i]);
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(m[0])), _mm_mul_ps(y, _mm_set1_ps(m[1]))),
+                               _mm_mul_ps(z, _mm_set1_ps(m[2])));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(m[3])), _mm_mul_ps(y, _mm_set1_ps(m[4]))),
+                               _mm_mul_ps(z, _mm_set1_ps(m[5])));
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(m[6])), _mm_mul_ps(y, _mm_set1_ps(m[7]))),
+                               _mm_mul_ps(z, _mm_set1_ps(m[8])));
+        __m128 rad = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)));
+
+        // the theta2r LUT lookup is a gather - do it per lane
+        _mm_storeu_ps(theta, fast_atan2_pos(rad, rz));
+        for (int l = 0; l < LANES; l++)
+            radius[l] = cam.theta2rad(theta[l]);
+
+        __m128 valid = _mm_cmpgt_ps(rad, _mm_setzero_ps());
+        __m128 s = _mm_and_ps(valid, _mm_div_ps(_mm_loadu_ps(radius), rad));
+        __m128i pt_x = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(origin_x, _mm_mul_ps(rx, s)), scale));
+        __m128i pt_y = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(origin_y, _mm_mul_ps(ry, s)), scale));
+        // interleave to x,y,x,y,...
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&mesh_table[i * 2]), _mm_unpacklo_epi32(pt_x, pt_y));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&mesh_table[i * 2 + LANES]), _mm_unpackhi_epi32(pt_x, pt_y));
+    }
+    return i;
+}
+#else
+int project_rays_simd(const FishEye &, const mat3 &, const RaysSoA &, int begin, int, int *)
+{
+    return begin;
+}
+#endif
+} // namespace
+
+void project_rays(const FishEye &cam, const mat3 &rot, const RaysSoA &rays, int begin, int end, int *mesh_table)
+{
+    int tail = project_rays_simd(cam, rot, rays, begin, end, mesh_table);
+    project_rays_scalar(cam, rot, rays, tail, end, mesh_table);
+}
+
+void project_rays_reference(const FishEye &cam, const mat3 &rot, const RaysSoA &rays, int begin, int end,
+                            int *mesh_table)
+{
+    for (int i = begin; i < end; i++)
+    {
+        vec2 pt = cam.ray2point(rot * vec3(rays.x[i], rays.y[i], rays.z[i]));
+#if GRID_IS_IN_PIX_INDEXES
+        pt = pt - vec2(0.5f, 0.5f); // convert coordinate to index
+#endif
+        mesh_table[i * 2] = pt.x * (1 << MESH_FRACT_BITS);     // x
+        mesh_table[i * 2 + 1] = pt.y * (1 << MESH_FRACT_BITS); // y
+    }
+}
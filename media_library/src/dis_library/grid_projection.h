@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file grid_projection.h
+ * @brief Vectorized projection of the output grid rays onto the input camera
+ *
+ * The per-frame part of the grid generation: rotates the output rays by the stabilizing rotation, projects them on
+ * the input fisheye camera and writes the grid vertexes in the fixed point mesh_table format.
+ **/
+#ifndef _DIS_GRID_PROJECTION_H_
+#define _DIS_GRID_PROJECTION_H_
+
+#include "camera.h"
+#include "dis_math.h"
+
+#include <vector>
+
+/// Rays in the output camera through the grid vertexes, kept as separate x, y, z arrays (structure of arrays), so that
+/// consecutive vertexes can be loaded into SIMD registers as is.
+struct RaysSoA
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    void resize(size_t size)
+    {
+        x.resize(size);
+        y.resize(size);
+        z.resize(size);
+    }
+    size_t size() const { return x.size(); }
+    void set(size_t ind, const vec3 &ray)
+    {
+        x[ind] = ray.x;
+        y[ind] = ray.y;
+        z[ind] = ray.z;
+    }
+};
+
+/// @brief Rotates the rays [begin, end) by rot, projects them onto cam and writes the resulting points to
+/// mesh_table[2 * begin, 2 * end) as Q15.16 x,y pairs. Uses NEON/SSE when available and a polynomial atan2.
+/// The result differs from project_rays_reference() by less than 1/256 pixel.
+/// @param cam input camera
+/// @param rot rotation applied on the rays before projecting them
+/// @param rays output camera rays through the grid vertexes
+/// @param begin first vertex index
+/// @param end one past the last vertex index
+/// @param mesh_table output grid vertexes, ordered x,y,x,y,...
+void project_rays(const FishEye &cam, const mat3 &rot, const RaysSoA &rays, int begin, int end, int *mesh_table);
+
+/// @brief Scalar implementation of project_rays(), using FishEye::ray2point() for each vertex. Used as a reference
+/// for validating and benchmarking project_rays().
+void project_rays_reference(const FishEye &cam, const mat3 &rot, const RaysSoA &rays, int begin, int end,
+                            int *mesh_table);
+
+#endif // _DIS_GRID_PROJECTION_H_
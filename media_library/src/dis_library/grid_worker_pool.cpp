@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "grid_worker_pool.h"
+
+GridWorkerPool::GridWorkerPool(int num_threads)
+{
+    for (int i = 1; i < num_threads; i++)
+    {
+        m_threads.emplace_back(&GridWorkerPool::worker_loop, this);
+    }
+}
+
+GridWorkerPool::~GridWorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_cv.notify_all();
+    for (auto &thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void GridWorkerPool::run(int num_tasks, const std::function<void(int)> &task)
+{
+    if (num_tasks <= 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_num_tasks = num_tasks;
+    m_next_task = 0;
+    m_pending_tasks = num_tasks;
+    m_generation++;
+    if (num_tasks > 1)
+        m_work_cv.notify_all();
+
+    // the calling thread takes tasks as well, then waits for the ones still running on the workers
+    execute_tasks(lock);
+    m_done_cv.wait(lock, [this] { return m_pending_tasks == 0; });
+    m_task = nullptr;
+}
+
+void GridWorkerPool::execute_tasks(std::unique_lock<std::mutex> &lock)
+{
+    while (m_task != nullptr && m_next_task < m_num_tasks)
+    {
+        int task_index = m_next_task++;
+        const std::function<void(int)> &task = *m_task;
+        lock.unlock();
+        task(task_index);
+        lock.lock();
+        if (--m_pending_tasks == 0)
+            m_done_cv.notify_all();
+    }
+}
+
+void GridWorkerPool::worker_loop()
+{
+    uint64_t seen_generation = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_work_cv.wait(lock, [&] { return m_stop || m_generation != seen_generation; });
+        if (m_stop)
+            return;
+        seen_generation = m_generation;
+        execute_tasks(lock);
+    }
+}
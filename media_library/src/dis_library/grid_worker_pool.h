@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file grid_worker_pool.h
+ * @brief Small pool of persistent threads splitting the grid generation into row ranges
+ **/
+#ifndef _DIS_GRID_WORKER_POOL_H_
+#define _DIS_GRID_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Pool of persistent worker threads. The threads are created once and then wait for tasks, so that splitting a
+/// per-frame job among them does not pay for thread creation on every frame.
+class GridWorkerPool
+{
+public:
+    /// @brief creates the pool
+    /// @param num_threads total number of threads executing the tasks, including the thread calling run()
+    explicit GridWorkerPool(int num_threads);
+    ~GridWorkerPool();
+
+    GridWorkerPool(const GridWorkerPool &) = delete;
+    GridWorkerPool &operator=(const GridWorkerPool &) = delete;
+
+    /// @brief number of threads executing the tasks, including the thread calling run()
+    int size() const { return static_cast<int>(m_threads.size()) + 1; }
+
+    /// @brief runs task(0) ... task(num_tasks - 1) on the pool and the calling thread, and returns when all of them
+    /// are done. Not reentrant - run() must not be called concurrently.
+    /// @param num_tasks number of tasks
+    /// @param task function executing a single task, gets the task index
+    void run(int num_tasks, const std::function<void(int)> &task);
+
+private:
+    void worker_loop();
+    /// @brief executes tasks until none is left. m_mutex must be locked by the caller.
+    void execute_tasks(std::unique_lock<std::mutex> &lock);
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    const std::function<void(int)> *m_task = nullptr;
+    int m_num_tasks = 0;
+    int m_next_task = 0;
+    int m_pending_tasks = 0;
+    uint64_t m_generation = 0;
+    bool m_stop = false;
+};
+
+#endif // _DIS_GRID_WORKER_POOL_H_
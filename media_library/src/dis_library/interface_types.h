@@ -30,6 +30,7 @@
 #include "dis_math.h"
 #include <stddef.h>
 #include <stdint.h>
+#include <vector>
 
 /// Flip vertical, mirror horizontal, rotate to 90/180/270 deg.
 /// Flip and mirror may be before or after rotation. All possible combinations
@@ -79,6 +80,33 @@ enum RetCodes
     ERROR_INTERNAL    // 7 internal error. more info is printed in the log
 };
 
+/// How the grids were produced by dis_generate_grid(), see dis_config_t::mesh_reuse_threshold and
+/// dis_config_t::mesh_correction_threshold.
+struct dis_mesh_stats_t
+{
+    uint64_t skipped = 0;     // previous grid reused as is
+    uint64_t corrected = 0;   // first order correction of the last fully generated grid
+    uint64_t regenerated = 0; // grid fully projected
+};
+
+/// Output grid density, measured by dis_init().
+struct dis_mesh_density_t
+{
+    int cell_size = 0;     // grid cell size in output pixels
+    float max_error = 0.f; // maximal interpolation error of the grid wrt the exact camera models, input pixels
+};
+
+/// Camera orientation tracked by dis_generate_grid() after the last frame, angles in radians with respect to the
+/// first frame. The stabilizing rotation applied to the frame is stabilized - orientation.
+struct dis_stabilization_t
+{
+    float orientation_lo = 0.f; // actual orientation, accumulated from the frame motion vectors
+    float orientation_la = 0.f;
+    float stabilized_lo = 0.f; // filtered (stabilized) orientation
+    float stabilized_la = 0.f;
+    float filter_coefficient = 0.f; // current coefficient 'k' of the stabilization filter
+};
+
 struct dis_calibration_t
 {
     ivec2 res;
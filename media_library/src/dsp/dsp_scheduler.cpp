@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "dsp_scheduler.hpp"
+#include "media_library_logger.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+// Framerate assumed for the deadlines of sensors registered before their framerate is known
+#define DSP_SCHEDULER_DEFAULT_FRAMERATE (30)
+// Sensor of the modules whose configuration does not name one - a single sensor pipeline
+#define DSP_SCHEDULER_DEFAULT_SENSOR "default"
+
+/** @defgroup dsp_scheduler_definitions MediaLibrary DSP scheduler CPP API
+ * definitions
+ *  @{
+ */
+
+namespace dsp_scheduler
+{
+    struct sensor_entry_t
+    {
+        sensor_stats_t stats;
+        uint32_t refcount;
+    };
+
+    struct waiting_job_t
+    {
+        uint64_t ticket;
+        uint64_t deadline_ns;
+    };
+
+    static std::mutex scheduler_mutex;
+    static std::condition_variable scheduler_cv;
+    static std::map<sensor_id_t, sensor_entry_t> sensors;
+    static std::vector<waiting_job_t> waiting_jobs;
+    static uint running_jobs = 0;
+    static uint64_t next_ticket = 1;
+    static uint64_t granted_ticket = 0;
+    static sensor_id_t next_sensor_id = 0;
+
+    static uint64_t frame_period_ns(uint32_t framerate)
+    {
+        if (framerate == 0)
+            framerate = DSP_SCHEDULER_DEFAULT_FRAMERATE;
+        return 1000000000ULL / framerate;
+    }
+
+    /**
+     * Register a sensor for DSP scheduling.
+     * Registering an already registered sensor name returns its id and increases its
+     * reference count. Modules without a sensor name all register the same default sensor, so
+     * the stages of a single sensor pipeline are not arbitrated against each other.
+     * @param[in] sensor - sensor name, usually its video device
+     * @param[in] framerate - sensor framerate, 0 if not known yet
+     * @return sensor_id_t
+     */
+    sensor_id_t register_sensor(const std::string &sensor, uint32_t framerate)
+    {
+        const std::string sensor_name = sensor.empty() ? DSP_SCHEDULER_DEFAULT_SENSOR : sensor;
+        std::unique_lock<std::mutex> lock(scheduler_mutex);
+        for (auto &[sensor_id, entry] : sensors)
+        {
+            if (entry.stats.sensor != sensor_name)
+                continue;
+            entry.refcount++;
+            if (framerate != 0)
+                entry.stats.framerate = framerate;
+            LOGGER__DEBUG("Sensor {} already registered for DSP scheduling, refcount is {}", sensor_name, entry.refcount);
+            return sensor_id;
+        }
+
+        sensor_id_t sensor_id = next_sensor_id++;
+        sensor_entry_t &entry = sensors[sensor_id];
+        entry.stats = sensor_stats_t{};
+        entry.stats.sensor = sensor_name;
+        entry.stats.framerate = framerate;
+        entry.refcount = 1;
+        LOGGER__INFO("Registered sensor {} ({} fps) for DSP scheduling, {} sensors registered",
+                     entry.stats.sensor, framerate, sensors.size());
+        return sensor_id;
+    }
+
+    /**
+     * Unregister a sensor.
+     * The sensor is removed once all of its modules unregistered it, its statistics are logged
+     * on removal.
+     * @param[in] sensor_id - id returned by register_sensor
+     */
+    void unregister_sensor(sensor_id_t sensor_id)
+    {
+        std::unique_lock<std::mutex> lock(scheduler_mutex);
+        auto it = sensors.find(sensor_id);
+        if (it == sensors.end())
+            return;
+
+        if (--it->second.refcount > 0)
+            return;
+
+        sensor_stats_t &stats = it->second.stats;
+        LOGGER__INFO("Unregistered sensor {} from DSP scheduling: {} jobs, {} deadline misses, {} dropped frames, "
+                     "average wait {} us, average service {} us",
+                     stats.sensor, stats.jobs, stats.deadline_misses, stats.dropped_frames,
+                     stats.wait.average_ns() / 1000, stats.service.average_ns() / 1000);
+        sensors.erase(it);
+    }
+
+    /**
+     * Begin a DSP job of a sensor.
+     * Blocks until it is the turn of the job, when more than one sensor is registered.
+     * Jobs of an invalid or unregistered sensor are not scheduled.
+     * @param[in] sensor_id - id returned by register_sensor
+     * @return job_t to hand back to end_job
+     */
+    job_t begin_job(sensor_id_t sensor_id)
+    {
+        job_t job = {sensor_id, frame_latency_record_t::now_ns(), 0, 0};
+        if (sensor_id == invalid_sensor_id)
+            return job;
+
+        std::unique_lock<std::mutex> lock(scheduler_mutex);
+        auto it = sensors.find(sensor_id);
+        if (it == sensors.end())
+        {
+            job.sensor_id = invalid_sensor_id;
+            return job;
+        }
+        job.deadline_ns = job.request_ns + frame_period_ns(it->second.stats.framerate);
+
+        if (sensors.size() > 1 && (running_jobs > 0 || !waiting_jobs.empty()))
+        {
+            uint64_t ticket = next_ticket++;
+            waiting_jobs.push_back({ticket, job.deadline_ns});
+            // end_job counts the granted job as running on its behalf
+            scheduler_cv.wait(lock, [ticket]
+                              { return granted_ticket == ticket; });
+            granted_ticket = 0;
+        }
+        else
+        {
+            running_jobs++;
+        }
+
+        job.start_ns = frame_latency_record_t::now_ns();
+        // The sensor may have been unregistered while waiting
+        it = sensors.find(sensor_id);
+        if (it != sensors.end())
+            it->second.stats.wait.add(job.start_ns - job.request_ns);
+        return job;
+    }
+
+    /**
+     * End a DSP job, and grant the DSP to the waiting job with the earliest deadline.
+     * @param[in] job - job returned by begin_job
+     */
+    void end_job(const job_t &job)
+    {
+        if (job.sensor_id == invalid_sensor_id)
+            return;
+
+        uint64_t end_ns = frame_latency_record_t::now_ns();
+        std::unique_lock<std::mutex> lock(scheduler_mutex);
+        running_jobs--;
+
+        auto it = sensors.find(job.sensor_id);
+        if (it != sensors.end())
+        {
+            sensor_stats_t &stats = it->second.stats;
+            stats.jobs++;
+            stats.service.add(end_ns - job.start_ns);
+            if (end_ns > job.deadline_ns)
+            {
+                stats.deadline_misses++;
+                LOGGER__DEBUG("DSP job of sensor {} missed its deadline by {} us", stats.sensor, (end_ns - job.deadline_ns) / 1000);
+            }
+        }
+
+        if (running_jobs > 0 || waiting_jobs.empty())
+            return;
+
+        // Earliest deadline first, ties are served in arrival order
+        auto next = std::min_element(waiting_jobs.begin(), waiting_jobs.end(),
+                                     [](const waiting_job_t &a, const waiting_job_t &b)
+                                     {
+                                         return a.deadline_ns != b.deadline_ns ? a.deadline_ns < b.deadline_ns : a.ticket < b.ticket;
+                                     });
+        granted_ticket = next->ticket;
+        waiting_jobs.erase(next);
+        running_jobs++;
+        scheduler_cv.notify_all();
+    }
+
+    /**
+     * Count a frame that was dropped by one of the modules of a sensor.
+     * @param[in] sensor_id - id returned by register_sensor
+     */
+    void record_dropped_frame(sensor_id_t sensor_id)
+    {
+        std::unique_lock<std::mutex> lock(scheduler_mutex);
+        auto it = sensors.find(sensor_id);
+        if (it != sensors.end())
+            it->second.stats.dropped_frames++;
+    }
+
+    /**
+     * Get the DSP statistics of all the registered sensors.
+     * @return std::vector<sensor_stats_t>
+     */
+    std::vector<sensor_stats_t> get_sensors_stats()
+    {
+        std::unique_lock<std::mutex> lock(scheduler_mutex);
+        std::vector<sensor_stats_t> stats;
+        stats.reserve(sensors.size());
+        for (auto &[sensor_id, entry] : sensors)
+            stats.push_back(entry.stats);
+        return stats;
+    }
+} // namespace dsp_scheduler
+
+/** @} */ // end of dsp_scheduler_definitions
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file bitmask_rasterizer.cpp
+ * @brief Polygon rasterizer for bit per pixel bitmasks
+ **/
+
+#include "bitmask_rasterizer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <endian.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define BITMASK_WORD_PIXELS (64)
+#define BITMASK_WORD_BYTES (8)
+
+/**
+ * @brief A non horizontal polygon edge, from its top vertex (x0, y0) to its bottom vertex (x0 + dx, y0 + dy)
+ */
+struct bitmask_edge_t
+{
+    int64_t x0;
+    int64_t y0;
+    int64_t dx;
+    int64_t dy;
+};
+
+/**
+ * @brief Returns the mask of the pixels [first, last) of a 64 pixel word, as stored in memory.
+ * 0 <= first < last <= 64.
+ */
+static inline uint64_t word_mask(uint32_t first, uint32_t last)
+{
+    // The pixels of a word are in the big endian bit order
+    uint64_t mask = (~0ULL >> first) & (~0ULL << (BITMASK_WORD_PIXELS - last));
+    return htobe64(mask);
+}
+
+static inline void or_word(uint8_t *dst, uint64_t mask)
+{
+    uint64_t word;
+    memcpy(&word, dst, sizeof(word));
+    word |= mask;
+    memcpy(dst, &word, sizeof(word));
+}
+
+static inline void and_word(uint8_t *dst, uint64_t mask)
+{
+    uint64_t word;
+    memcpy(&word, dst, sizeof(word));
+    word &= mask;
+    memcpy(dst, &word, sizeof(word));
+}
+
+/**
+ * @brief Sets all the pixels of count words to value (0x00 or 0xFF)
+ */
+static inline void fill_words(uint8_t *dst, uint32_t count, uint8_t value)
+{
+    uint32_t i = 0;
+#if defined(__ARM_NEON)
+    uint8x16_t vector = vdupq_n_u8(value);
+    for (; i + 2 <= count; i += 2)
+        vst1q_u8(dst + i * BITMASK_WORD_BYTES, vector);
+#elif defined(__SSE2__)
+    __m128i vector = _mm_set1_epi8(static_cast<char>(value));
+    for (; i + 2 <= count; i += 2)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * BITMASK_WORD_BYTES), vector);
+#endif
+    uint64_t word = value ? ~0ULL : 0;
+    for (; i < count; i++)
+        memcpy(dst + i * BITMASK_WORD_BYTES, &word, sizeof(word));
+}
+
+void fill_bitmask_span(uint8_t *row, uint32_t x_start, uint32_t x_end)
+{
+    if (x_start >= x_end)
+        return;
+
+    uint32_t first_word = x_start / BITMASK_WORD_PIXELS;
+    uint32_t last_word = (x_end - 1) / BITMASK_WORD_PIXELS;
+    uint32_t first = x_start % BITMASK_WORD_PIXELS;
+    uint32_t last = x_end - last_word * BITMASK_WORD_PIXELS;
+    if (first_word == last_word)
+    {
+        or_word(row + first_word * BITMASK_WORD_BYTES, word_mask(first, last));
+        return;
+    }
+    or_word(row + first_word * BITMASK_WORD_BYTES, word_mask(first, BITMASK_WORD_PIXELS));
+    fill_words(row + (first_word + 1) * BITMASK_WORD_BYTES, last_word - first_word - 1, 0xFF);
+    or_word(row + last_word * BITMASK_WORD_BYTES, word_mask(0, last));
+}
+
+// Sets (value 0xFF) or clears (value 0x00) a rectangle - the head and tail words of each row are masked
+static void write_bitmask_rect(uint8_t *bitmask, uint32_t bytes_per_line, const roi_t &rect, uint8_t value)
+{
+    if (rect.width == 0 || rect.height == 0)
+        return;
+
+    uint32_t x_end = rect.x + rect.width;
+    uint32_t first_word = rect.x / BITMASK_WORD_PIXELS;
+    uint32_t last_word = (x_end - 1) / BITMASK_WORD_PIXELS;
+    uint32_t first = rect.x % BITMASK_WORD_PIXELS;
+    uint32_t last = x_end - last_word * BITMASK_WORD_PIXELS;
+    for (uint32_t y = rect.y; y < rect.y + rect.height; y++)
+    {
+        uint8_t *row = bitmask + static_cast<size_t>(y) * bytes_per_line;
+        if (first_word == last_word)
+        {
+            if (value)
+                or_word(row + first_word * BITMASK_WORD_BYTES, word_mask(first, last));
+            else
+                and_word(row + first_word * BITMASK_WORD_BYTES, ~word_mask(first, last));
+            continue;
+        }
+        if (value)
+        {
+            or_word(row + first_word * BITMASK_WORD_BYTES, word_mask(first, BITMASK_WORD_PIXELS));
+            or_word(row + last_word * BITMASK_WORD_BYTES, word_mask(0, last));
+        }
+        else
+        {
+            and_word(row + first_word * BITMASK_WORD_BYTES, ~word_mask(first, BITMASK_WORD_PIXELS));
+            and_word(row + last_word * BITMASK_WORD_BYTES, ~word_mask(0, last));
+        }
+        fill_words(row + (first_word + 1) * BITMASK_WORD_BYTES, last_word - first_word - 1, value);
+    }
+}
+
+void clear_bitmask_rect(uint8_t *bitmask, uint32_t bytes_per_line, const roi_t &rect)
+{
+    write_bitmask_rect(bitmask, bytes_per_line, rect, 0x00);
+}
+
+void fill_bitmask_rect(uint8_t *bitmask, uint32_t bytes_per_line, const roi_t &rect)
+{
+    write_bitmask_rect(bitmask, bytes_per_line, rect, 0xFF);
+}
+
+static inline int64_t ceil_div(int64_t numerator, int64_t denominator)
+{
+    return numerator >= 0 ? (numerator + denominator - 1) / denominator : -(-numerator / denominator);
+}
+
+/**
+ * @brief Returns the first pixel of a row whose center is right of (or on) an edge - the edge crosses the row
+ * center y + 0.5 at x0 + dx * (y + 0.5 - y0) / dy, and the pixel center is at x + 0.5. Exact, in integers.
+ */
+static inline int64_t edge_start_pixel(const bitmask_edge_t &edge, int64_t y)
+{
+    return ceil_div((2 * edge.x0 - 1) * edge.dy + edge.dx * (2 * (y - edge.y0) + 1), 2 * edge.dy);
+}
+
+void fill_polygon_bitmask(const std::vector<bitmask_point_t> &points, const roi_t &clip, uint8_t *bitmask,
+                          uint32_t bytes_per_line)
+{
+    if (points.size() < 3 || clip.width == 0 || clip.height == 0)
+        return;
+
+    // Collect the edges - horizontal ones never cross a row center
+    std::vector<bitmask_edge_t> edges;
+    edges.reserve(points.size());
+    int64_t y_min = INT64_MAX, y_max = INT64_MIN;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const bitmask_point_t &p0 = points[i];
+        const bitmask_point_t &p1 = points[(i + 1) % points.size()];
+        if (p0.y == p1.y)
+            continue;
+        const bitmask_point_t &top = p0.y < p1.y ? p0 : p1;
+        const bitmask_point_t &bottom = p0.y < p1.y ? p1 : p0;
+        edges.push_back({top.x, top.y, bottom.x - top.x, bottom.y - top.y});
+        y_min = std::min<int64_t>(y_min, top.y);
+        y_max = std::max<int64_t>(y_max, bottom.y);
+    }
+    if (edges.empty())
+        return;
+
+    // An edge is active in the rows [y0, y0 + dy), whose centers are between its vertices
+    int64_t clip_x0 = clip.x, clip_x1 = static_cast<int64_t>(clip.x) + clip.width;
+    int64_t row_start = std::max<int64_t>(y_min, clip.y);
+    int64_t row_end = std::min<int64_t>(y_max, static_cast<int64_t>(clip.y) + clip.height);
+    std::vector<int64_t> crossings;
+    crossings.reserve(edges.size());
+    for (int64_t y = row_start; y < row_end; y++)
+    {
+        crossings.clear();
+        for (const bitmask_edge_t &edge : edges)
+        {
+            if (y >= edge.y0 && y < edge.y0 + edge.dy)
+                crossings.push_back(edge_start_pixel(edge, y));
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        // Even-odd rule - the pixels between each pair of crossings are inside
+        uint8_t *row = bitmask + static_cast<size_t>(y) * bytes_per_line;
+        for (size_t i = 0; i + 1 < crossings.size(); i += 2)
+        {
+            int64_t start = std::max(crossings[i], clip_x0);
+            int64_t end = std::min(crossings[i + 1], clip_x1);
+            if (start < end)
+                fill_bitmask_span(row, static_cast<uint32_t>(start), static_cast<uint32_t>(end));
+        }
+    }
+}
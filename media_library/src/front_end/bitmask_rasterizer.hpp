@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file bitmask_rasterizer.hpp
+ * @brief Polygon and rectangle rasterizer for bit per pixel bitmasks
+ **/
+
+#pragma once
+#include "media_library_types.hpp"
+#include <vector>
+
+/**
+ * The bitmask has a bit per pixel, packed from the most significant bit of each byte, rows of bytes_per_line bytes.
+ * bytes_per_line must be a multiple of 8 - spans are filled a 64 bit word at a time.
+ */
+
+/**
+ * @brief A polygon vertex in bitmask pixels
+ */
+struct bitmask_point_t
+{
+    int x;
+    int y;
+};
+
+/**
+ * @brief Sets the pixels [x_start, x_end) of a bitmask row.
+ *
+ * @param[in] row - the bitmask row
+ * @param[in] x_start - first pixel to set
+ * @param[in] x_end - the pixel after the last one to set
+ */
+void fill_bitmask_span(uint8_t *row, uint32_t x_start, uint32_t x_end);
+
+/**
+ * @brief Clears a rectangle of a bitmask.
+ *
+ * @param[in] bitmask - the bitmask
+ * @param[in] bytes_per_line - the stride of the bitmask in bytes
+ * @param[in] rect - the rectangle to clear
+ */
+void clear_bitmask_rect(uint8_t *bitmask, uint32_t bytes_per_line, const roi_t &rect);
+
+/**
+ * @brief Sets the pixels of a rectangle of a bitmask.
+ *
+ * @param[in] bitmask - the bitmask
+ * @param[in] bytes_per_line - the stride of the bitmask in bytes
+ * @param[in] rect - the rectangle to set
+ */
+void fill_bitmask_rect(uint8_t *bitmask, uint32_t bytes_per_line, const roi_t &rect);
+
+/**
+ * @brief Sets the pixels of a polygon inside a clip rectangle of a bitmask. Pixels outside the clip are untouched,
+ * so a polygon drawn through a clip sets exactly the pixels of the whole one which are inside it.
+ *
+ * A pixel is set when its center is inside the polygon, by the even-odd rule. A pixel center on a left edge is
+ * inside and on a right edge is outside, so adjacent polygons do not overlap.
+ *
+ * @param[in] points - the vertices of the polygon
+ * @param[in] clip - the rectangle to draw in, inside the bitmask
+ * @param[in] bitmask - the bitmask
+ * @param[in] bytes_per_line - the stride of the bitmask in bytes
+ */
+void fill_polygon_bitmask(const std::vector<bitmask_point_t> &points, const roi_t &clip, uint8_t *bitmask,
+                          uint32_t bytes_per_line);
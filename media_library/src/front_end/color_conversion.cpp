@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "color_conversion.hpp"
+#include "media_library_logger.hpp"
+
+// BT.601 limited range coefficients, scaled by 2^COLOR_COEF_SHIFT
+// R = 1.164 (Y - 16) + 1.596 (V - 128)
+// G = 1.164 (Y - 16) - 0.813 (V - 128) - 0.391 (U - 128)
+// B = 1.164 (Y - 16) + 2.018 (U - 128)
+#define COLOR_COEF_SHIFT (6)
+// The luma coefficient needs one more bit of precision: (Y - 16) * COLOR_COEF_Y2 >> 1
+#define COLOR_COEF_Y2 (149)
+#define COLOR_COEF_V_TO_R (102)
+#define COLOR_COEF_V_TO_G (52)
+#define COLOR_COEF_U_TO_G (25)
+#define COLOR_COEF_U_TO_B (129)
+#define COLOR_COEF_ROUND (1 << (COLOR_COEF_SHIFT - 1))
+
+static inline uint8_t saturate_u8(int value)
+{
+    return (uint8_t)std::clamp(value, 0, 255);
+}
+
+static inline void yuv_to_rgb_pixel(int y, int u, int v, uint8_t &r, uint8_t &g, uint8_t &b)
+{
+    int luma = (std::max(y - 16, 0) * COLOR_COEF_Y2) >> 1;
+    r = saturate_u8((luma + COLOR_COEF_V_TO_R * v + COLOR_COEF_ROUND) >> COLOR_COEF_SHIFT);
+    g = saturate_u8((luma - COLOR_COEF_V_TO_G * v - COLOR_COEF_U_TO_G * u + COLOR_COEF_ROUND) >> COLOR_COEF_SHIFT);
+    b = saturate_u8((luma + COLOR_COEF_U_TO_B * u + COLOR_COEF_ROUND) >> COLOR_COEF_SHIFT);
+}
+
+#if defined(__ARM_NEON)
+/**
+ * @brief Converts 16 pixels (16 luma samples and 8 interleaved UV pairs) to R, G and B vectors.
+ * Produces the same results as yuv_to_rgb_pixel: the 16 bit intermediates saturate only
+ * where the final value is clamped to 255 anyway.
+ */
+static inline uint8x16x3_t yuv_to_rgb_neon(const uint8_t *y_row, const uint8_t *uv_row)
+{
+    uint8x16_t y = vqsubq_u8(vld1q_u8(y_row), vdupq_n_u8(16));
+    uint8x8_t luma_coef = vdup_n_u8(COLOR_COEF_Y2);
+    int16x8_t luma_low = vreinterpretq_s16_u16(vshrq_n_u16(vmull_u8(vget_low_u8(y), luma_coef), 1));
+    int16x8_t luma_high = vreinterpretq_s16_u16(vshrq_n_u16(vmull_u8(vget_high_u8(y), luma_coef), 1));
+
+    int16x8_t u = vdupq_n_s16(0);
+    int16x8_t v = vdupq_n_s16(0);
+    if (uv_row != nullptr)
+    {
+        uint8x8x2_t uv = vld2_u8(uv_row);
+        u = vreinterpretq_s16_u16(vsubl_u8(uv.val[0], vdup_n_u8(128)));
+        v = vreinterpretq_s16_u16(vsubl_u8(uv.val[1], vdup_n_u8(128)));
+    }
+
+    // Each chroma sample covers two horizontal pixels
+    int16x8x2_t r_chroma = vzipq_s16(vmulq_n_s16(v, COLOR_COEF_V_TO_R), vmulq_n_s16(v, COLOR_COEF_V_TO_R));
+    int16x8_t g_diff = vaddq_s16(vmulq_n_s16(v, COLOR_COEF_V_TO_G), vmulq_n_s16(u, COLOR_COEF_U_TO_G));
+    int16x8x2_t g_chroma = vzipq_s16(g_diff, g_diff);
+    int16x8x2_t b_chroma = vzipq_s16(vmulq_n_s16(u, COLOR_COEF_U_TO_B), vmulq_n_s16(u, COLOR_COEF_U_TO_B));
+
+    uint8x16x3_t rgb;
+    rgb.val[0] = vcombine_u8(vqrshrun_n_s16(vqaddq_s16(luma_low, r_chroma.val[0]), COLOR_COEF_SHIFT),
+                             vqrshrun_n_s16(vqaddq_s16(luma_high, r_chroma.val[1]), COLOR_COEF_SHIFT));
+    rgb.val[1] = vcombine_u8(vqrshrun_n_s16(vqsubq_s16(luma_low, g_chroma.val[0]), COLOR_COEF_SHIFT),
+                             vqrshrun_n_s16(vqsubq_s16(luma_high, g_chroma.val[1]), COLOR_COEF_SHIFT));
+    rgb.val[2] = vcombine_u8(vqrshrun_n_s16(vqaddq_s16(luma_low, b_chroma.val[0]), COLOR_COEF_SHIFT),
+                             vqrshrun_n_s16(vqaddq_s16(luma_high, b_chroma.val[1]), COLOR_COEF_SHIFT));
+    return rgb;
+}
+#endif
+
+/**
+ * @brief Converts a single row.
+ * For packed formats out[0] is the row start, for planar RGB out[0..2] are the R, G and B rows.
+ * uv_row is nullptr for GRAY8 sources.
+ */
+static void convert_row(const uint8_t *y_row, const uint8_t *uv_row, uint8_t *out[3],
+                        color_format_t color_format, uint32_t width)
+{
+    uint32_t x = 0;
+#if defined(__ARM_NEON)
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16x3_t rgb = yuv_to_rgb_neon(y_row + x, uv_row ? uv_row + x : nullptr);
+        switch (color_format)
+        {
+        case COLOR_FORMAT_BGR:
+            std::swap(rgb.val[0], rgb.val[2]);
+            vst3q_u8(out[0] + x * 3, rgb);
+            break;
+        case COLOR_FORMAT_RGB_PLANAR:
+            vst1q_u8(out[0] + x, rgb.val[0]);
+            vst1q_u8(out[1] + x, rgb.val[1]);
+            vst1q_u8(out[2] + x, rgb.val[2]);
+            break;
+        default:
+            vst3q_u8(out[0] + x * 3, rgb);
+            break;
+        }
+    }
+#endif
+    for (; x < width; x++)
+    {
+        int u = uv_row ? uv_row[x & ~1u] - 128 : 0;
+        int v = uv_row ? uv_row[(x & ~1u) + 1] - 128 : 0;
+        uint8_t r, g, b;
+        yuv_to_rgb_pixel(y_row[x], u, v, r, g, b);
+        switch (color_format)
+        {
+        case COLOR_FORMAT_BGR:
+            out[0][x * 3] = b;
+            out[0][x * 3 + 1] = g;
+            out[0][x * 3 + 2] = r;
+            break;
+        case COLOR_FORMAT_RGB_PLANAR:
+            out[0][x] = r;
+            out[1][x] = g;
+            out[2][x] = b;
+            break;
+        default:
+            out[0][x * 3] = r;
+            out[0][x * 3 + 1] = g;
+            out[0][x * 3 + 2] = b;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Applies the normalization lookup tables on a converted row, while it is still in cache.
+ */
+static void normalize_row(uint8_t *out[3], color_format_t color_format, uint32_t width,
+                          const normalization_lut_t &lut)
+{
+    if (color_format == COLOR_FORMAT_RGB_PLANAR)
+    {
+        for (uint8_t c = 0; c < 3; c++)
+        {
+            const uint8_t *table = lut.channel[c];
+            uint8_t *row = out[c];
+            for (uint32_t x = 0; x < width; x++)
+                row[x] = table[row[x]];
+        }
+        return;
+    }
+
+    // Packed layouts: BGR stores the blue channel first
+    const uint8_t *first = lut.channel[color_format == COLOR_FORMAT_BGR ? 2 : 0];
+    const uint8_t *second = lut.channel[1];
+    const uint8_t *third = lut.channel[color_format == COLOR_FORMAT_BGR ? 0 : 2];
+    uint8_t *row = out[0];
+    for (uint32_t x = 0; x < width; x++)
+    {
+        row[x * 3] = first[row[x * 3]];
+        row[x * 3 + 1] = second[row[x * 3 + 1]];
+        row[x * 3 + 2] = third[row[x * 3 + 2]];
+    }
+}
+
+media_library_return build_normalization_lut(const normalization_config_t &normalization, normalization_lut_t &lut)
+{
+    if (!(normalization.quant_scale > 0))
+    {
+        LOGGER__ERROR("Invalid normalization quantization scale {}, must be positive", normalization.quant_scale);
+        return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+    }
+
+    for (uint8_t c = 0; c < 3; c++)
+    {
+        for (int value = 0; value < 256; value++)
+        {
+            float normalized = ((float)value - normalization.mean[c]) * normalization.scale[c];
+            long quantized = std::lround(normalized / normalization.quant_scale + normalization.quant_zero_point);
+            if (quantized < 0 || quantized > 255)
+            {
+                LOGGER__ERROR("Normalization of channel {} (mean {} scale {}) maps {} to {}, which quantization (scale {} zero point {}) "
+                              "takes out of [0, 255]", c, normalization.mean[c], normalization.scale[c], value, normalized,
+                              normalization.quant_scale, normalization.quant_zero_point);
+                return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+            }
+            lut.channel[c][value] = (uint8_t)quantized;
+        }
+    }
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+media_library_return convert_yuv_to_rgb(const dsp_image_properties_t &src, dsp_image_properties_t &dst,
+                                        color_format_t color_format, const normalization_lut_t *lut)
+{
+    bool planar = color_format == COLOR_FORMAT_RGB_PLANAR;
+    if (color_format == COLOR_FORMAT_SOURCE || color_format >= COLOR_FORMAT_MAX)
+    {
+        LOGGER__ERROR("Invalid color format {} for YUV to RGB conversion", color_format);
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+    if (src.format != DSP_IMAGE_FORMAT_NV12 && src.format != DSP_IMAGE_FORMAT_GRAY8)
+    {
+        LOGGER__ERROR("YUV to RGB conversion supports only NV12 and GRAY8 sources, got format {}", src.format);
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+    if (dst.format != DSP_IMAGE_FORMAT_RGB || dst.planes_count != (planar ? 3u : 1u))
+    {
+        LOGGER__ERROR("Invalid destination for YUV to RGB conversion, format {} planes {}", dst.format, dst.planes_count);
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+    if (src.width != dst.width || src.height != dst.height)
+    {
+        LOGGER__ERROR("YUV to RGB conversion source size {}x{} differs from destination size {}x{}",
+                      src.width, src.height, dst.width, dst.height);
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+
+    bool has_chroma = src.format == DSP_IMAGE_FORMAT_NV12;
+    const uint8_t *y_plane = (const uint8_t *)src.planes[0].userptr;
+    const uint8_t *uv_plane = has_chroma ? (const uint8_t *)src.planes[1].userptr : nullptr;
+    size_t y_stride = src.planes[0].bytesperline;
+    size_t uv_stride = has_chroma ? src.planes[1].bytesperline : 0;
+
+    for (uint32_t row = 0; row < src.height; row++)
+    {
+        uint8_t *out[3] = {nullptr, nullptr, nullptr};
+        for (uint32_t p = 0; p < dst.planes_count; p++)
+            out[p] = (uint8_t *)dst.planes[p].userptr + row * dst.planes[p].bytesperline;
+
+        convert_row(y_plane + row * y_stride, has_chroma ? uv_plane + (row / 2) * uv_stride : nullptr,
+                    out, color_format, src.width);
+        if (lut != nullptr)
+            normalize_row(out, color_format, src.width, *lut);
+    }
+
+    return MEDIA_LIBRARY_SUCCESS;
+}
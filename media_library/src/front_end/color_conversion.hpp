@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file color_conversion.hpp
+ * @brief MediaLibrary color conversion CPP API module
+ **/
+
+#pragma once
+#include "media_library_types.hpp"
+
+/**
+ * @brief Per-channel lookup tables implementing the quantized mean/scale normalization of 8 bit values.
+ * Indexed by [channel][value] with channels in R, G, B order.
+ */
+struct normalization_lut_t
+{
+    uint8_t channel[3][256];
+};
+
+/**
+ * @brief Builds the normalization lookup tables for a normalization configuration.
+ * Every input value is normalized, then quantized with the quantization scale and zero point and rounded.
+ * A quantization which does not hold the normalized range within [0, 255] is rejected rather than clamped.
+ *
+ * @param[in] normalization - the normalization configuration
+ * @param[out] lut - the lookup tables to fill
+ * @return media_library_return - MEDIA_LIBRARY_CONFIGURATION_ERROR if the quantized values leave [0, 255]
+ */
+media_library_return build_normalization_lut(const normalization_config_t &normalization, normalization_lut_t &lut);
+
+/**
+ * @brief Converts an NV12 (or GRAY8) image into an RGB, BGR or planar RGB image of the same size.
+ * The conversion uses BT.601 limited range coefficients in fixed point, and applies the
+ * normalization lookup tables on the fly when given.
+ *
+ * @param[in] src - the source NV12 or GRAY8 image
+ * @param[out] dst - the destination RGB image (single packed plane, or three planes for planar RGB)
+ * @param[in] color_format - the destination color format
+ * @param[in] lut - optional normalization lookup tables, nullptr to skip normalization
+ * @return media_library_return - status of the conversion
+ */
+media_library_return convert_yuv_to_rgb(const dsp_image_properties_t &src, dsp_image_properties_t &dst,
+                                        color_format_t color_format, const normalization_lut_t *lut);
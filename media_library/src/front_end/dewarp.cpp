@@ -24,8 +24,9 @@
 #include "dewarp.hpp"
 #include "buffer_pool.hpp"
 #include "config_manager.hpp"
+#include "dsp_scheduler.hpp"
 #include "dsp_utils.hpp"
-#include "ldc_mesh_context.hpp"
+#include "dewarp_mesh_context.hpp"
 #include "media_library_logger.hpp"
 #include "media_library_utils.hpp"
 #include <iostream>
@@ -84,7 +85,7 @@ public:
     media_library_return observe(const MediaLibraryDewarp::callbacks_t &callbacks);
 
 private:
-    std::unique_ptr<LdcMeshContext> m_dewarp_mesh_ctx;
+    std::unique_ptr<DewarpMeshContext> m_dewarp_mesh_ctx;
     // configured flag - to determine if first configuration was done
     bool m_configured;
     // frame counter - used internally for matching requested framerate
@@ -97,12 +98,15 @@ private:
     MediaLibraryBufferPoolPtr m_output_buffer_pool;
     // video fd
     int m_video_fd;
+    // sensor of the input frames, for sharing the DSP with other sensors
+    dsp_scheduler::sensor_id_t m_dsp_sensor_id;
     // configuration mutex
     std::shared_mutex rw_lock;
 
     std::vector<MediaLibraryDewarp::callbacks_t> m_callbacks;
     media_library_return decode_config_json_string(ldc_config_t &ldc_configs, std::string config_string);
     media_library_return create_and_initialize_buffer_pools();
+    void register_dsp_sensor();
     media_library_return validate_input_frame(hailo_media_library_buffer &input_frame);
     media_library_return perform_dewarp(hailo_media_library_buffer &input_buffer, hailo_media_library_buffer &dewarp_output_buffer);
     void stamp_time_and_log_fps(timespec &start_handle, timespec &end_handle);
@@ -185,6 +189,7 @@ MediaLibraryDewarp::Impl::Impl(media_library_return &status, std::string config_
 {
     m_configured = false;
     m_video_fd = -1;
+    m_dsp_sensor_id = dsp_scheduler::invalid_sensor_id;
 
     // Start frame count from 0 - to make sure we always handle the first frame even if framerate is set to 0
     m_frame_counter = 0;
@@ -204,7 +209,7 @@ MediaLibraryDewarp::Impl::Impl(media_library_return &status, std::string config_
         return;
     }
 
-    m_dewarp_mesh_ctx = std::make_unique<LdcMeshContext>(m_ldc_configs);
+    m_dewarp_mesh_ctx = std::make_unique<DewarpMeshContext>(m_ldc_configs);
     if (configure(m_ldc_configs) != MEDIA_LIBRARY_SUCCESS)
     {
         LOGGER__ERROR("Failed to configure dewarp");
@@ -218,6 +223,8 @@ MediaLibraryDewarp::Impl::Impl(media_library_return &status, std::string config_
 MediaLibraryDewarp::Impl::~Impl()
 {
     m_dewarp_mesh_ctx = nullptr;
+    m_output_buffer_pool = nullptr;
+    dsp_scheduler::unregister_sensor(m_dsp_sensor_id);
     dsp_status status = dsp_utils::release_device();
     if (status != DSP_SUCCESS)
     {
@@ -354,18 +361,22 @@ media_library_return MediaLibraryDewarp::Impl::perform_dewarp(
         MEDIA_LIBRARY_SUCCESS)
     {
         // log: failed to acquire buffer for dewarp output
+        dsp_scheduler::record_dropped_frame(m_dsp_sensor_id);
         return MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
     }
 
     // Perform dewarp
-    dsp_dewarp_mesh_t *mesh = m_dewarp_mesh_ctx->get();
+    // Held until the DSP is done with it, so the mesh context does not reuse it meanwhile
+    DspDewarpMeshPtr mesh = m_dewarp_mesh_ctx->get();
     dsp_image_properties_t *image = dewarp_output_buffer.hailo_pix_buffer.get();
     LOGGER__TRACE("Performing dewarp with mesh (w={}, h={}) interpolation type {}", mesh->mesh_width, mesh->mesh_height, m_ldc_configs.dewarp_config.interpolation_type);
     clock_gettime(CLOCK_MONOTONIC, &start_dewarp);
+    dsp_scheduler::job_t dsp_job = dsp_scheduler::begin_job(m_dsp_sensor_id);
     dsp_status ret = dsp_utils::perform_dsp_dewarp(
         input_buffer.hailo_pix_buffer.get(),
-        image, mesh,
+        image, mesh.get(),
         m_ldc_configs.dewarp_config.interpolation_type);
+    dsp_scheduler::end_job(dsp_job);
     clock_gettime(CLOCK_MONOTONIC, &end_dewarp);
     [[maybe_unused]] long ms = (long)media_library_difftimespec_ms(end_dewarp, start_dewarp);
     LOGGER__TRACE("perform_dsp_dewarp took {} milliseconds ({} fps)", ms, (1000 / ms));
@@ -413,6 +424,7 @@ media_library_return MediaLibraryDewarp::Impl::handle_frame(hailo_media_library_
     // Stamp start time
     struct timespec start_handle, end_handle;
     clock_gettime(CLOCK_MONOTONIC, &start_handle);
+    input_frame.latency.stamp_start(FRAME_LATENCY_STAGE_DEWARP);
 
     if (validate_input_frame(input_frame) != MEDIA_LIBRARY_SUCCESS)
     {
@@ -428,6 +440,8 @@ media_library_return MediaLibraryDewarp::Impl::handle_frame(hailo_media_library_
         m_dewarp_mesh_ctx->on_frame_vsm_update(input_frame.vsm);
     media_lib_ret = perform_dewarp(input_frame, output_frame);
     output_frame.isp_ae_fps = input_frame.isp_ae_fps;
+    input_frame.latency.stamp_end(FRAME_LATENCY_STAGE_DEWARP);
+    output_frame.latency = input_frame.latency;
 
     // Unref the input frame
     input_frame.decrease_ref_count();
@@ -494,6 +508,7 @@ media_library_return MediaLibraryDewarp::Impl::set_input_video_config(uint32_t w
     m_ldc_configs.input_video_config.resolution.dimensions.destination_height = height;
     m_ldc_configs.input_video_config.resolution.framerate = framerate;
     m_ldc_configs.input_video_config.format = format;
+    register_dsp_sensor();
 
     m_ldc_configs.output_video_config.dimensions.destination_width = width;
     m_ldc_configs.output_video_config.dimensions.destination_height = height;
@@ -505,10 +520,23 @@ media_library_return MediaLibraryDewarp::Impl::set_input_video_config(uint32_t w
     new_conf.rotation_config.angle = m_ldc_configs.rotation_config.angle;
     m_ldc_configs.rotation_config.angle = rotation_angle_t::ROTATION_ANGLE_0;
 
-    // reconfigure ldc_mesh_context and buffer pool since we updated the config
+    // reconfigure the dewarp mesh context and buffer pool since we updated the config
     return configure(new_conf);
 }
 
+/**
+ * @brief Register the sensor of the input frames for DSP scheduling
+ * Replaces the previous registration, since the framerate of the sensor is known only once
+ * the input video configuration is set.
+ */
+void MediaLibraryDewarp::Impl::register_dsp_sensor()
+{
+    dsp_scheduler::sensor_id_t prev_sensor_id = m_dsp_sensor_id;
+    m_dsp_sensor_id = dsp_scheduler::register_sensor(m_ldc_configs.input_video_config.video_device,
+                                                     m_ldc_configs.input_video_config.resolution.framerate);
+    dsp_scheduler::unregister_sensor(prev_sensor_id);
+}
+
 media_library_return MediaLibraryDewarp::Impl::observe(const MediaLibraryDewarp::callbacks_t &callbacks)
 {
     m_callbacks.push_back(callbacks);
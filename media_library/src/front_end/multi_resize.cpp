@@ -23,11 +23,15 @@
 
 #include "multi_resize.hpp"
 #include "buffer_pool.hpp"
+#include "color_conversion.hpp"
 #include "config_manager.hpp"
+#include "dsp_scheduler.hpp"
 #include "dsp_utils.hpp"
 #include "media_library_logger.hpp"
 #include "media_library_utils.hpp"
 #include "privacy_mask.hpp"
+#include "polygon_math.hpp"
+#include <cstring>
 #include <iostream>
 #include <stdint.h>
 #include <string>
@@ -35,7 +39,95 @@
 #include <tl/expected.hpp>
 #include <vector>
 #include <shared_mutex>
+#include <algorithm>
+#include <atomic>
 #define MAKE_EVEN(value) ((value) % 2 != 0 ? (value) + 1 : (value))
+#define FLOOR_EVEN(value) ((value) & ~1u)
+
+// Maximum number of outputs that a single DSP multi-resize operation can write to
+#define MAX_OUTPUTS_PER_MULTI_RESIZE (sizeof(dsp_multi_resize_params_t::dst) / sizeof(dsp_multi_resize_params_t::dst[0]))
+
+// Letterbox padding tags, a new one for every padding geometry and color
+static std::atomic<uint64_t> next_padding_tag{1};
+
+/**
+ * @brief Region of the input frame that a group of outputs is resized from
+ */
+struct crop_region_t
+{
+    uint start_x;
+    uint start_y;
+    uint end_x;
+    uint end_y;
+
+    bool operator==(const crop_region_t &other) const = default;
+};
+
+/**
+ * @brief Outputs that share the same crop region - served by a single DSP multi-resize operation
+ */
+struct multi_resize_group_t
+{
+    crop_region_t crop;
+    dsp_multi_resize_params_t params;
+    uint num_of_outputs;
+};
+
+/**
+ * @brief Per-output state of the scaling modes and of the color conversion
+ */
+struct output_context_t
+{
+    // View of the content rectangle inside the output buffer - the DSP resizes into it
+    dsp_image_properties_t content_view;
+    dsp_data_plane_t content_planes[2];
+    // Padding geometry and color of the output, and the buffer tag of the buffers padded with them.
+    // Pool buffers come back in any order, so whether a buffer still holds this padding is recorded
+    // in its pool rather than here.
+    roi_t content_roi;
+    pad_color_t pad_color;
+    uint64_t padding_tag;
+    // Outputs converted to RGB are resized into this buffer, then converted into the output buffer on the CPU -
+    // the DSP multi-resize writes only the input color format
+    MediaLibraryBufferPoolPtr conversion_pool;
+    hailo_media_library_buffer conversion_buffer;
+    // Normalization lookup tables, and the configuration they were built from
+    normalization_config_t lut_normalization;
+    normalization_lut_t normalization_lut;
+    // Consumer occupancy as reported by the owner of the output, and the resulting skipping state
+    uint32_t consumer_queued_buffers;
+    uint32_t consumer_max_queued_buffers;
+    bool consumer_saturated;
+    uint64_t consumer_skipped_frames;
+    // Buffers acquired for this output and not released by its consumer yet
+    std::vector<std::weak_ptr<dsp_image_properties_t>> in_flight_buffers;
+};
+
+/**
+ * @brief A region of interest stream, added at runtime next to the configured outputs
+ */
+struct roi_stream_t
+{
+    uint32_t id;
+    // Resolution of the stream, its crop region is the ROI
+    output_resolution_t output_res;
+    // The ROI does not fit in the input frame since the input resolution changed - skipped until moved
+    bool roi_out_of_frame;
+    // Allocated when the stream is added, freed when it is removed
+    MediaLibraryBufferPoolPtr buffer_pool;
+    output_context_t context;
+    MediaLibraryMultiResize::roi_stream_callback_t on_frame;
+};
+
+/**
+ * @brief A frame of a region of interest stream, waiting to be delivered to its callback
+ */
+struct roi_stream_delivery_t
+{
+    uint32_t stream_id;
+    MediaLibraryMultiResize::roi_stream_callback_t on_frame;
+    HailoMediaLibraryBufferPtr frame;
+};
 
 class MediaLibraryMultiResize::Impl final
 {
@@ -74,6 +166,21 @@ public:
     // set the output video rotation
     media_library_return set_output_rotation(const rotation_angle_t &rotation);
 
+    // set the crop region of a specific output
+    media_library_return set_output_crop_roi(uint32_t output_index, bool enabled, const roi_t &roi);
+
+    // set the consumer occupancy of a specific output
+    media_library_return set_output_consumer_level(uint32_t output_index, uint32_t queued_buffers, uint32_t max_queued_buffers);
+
+    // add a region of interest stream
+    tl::expected<uint32_t, media_library_return> add_roi_stream(const output_resolution_t &output_res, const roi_t &roi, roi_stream_callback_t on_frame);
+
+    // move the region of a region of interest stream
+    media_library_return set_roi_stream_roi(uint32_t stream_id, const roi_t &roi);
+
+    // remove a region of interest stream
+    media_library_return remove_roi_stream(uint32_t stream_id);
+
     // set the callbacks object
     media_library_return observe(const MediaLibraryMultiResize::callbacks_t &callbacks);
 
@@ -95,14 +202,39 @@ private:
     std::vector<MediaLibraryBufferPoolPtr> m_buffer_pools;
     // read/write lock for configuration manipulation/reading
     std::shared_mutex rw_lock;
+    // DSP operations of the current frame, grouped by crop region (kept as a member to avoid per-frame allocations)
+    std::vector<multi_resize_group_t> m_resize_groups;
+    // per-output scaling mode and color conversion state
+    std::vector<output_context_t> m_output_contexts;
+    // region of interest streams, resized after the configured outputs
+    std::vector<roi_stream_t> m_roi_streams;
+    uint32_t m_next_roi_stream_id;
+    // sensor of the input frames, for sharing the DSP with other sensors
+    dsp_scheduler::sensor_id_t m_dsp_sensor_id;
 
     media_library_return validate_configurations(multi_resize_config_t &mresize_config);
     media_library_return decode_config_json_string(multi_resize_config_t &mresize_config, std::string config_string);
     media_library_return acquire_output_buffers(hailo_media_library_buffer &input_buffer, std::vector<hailo_media_library_buffer> &buffers);
+    void acquire_roi_stream_buffers(hailo_media_library_buffer &input_buffer, std::vector<hailo_media_library_buffer> &buffers);
+    void collect_roi_stream_frames(std::vector<hailo_media_library_buffer> &output_frames, bool deliver,
+                                   std::vector<roi_stream_delivery_t> &deliveries);
+    bool should_handle_output_frame(uint32_t output_framerate, int32_t isp_ae_fps);
+    output_resolution_t &get_output_resolution(uint output_index);
+    output_context_t &get_output_context(uint output_index);
+    bool is_output_consumer_saturated(uint output_index);
+    bool crop_roi_in_input_frame(const roi_t &roi);
     media_library_return create_and_initialize_buffer_pools();
+    media_library_return create_conversion_buffer(uint output_index, uint width, uint height);
+    void release_conversion_buffer(output_context_t &output_context);
     media_library_return validate_input_and_output_frames(hailo_media_library_buffer &input_frame, std::vector<hailo_media_library_buffer> &output_frames);
     media_library_return perform_multi_resize(hailo_media_library_buffer &input_buffer, std::vector<hailo_media_library_buffer> &output_frames);
     media_library_return configure_internal(multi_resize_config_t &mresize_config);
+    media_library_return get_digital_zoom_crop(crop_region_t &crop);
+    media_library_return get_output_crop(output_resolution_t &output_res, const crop_region_t &default_crop, crop_region_t &crop);
+    media_library_return prepare_output_scaling(uint output_index, hailo_media_library_buffer &output_frame, crop_region_t &crop, dsp_image_properties_t *&resize_target);
+    void fill_padding(dsp_image_properties_t *output_frame, const pad_color_t &pad_color);
+    media_library_return group_outputs_by_crop(hailo_media_library_buffer &input_buffer, std::vector<hailo_media_library_buffer> &output_frames, const crop_region_t &default_crop);
+    media_library_return convert_output_colors(std::vector<hailo_media_library_buffer> &output_frames);
     void stamp_time_and_log_fps(timespec &start_handle, timespec &end_handle);
     void increase_frame_counter();
 };
@@ -161,6 +293,31 @@ media_library_return MediaLibraryMultiResize::set_output_rotation(const rotation
     return m_impl->set_output_rotation(rotation);
 }
 
+media_library_return MediaLibraryMultiResize::set_output_crop_roi(uint32_t output_index, bool enabled, const roi_t &roi)
+{
+    return m_impl->set_output_crop_roi(output_index, enabled, roi);
+}
+
+media_library_return MediaLibraryMultiResize::set_output_consumer_level(uint32_t output_index, uint32_t queued_buffers, uint32_t max_queued_buffers)
+{
+    return m_impl->set_output_consumer_level(output_index, queued_buffers, max_queued_buffers);
+}
+
+tl::expected<uint32_t, media_library_return> MediaLibraryMultiResize::add_roi_stream(const output_resolution_t &output_res, const roi_t &roi, roi_stream_callback_t on_frame)
+{
+    return m_impl->add_roi_stream(output_res, roi, on_frame);
+}
+
+media_library_return MediaLibraryMultiResize::set_roi_stream_roi(uint32_t stream_id, const roi_t &roi)
+{
+    return m_impl->set_roi_stream_roi(stream_id, roi);
+}
+
+media_library_return MediaLibraryMultiResize::remove_roi_stream(uint32_t stream_id)
+{
+    return m_impl->remove_roi_stream(stream_id);
+}
+
 media_library_return MediaLibraryMultiResize::observe(const MediaLibraryMultiResize::callbacks_t &callbacks)
 {
     return m_impl->observe(callbacks);
@@ -182,10 +339,13 @@ tl::expected<std::shared_ptr<MediaLibraryMultiResize::Impl>, media_library_retur
 MediaLibraryMultiResize::Impl::Impl(media_library_return &status, std::string config_string)
 {
     m_configured = false;
+    m_dsp_sensor_id = dsp_scheduler::invalid_sensor_id;
+    m_next_roi_stream_id = 0;
 
     // Start frame count from 0 - to make sure we always handle the first frame even if framerate is set to 0
     m_frame_counter = 0;
     m_buffer_pools.reserve(5);
+    m_resize_groups.reserve(5);
     m_config_manager = std::make_shared<ConfigManager>(ConfigSchema::CONFIG_SCHEMA_MULTI_RESIZE);
     m_multi_resize_config.output_video_config.resolutions.reserve(5);
     if (decode_config_json_string(m_multi_resize_config, config_string) != MEDIA_LIBRARY_SUCCESS)
@@ -214,6 +374,8 @@ MediaLibraryMultiResize::Impl::Impl(media_library_return &status, std::string co
     if (blender_expected.has_value())
     {
         m_privacy_mask_blender = blender_expected.value();
+        if (m_multi_resize_config.rotation_config != ROTATION_ANGLE_0)
+            m_privacy_mask_blender->set_rotation(m_multi_resize_config.rotation_config);
     }
     else
     {
@@ -226,7 +388,12 @@ MediaLibraryMultiResize::Impl::Impl(media_library_return &status, std::string co
 
 MediaLibraryMultiResize::Impl::~Impl()
 {
+    for (output_context_t &output_context : m_output_contexts)
+        release_conversion_buffer(output_context);
+    m_roi_streams.clear();
+    m_buffer_pools.clear();
     m_multi_resize_config.output_video_config.resolutions.clear();
+    dsp_scheduler::unregister_sensor(m_dsp_sensor_id);
     dsp_status status = dsp_utils::release_device();
     if (status != DSP_SUCCESS)
     {
@@ -254,6 +421,7 @@ media_library_return MediaLibraryMultiResize::Impl::validate_configurations(mult
 {
     // Make sure that the output fps of each stream is divided by the input fps with no reminder
     output_resolution_t &input_res = mresize_config.input_video_config;
+    dsp_image_format_t output_format = mresize_config.output_video_config.format;
     for (output_resolution_t &output_res : mresize_config.output_video_config.resolutions)
     {
         if (output_res.framerate != 0 && input_res.framerate % output_res.framerate != 0)
@@ -261,6 +429,41 @@ media_library_return MediaLibraryMultiResize::Impl::validate_configurations(mult
             LOGGER__ERROR("Invalid output framerate {} - must be a divider of the input framerate {}", output_res.framerate, input_res.framerate);
             return MEDIA_LIBRARY_CONFIGURATION_ERROR;
         }
+
+        // The input resolution comes from the input caps, so the ROI is checked against the current one
+        if (output_res.dimensions.perform_crop && !crop_roi_in_input_frame(output_res.get_crop_roi()))
+        {
+            roi_t roi = output_res.get_crop_roi();
+            LOGGER__ERROR("Invalid output crop ROI x {} y {} width {} height {} - exceeds the input frame {}x{}", roi.x, roi.y, roi.width, roi.height,
+                          m_multi_resize_config.input_video_config.dimensions.destination_width,
+                          m_multi_resize_config.input_video_config.dimensions.destination_height);
+            return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+        }
+
+        if (output_res.scaling_mode == SCALING_MODE_LETTERBOX && output_format != DSP_IMAGE_FORMAT_NV12 && output_format != DSP_IMAGE_FORMAT_GRAY8)
+        {
+            LOGGER__ERROR("Letterbox scaling mode is supported only for NV12 and GRAY8 output formats");
+            return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+        }
+
+        if (output_res.color_conversion_required() && output_format != DSP_IMAGE_FORMAT_NV12 && output_format != DSP_IMAGE_FORMAT_GRAY8)
+        {
+            LOGGER__ERROR("RGB output color formats are supported only from NV12 and GRAY8 formats");
+            return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+        }
+
+        if (output_res.normalization.enabled && !output_res.color_conversion_required())
+        {
+            LOGGER__ERROR("Normalization is supported only for RGB output color formats");
+            return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+        }
+
+        normalization_lut_t normalization_lut;
+        if (output_res.normalization.enabled && build_normalization_lut(output_res.normalization, normalization_lut) != MEDIA_LIBRARY_SUCCESS)
+        {
+            LOGGER__ERROR("Invalid normalization - its quantization must hold the normalized values within [0, 255]");
+            return MEDIA_LIBRARY_CONFIGURATION_ERROR;
+        }
     }
 
     return MEDIA_LIBRARY_SUCCESS;
@@ -280,8 +483,16 @@ media_library_return MediaLibraryMultiResize::Impl::set_output_rotation(const ro
 
     m_multi_resize_config.set_output_dimensions_rotation(rotation);
 
+    // The frame size of the blender follows the input caps, rotated already
+    media_library_return ret = m_privacy_mask_blender->set_rotation(rotation);
+    if (ret != MEDIA_LIBRARY_SUCCESS)
+    {
+        LOGGER__ERROR("Failed to set privacy mask blender rotation");
+        return ret;
+    }
+
     // recreate buffer pools if needed
-    media_library_return ret = create_and_initialize_buffer_pools();
+    ret = create_and_initialize_buffer_pools();
     if (ret != MEDIA_LIBRARY_SUCCESS)
         return ret;
 
@@ -352,6 +563,7 @@ media_library_return MediaLibraryMultiResize::Impl::create_and_initialize_buffer
         m_buffer_pools.reserve(m_multi_resize_config.output_video_config.resolutions.size());
         first = true;
     }
+    m_output_contexts.resize(m_multi_resize_config.output_video_config.resolutions.size());
 
     for (uint i = 0; i < m_multi_resize_config.output_video_config.resolutions.size(); i++)
     {
@@ -363,12 +575,14 @@ media_library_return MediaLibraryMultiResize::Impl::create_and_initialize_buffer
         if (!first && m_buffer_pools[i] != nullptr && width == m_buffer_pools[i]->get_width() && height == m_buffer_pools[i]->get_height())
         {
             LOGGER__DEBUG("Buffer pool already exists, skipping creation");
-            return MEDIA_LIBRARY_SUCCESS;
+            continue;
         }
 
         auto bytes_per_line = dsp_utils::get_dsp_desired_stride_from_width((uint)output_res.dimensions.destination_width);
         LOGGER__INFO("Creating buffer pool for output resolution: width {} height {} in buffers size of {} and bytes per line {}", output_res.dimensions.destination_width, output_res.dimensions.destination_height, output_res.pool_max_buffers, bytes_per_line);
-        MediaLibraryBufferPoolPtr buffer_pool = std::make_shared<MediaLibraryBufferPool>(width, height, m_multi_resize_config.output_video_config.format, output_res.pool_max_buffers, CMA, bytes_per_line);
+        dsp_image_format_t pool_format = output_res.color_conversion_required() ? DSP_IMAGE_FORMAT_RGB : m_multi_resize_config.output_video_config.format;
+        bool planar = output_res.color_format == COLOR_FORMAT_RGB_PLANAR;
+        MediaLibraryBufferPoolPtr buffer_pool = std::make_shared<MediaLibraryBufferPool>(width, height, pool_format, output_res.pool_max_buffers, CMA, bytes_per_line, planar);
         if (buffer_pool->init() != MEDIA_LIBRARY_SUCCESS)
         {
             LOGGER__ERROR("Failed to init buffer pool");
@@ -382,12 +596,112 @@ media_library_return MediaLibraryMultiResize::Impl::create_and_initialize_buffer
         {
             m_buffer_pools[i] = buffer_pool;
         }
+        // Buffers of the previous pool do not take from the new one
+        m_output_contexts[i].in_flight_buffers.clear();
+        if (create_conversion_buffer(i, width, height) != MEDIA_LIBRARY_SUCCESS)
+            return MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
     }
     LOGGER__DEBUG("multi-resize holding {} buffer pools", m_buffer_pools.size());
 
     return MEDIA_LIBRARY_SUCCESS;
 }
 
+/**
+ * @brief Create the intermediate buffer of an output that is converted to RGB
+ * The DSP resizes in the input color format, so such outputs are resized into a single
+ * intermediate buffer that is then converted into the acquired output buffer.
+ *
+ * @param[in] output_index - index of the output
+ * @param[in] width - output width
+ * @param[in] height - output height
+ */
+media_library_return MediaLibraryMultiResize::Impl::create_conversion_buffer(uint output_index, uint width, uint height)
+{
+    output_resolution_t &output_res = m_multi_resize_config.output_video_config.resolutions[output_index];
+    output_context_t &output_context = m_output_contexts[output_index];
+    release_conversion_buffer(output_context);
+    output_context.conversion_pool = nullptr;
+    if (!output_res.color_conversion_required())
+        return MEDIA_LIBRARY_SUCCESS;
+
+    auto bytes_per_line = dsp_utils::get_dsp_desired_stride_from_width(width);
+    LOGGER__INFO("Creating color conversion buffer for output {}: width {} height {}", output_index, width, height);
+    output_context.conversion_pool = std::make_shared<MediaLibraryBufferPool>(width, height, m_multi_resize_config.output_video_config.format, 1, CMA, bytes_per_line);
+    if (output_context.conversion_pool->init() != MEDIA_LIBRARY_SUCCESS)
+    {
+        LOGGER__ERROR("Failed to init color conversion buffer pool");
+        return MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
+    }
+    if (output_context.conversion_pool->acquire_buffer(output_context.conversion_buffer) != MEDIA_LIBRARY_SUCCESS)
+    {
+        LOGGER__ERROR("Failed to acquire color conversion buffer");
+        return MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
+    }
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+void MediaLibraryMultiResize::Impl::release_conversion_buffer(output_context_t &output_context)
+{
+    if (output_context.conversion_buffer.hailo_pix_buffer == nullptr)
+        return;
+    output_context.conversion_buffer.decrease_ref_count();
+    output_context.conversion_buffer = hailo_media_library_buffer();
+}
+
+/**
+ * @brief Check whether the consumer of an output is saturated
+ * A consumer is saturated when it still holds as many buffers of the output as the output pool size,
+ * or when the downstream queue it reported is full. The buffers are counted per output, so the
+ * saturation of one consumer does not depend on what other users draw from the same pool. Frames of such an output would either fail
+ * the acquire or be dropped after the resize, so the output is skipped instead.
+ * Transitions are logged once, together with the number of frames skipped meanwhile.
+ *
+ * @param[in] output_index - index of the output
+ */
+bool MediaLibraryMultiResize::Impl::is_output_consumer_saturated(uint output_index)
+{
+    output_context_t &output_context = m_output_contexts[output_index];
+    // A buffer is released back to the pool once its last reference is dropped, which drops its image properties
+    std::erase_if(output_context.in_flight_buffers, [](const std::weak_ptr<dsp_image_properties_t> &buffer)
+                  { return buffer.expired(); });
+    size_t max_buffers = m_multi_resize_config.output_video_config.resolutions[output_index].pool_max_buffers;
+    bool buffers_exhausted = output_context.in_flight_buffers.size() >= max_buffers;
+    bool queue_full = output_context.consumer_max_queued_buffers != 0 &&
+                      output_context.consumer_queued_buffers >= output_context.consumer_max_queued_buffers;
+    bool saturated = buffers_exhausted || queue_full;
+
+    if (saturated && !output_context.consumer_saturated)
+    {
+        LOGGER__INFO("Consumer of output {} is saturated (buffers held: {}/{}, queued buffers {}/{}), skipping its frames",
+                     output_index, output_context.in_flight_buffers.size(), max_buffers, output_context.consumer_queued_buffers, output_context.consumer_max_queued_buffers);
+        output_context.consumer_skipped_frames = 0;
+    }
+    else if (!saturated && output_context.consumer_saturated)
+    {
+        LOGGER__INFO("Consumer of output {} recovered after {} skipped frames", output_index, output_context.consumer_skipped_frames);
+    }
+    output_context.consumer_saturated = saturated;
+
+    if (saturated)
+        output_context.consumer_skipped_frames++;
+    return saturated;
+}
+
+/**
+ * @brief Check whether the current frame is handled by an output, to match its framerate
+ *
+ * @param[in] output_framerate - framerate of the output
+ * @param[in] isp_ae_fps - the current framerate of the sensor, -1 if unknown
+ */
+bool MediaLibraryMultiResize::Impl::should_handle_output_frame(uint32_t output_framerate, int32_t isp_ae_fps)
+{
+    uint32_t input_framerate = m_multi_resize_config.input_video_config.framerate;
+    uint stream_period = (output_framerate == 0) ? 0 : input_framerate / output_framerate;
+    bool should_handle = stream_period == 0 ? false : (m_frame_counter % stream_period == 0) || (isp_ae_fps != -1 && output_framerate >= static_cast<uint32_t>(isp_ae_fps));
+    LOGGER__DEBUG("frame counter is {}, stream period is {}, should handle frame is {}", m_frame_counter, stream_period, should_handle);
+    return should_handle;
+}
+
 /**
  * @brief Acquire output buffers from buffer pools
  *
@@ -401,13 +715,10 @@ media_library_return MediaLibraryMultiResize::Impl::acquire_output_buffers(hailo
     uint8_t output_size = m_multi_resize_config.output_video_config.resolutions.size();
     for (uint8_t i = 0; i < output_size; i++)
     {
-        uint32_t input_framerate = m_multi_resize_config.input_video_config.framerate;
         uint32_t output_framerate = m_multi_resize_config.output_video_config.resolutions[i].framerate;
         LOGGER__DEBUG("Acquiring buffer {}, target framerate is {}", i, output_framerate);
 
-        uint stream_period = (output_framerate == 0) ? 0 : input_framerate / output_framerate;
-        bool should_acquire_buffer = stream_period == 0 ? false : (m_frame_counter % stream_period == 0) || (isp_ae_fps != -1 && output_framerate >= static_cast<uint32_t>(isp_ae_fps));
-        LOGGER__DEBUG("frame counter is {}, stream period is {}, should acquire buffer is {}", m_frame_counter, stream_period, should_acquire_buffer);
+        bool should_acquire_buffer = should_handle_output_frame(output_framerate, isp_ae_fps);
 
         hailo_media_library_buffer buffer;
 
@@ -419,12 +730,21 @@ media_library_return MediaLibraryMultiResize::Impl::acquire_output_buffers(hailo
             continue;
         }
 
+        if (is_output_consumer_saturated(i))
+        {
+            LOGGER__DEBUG("Skipping output {} since its consumer is saturated, counter is {}", i, m_frame_counter);
+            buffers.emplace_back(std::move(buffer));
+            continue;
+        }
+
         if (m_buffer_pools[i]->acquire_buffer(buffer) != MEDIA_LIBRARY_SUCCESS)
         {
             LOGGER__ERROR("Failed to acquire buffer");
+            dsp_scheduler::record_dropped_frame(m_dsp_sensor_id);
             return MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
         }
         buffer.isp_ae_fps = isp_ae_fps;
+        m_output_contexts[i].in_flight_buffers.emplace_back(buffer.hailo_pix_buffer);
         buffers.emplace_back(std::move(buffer));
         LOGGER__DEBUG("buffer acquired successfully");
     }
@@ -433,29 +753,340 @@ media_library_return MediaLibraryMultiResize::Impl::acquire_output_buffers(hailo
 };
 
 /**
- * @brief Perform multi resize on the DSP
+ * @brief Acquire the buffers of the ROI streams, after the buffers of the configured outputs
+ * A stream whose pool is exhausted, or whose ROI does not fit in the input frame, skips the frame -
+ * it does not fail the configured outputs.
  *
  * @param[in] input_frame - pointer to the input frame
- * @param[out] output_frames - vector of output frames
+ * @param[in] buffers - vector of output buffers
  */
-media_library_return MediaLibraryMultiResize::Impl::perform_multi_resize(hailo_media_library_buffer &input_buffer, std::vector<hailo_media_library_buffer> &output_frames)
+void MediaLibraryMultiResize::Impl::acquire_roi_stream_buffers(hailo_media_library_buffer &input_buffer, std::vector<hailo_media_library_buffer> &buffers)
 {
-    struct timespec start_resize, end_resize;
-    size_t output_frames_size = output_frames.size();
-    size_t num_of_output_resolutions = m_multi_resize_config.output_video_config.resolutions.size();
-    if (num_of_output_resolutions != output_frames_size)
+    for (roi_stream_t &roi_stream : m_roi_streams)
     {
-        LOGGER__ERROR("Number of output resolutions ({}) does not match number of output frames ({})", num_of_output_resolutions, output_frames_size);
+        hailo_media_library_buffer buffer;
+        if (!roi_stream.roi_out_of_frame && should_handle_output_frame(roi_stream.output_res.framerate, input_buffer.isp_ae_fps))
+        {
+            if (roi_stream.buffer_pool->acquire_buffer(buffer) == MEDIA_LIBRARY_SUCCESS)
+                buffer.isp_ae_fps = input_buffer.isp_ae_fps;
+            else
+                LOGGER__DEBUG("Skipping ROI stream {} since its pool is exhausted", roi_stream.id);
+        }
+        buffers.emplace_back(std::move(buffer));
+    }
+}
+
+/**
+ * @brief Take the frames of the ROI streams out of the output frames
+ * Delivered frames are queued for their callbacks, called once the configuration lock is released.
+ *
+ * @param[in] output_frames - vector of output frames, left with the configured outputs only
+ * @param[in] deliver - deliver the frames, or release them when the frame failed
+ * @param[out] deliveries - the frames to deliver, with their callbacks
+ */
+void MediaLibraryMultiResize::Impl::collect_roi_stream_frames(std::vector<hailo_media_library_buffer> &output_frames, bool deliver,
+                                                              std::vector<roi_stream_delivery_t> &deliveries)
+{
+    size_t num_of_outputs = m_multi_resize_config.output_video_config.resolutions.size();
+    for (size_t i = num_of_outputs; i < output_frames.size(); i++)
+    {
+        if (output_frames[i].hailo_pix_buffer == nullptr)
+            continue;
+
+        if (!deliver)
+        {
+            output_frames[i].decrease_ref_count();
+            continue;
+        }
+
+        roi_stream_t &roi_stream = m_roi_streams[i - num_of_outputs];
+        deliveries.push_back({roi_stream.id, roi_stream.on_frame, std::make_shared<hailo_media_library_buffer>(std::move(output_frames[i]))});
+    }
+    output_frames.resize(std::min(num_of_outputs, output_frames.size()));
+}
+
+/**
+ * @brief Get the resolution of an output, the outputs after the configured ones are the ROI streams
+ *
+ * @param[in] output_index - index of the output
+ */
+output_resolution_t &MediaLibraryMultiResize::Impl::get_output_resolution(uint output_index)
+{
+    std::vector<output_resolution_t> &resolutions = m_multi_resize_config.output_video_config.resolutions;
+    if (output_index < resolutions.size())
+        return resolutions[output_index];
+    return m_roi_streams[output_index - resolutions.size()].output_res;
+}
+
+/**
+ * @brief Get the scaling context of an output, the outputs after the configured ones are the ROI streams
+ *
+ * @param[in] output_index - index of the output
+ */
+output_context_t &MediaLibraryMultiResize::Impl::get_output_context(uint output_index)
+{
+    if (output_index < m_output_contexts.size())
+        return m_output_contexts[output_index];
+    return m_roi_streams[output_index - m_output_contexts.size()].context;
+}
+
+/**
+ * @brief Calculate the crop region shared by all outputs (digital zoom)
+ *
+ * @param[out] crop - the crop region in input frame coordinates
+ */
+media_library_return MediaLibraryMultiResize::Impl::get_digital_zoom_crop(crop_region_t &crop)
+{
+    uint input_width = m_multi_resize_config.input_video_config.dimensions.destination_width;
+    uint input_height = m_multi_resize_config.input_video_config.dimensions.destination_height;
+    crop = {.start_x = 0, .start_y = 0, .end_x = input_width, .end_y = input_height};
+
+    if (!m_multi_resize_config.digital_zoom_config.enabled)
+        return MEDIA_LIBRARY_SUCCESS;
+
+    if (m_multi_resize_config.digital_zoom_config.mode == DIGITAL_ZOOM_MODE_MAGNIFICATION)
+    {
+        uint center_x = input_width / 2;
+        uint center_y = input_height / 2;
+        uint zoom_width = center_x / m_multi_resize_config.digital_zoom_config.magnification;
+        uint zoom_height = center_y / m_multi_resize_config.digital_zoom_config.magnification;
+        crop.start_x = MAKE_EVEN(center_x - zoom_width);
+        crop.start_y = MAKE_EVEN(center_y - zoom_height);
+        crop.end_x = MAKE_EVEN(center_x + zoom_width);
+        crop.end_y = MAKE_EVEN(center_y + zoom_height);
+        return MEDIA_LIBRARY_SUCCESS;
+    }
+
+    roi_t &digital_zoom_roi = m_multi_resize_config.digital_zoom_config.roi;
+    crop.start_x = MAKE_EVEN(digital_zoom_roi.x);
+    crop.start_y = MAKE_EVEN(digital_zoom_roi.y);
+    crop.end_x = MAKE_EVEN(crop.start_x + digital_zoom_roi.width);
+    crop.end_y = MAKE_EVEN(crop.start_y + digital_zoom_roi.height);
+
+    // Validate digital zoom ROI values with the input frame dimensions
+    if (crop.end_x > input_width)
+    {
+        LOGGER__ERROR("Invalid digital zoom ROI. X ({}) and width ({}) coordinates exceed input frame width ({})", crop.start_x, digital_zoom_roi.width, input_width);
+        return MEDIA_LIBRARY_ERROR;
+    }
+
+    if (crop.end_y > input_height)
+    {
+        LOGGER__ERROR("Invalid digital zoom ROI. Y ({}) and height ({}) coordinates exceed input frame height ({})", crop.start_y, digital_zoom_roi.height, input_height);
         return MEDIA_LIBRARY_ERROR;
     }
 
-    dsp_multi_resize_params_t multi_resize_params = {
-        .src = input_buffer.hailo_pix_buffer.get(),
-        .interpolation = m_multi_resize_config.output_video_config.interpolation_type,
-    };
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+/**
+ * @brief Calculate the crop region of a specific output
+ * Outputs without their own ROI are resized from the shared (digital zoom) crop region
+ *
+ * @param[in] output_res - the output resolution configuration
+ * @param[in] default_crop - the shared crop region
+ * @param[out] crop - the crop region of the output in input frame coordinates
+ */
+media_library_return MediaLibraryMultiResize::Impl::get_output_crop(output_resolution_t &output_res, const crop_region_t &default_crop, crop_region_t &crop)
+{
+    if (!output_res.dimensions.perform_crop)
+    {
+        crop = default_crop;
+        return MEDIA_LIBRARY_SUCCESS;
+    }
+
+    uint input_width = m_multi_resize_config.input_video_config.dimensions.destination_width;
+    uint input_height = m_multi_resize_config.input_video_config.dimensions.destination_height;
+    crop.start_x = MAKE_EVEN(output_res.dimensions.crop_start_x);
+    crop.start_y = MAKE_EVEN(output_res.dimensions.crop_start_y);
+    crop.end_x = MAKE_EVEN(output_res.dimensions.crop_end_x);
+    crop.end_y = MAKE_EVEN(output_res.dimensions.crop_end_y);
 
-    uint num_bufs_to_resize = 0;
-    for (size_t i = 0; i < num_of_output_resolutions; i++)
+    if (crop.end_x > input_width || crop.end_y > input_height || crop.start_x >= crop.end_x || crop.start_y >= crop.end_y)
+    {
+        LOGGER__ERROR("Invalid output crop ROI: start_x {} start_y {} end_x {} end_y {} for input frame width {} height {}",
+                      crop.start_x, crop.start_y, crop.end_x, crop.end_y, input_width, input_height);
+        return MEDIA_LIBRARY_ERROR;
+    }
+
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+/**
+ * @brief Check that a crop ROI fits in the input frame, as get_output_crop() rounds it
+ * Any non-empty ROI fits while the input resolution is not known yet.
+ *
+ * @param[in] roi - the ROI in input frame coordinates
+ */
+bool MediaLibraryMultiResize::Impl::crop_roi_in_input_frame(const roi_t &roi)
+{
+    if (roi.width == 0 || roi.height == 0)
+        return false;
+
+    uint input_width = m_multi_resize_config.input_video_config.dimensions.destination_width;
+    uint input_height = m_multi_resize_config.input_video_config.dimensions.destination_height;
+    if (input_width == 0 || input_height == 0)
+        return true;
+
+    uint64_t start_x = MAKE_EVEN((uint64_t)roi.x);
+    uint64_t start_y = MAKE_EVEN((uint64_t)roi.y);
+    uint64_t end_x = MAKE_EVEN((uint64_t)roi.x + roi.width);
+    uint64_t end_y = MAKE_EVEN((uint64_t)roi.y + roi.height);
+    return end_x <= input_width && end_y <= input_height && start_x < end_x && start_y < end_y;
+}
+
+/**
+ * @brief Fill an output buffer with the pad color
+ *
+ * @param[in] output_frame - the output buffer to fill
+ * @param[in] pad_color - the pad color (RGB)
+ */
+void MediaLibraryMultiResize::Impl::fill_padding(dsp_image_properties_t *output_frame, const pad_color_t &pad_color)
+{
+    yuv_color_t yuv = rgb_to_yuv({pad_color.r, pad_color.g, pad_color.b});
+    dsp_data_plane_t &y_plane = output_frame->planes[0];
+    memset(y_plane.userptr, yuv.y, y_plane.bytesused);
+
+    if (output_frame->format != DSP_IMAGE_FORMAT_NV12)
+        return;
+
+    // UV plane is interleaved - fill it with the (U, V) pair
+    dsp_data_plane_t &uv_plane = output_frame->planes[1];
+    uint16_t uv_value = (uint16_t)yuv.u | ((uint16_t)yuv.v << 8);
+    uint16_t *uv_data = (uint16_t *)uv_plane.userptr;
+    std::fill(uv_data, uv_data + uv_plane.bytesused / 2, uv_value);
+}
+
+/**
+ * @brief Apply the scaling mode of an output to its crop region and resize target
+ * Crop-to-fill shrinks the crop region to the output aspect ratio.
+ * Letterbox resizes into a centered view of the output buffer, the padding around it is
+ * filled once per pool buffer and is never written by the DSP.
+ * Outputs converted to RGB are resized into their conversion buffer instead of the output buffer.
+ *
+ * @param[in] output_index - index of the output
+ * @param[in] output_frame - the output buffer, its content and source regions are updated
+ * @param[in,out] crop - the crop region of the output in input frame coordinates
+ * @param[out] resize_target - the image the DSP should resize into
+ */
+media_library_return MediaLibraryMultiResize::Impl::prepare_output_scaling(uint output_index, hailo_media_library_buffer &output_frame, crop_region_t &crop,
+                                                                           dsp_image_properties_t *&resize_target)
+{
+    output_resolution_t &output_res = get_output_resolution(output_index);
+    output_context_t &scaling_context = get_output_context(output_index);
+    hailo_media_library_buffer &target_buffer = output_res.color_conversion_required() ? scaling_context.conversion_buffer : output_frame;
+    dsp_image_properties_t *output_props = target_buffer.hailo_pix_buffer.get();
+    // Tag of the content the buffer is left with - 0 unless it keeps a padding for the next acquisitions
+    uint64_t buffer_tag = 0;
+    uint dst_width = output_props->width;
+    uint dst_height = output_props->height;
+    uint src_width = crop.end_x - crop.start_x;
+    uint src_height = crop.end_y - crop.start_y;
+    roi_t content_roi = {.x = 0, .y = 0, .width = dst_width, .height = dst_height};
+    resize_target = output_props;
+
+    switch (output_res.scaling_mode)
+    {
+    case SCALING_MODE_CROP_TO_FILL:
+    {
+        // Shrink the wider source dimension to the output aspect ratio, keeping the crop centered
+        if ((uint64_t)src_width * dst_height > (uint64_t)src_height * dst_width)
+        {
+            uint fill_width = FLOOR_EVEN((uint)((uint64_t)src_height * dst_width / dst_height));
+            crop.start_x = FLOOR_EVEN(crop.start_x + (src_width - fill_width) / 2);
+            crop.end_x = crop.start_x + fill_width;
+        }
+        else
+        {
+            uint fill_height = FLOOR_EVEN((uint)((uint64_t)src_width * dst_height / dst_width));
+            crop.start_y = FLOOR_EVEN(crop.start_y + (src_height - fill_height) / 2);
+            crop.end_y = crop.start_y + fill_height;
+        }
+        break;
+    }
+    case SCALING_MODE_LETTERBOX:
+    {
+        // Fit the source into the output keeping the aspect ratio, center it
+        if ((uint64_t)src_width * dst_height > (uint64_t)src_height * dst_width)
+            content_roi.height = FLOOR_EVEN((uint)((uint64_t)src_height * dst_width / src_width));
+        else
+            content_roi.width = FLOOR_EVEN((uint)((uint64_t)src_width * dst_height / src_height));
+        content_roi.x = FLOOR_EVEN((dst_width - content_roi.width) / 2);
+        content_roi.y = FLOOR_EVEN((dst_height - content_roi.height) / 2);
+
+        if (content_roi.width == dst_width && content_roi.height == dst_height)
+            break;
+
+        if (content_roi.width == 0 || content_roi.height == 0)
+        {
+            LOGGER__ERROR("Invalid letterbox content size {}x{} for output {}", content_roi.width, content_roi.height, output_index);
+            return MEDIA_LIBRARY_ERROR;
+        }
+
+        // A new geometry or color gets a new tag, so buffers padded with the previous one are padded again
+        if (scaling_context.padding_tag == 0 || scaling_context.content_roi != content_roi || !(scaling_context.pad_color == output_res.pad_color))
+        {
+            scaling_context.padding_tag = next_padding_tag++;
+            scaling_context.content_roi = content_roi;
+            scaling_context.pad_color = output_res.pad_color;
+        }
+
+        // Any other user of the pool may have written the buffer since this output padded it
+        buffer_tag = scaling_context.padding_tag;
+        if (target_buffer.owner->get_buffer_tag(target_buffer) != buffer_tag)
+        {
+            LOGGER__DEBUG("Filling letterbox padding of output {} buffer {}", output_index, fmt::ptr(output_props->planes[0].userptr));
+            fill_padding(output_props, output_res.pad_color);
+            target_buffer.owner->set_buffer_tag(target_buffer, buffer_tag);
+        }
+
+        // Build a view of the content rectangle, sharing the strides of the output buffer
+        for (uint plane = 0; plane < output_props->planes_count; plane++)
+        {
+            dsp_data_plane_t &src_plane = output_props->planes[plane];
+            // The UV plane of NV12 is subsampled vertically, horizontally it holds (U, V) pairs
+            uint plane_y = (plane == 0) ? content_roi.y : content_roi.y / 2;
+            uint plane_height = (plane == 0) ? content_roi.height : content_roi.height / 2;
+            scaling_context.content_planes[plane] = {
+                .userptr = (uint8_t *)src_plane.userptr + plane_y * src_plane.bytesperline + content_roi.x,
+                .bytesperline = src_plane.bytesperline,
+                .bytesused = src_plane.bytesperline * plane_height,
+            };
+        }
+        scaling_context.content_view = *output_props;
+        scaling_context.content_view.width = content_roi.width;
+        scaling_context.content_view.height = content_roi.height;
+        scaling_context.content_view.planes = scaling_context.content_planes;
+        resize_target = &scaling_context.content_view;
+        break;
+    }
+    default:
+        break;
+    }
+
+    // The whole buffer is written - it no longer holds the padding of any user of the pool
+    if (buffer_tag == 0 && target_buffer.owner != nullptr && target_buffer.owner->get_buffer_tag(target_buffer) != 0)
+        target_buffer.owner->set_buffer_tag(target_buffer, 0);
+
+    output_frame.content_roi = content_roi;
+    output_frame.source_roi = {.x = crop.start_x, .y = crop.start_y, .width = crop.end_x - crop.start_x, .height = crop.end_y - crop.start_y};
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+/**
+ * @brief Group the output frames by their crop region
+ * Outputs sharing a crop region are resized in the same DSP operation, so the input frame
+ * is read once per distinct crop region rather than once per output.
+ *
+ * @param[in] input_frame - pointer to the input frame
+ * @param[in] output_frames - vector of output frames
+ * @param[in] default_crop - the shared crop region
+ */
+media_library_return MediaLibraryMultiResize::Impl::group_outputs_by_crop(hailo_media_library_buffer &input_buffer, std::vector<hailo_media_library_buffer> &output_frames,
+                                                                          const crop_region_t &default_crop)
+{
+    m_resize_groups.clear();
+    for (size_t i = 0; i < output_frames.size(); i++)
     {
         // TODO: Handle cases where its nullptr
         if (output_frames[i].hailo_pix_buffer == nullptr)
@@ -464,7 +1095,7 @@ media_library_return MediaLibraryMultiResize::Impl::perform_multi_resize(hailo_m
             continue;
         }
         dsp_image_properties_t *output_frame = output_frames[i].hailo_pix_buffer.get();
-        output_resolution_t &output_res = m_multi_resize_config.output_video_config.resolutions[i];
+        output_resolution_t &output_res = get_output_resolution(i);
 
         if (output_res != *output_frame)
         {
@@ -472,81 +1103,126 @@ media_library_return MediaLibraryMultiResize::Impl::perform_multi_resize(hailo_m
             return MEDIA_LIBRARY_ERROR;
         }
 
-        multi_resize_params.dst[num_bufs_to_resize] = output_frame;
-        LOGGER__DEBUG("Multi resize output frame ({}) - y_ptr = {}, uv_ptr = {}. dims: width {} output frame height {}", i, fmt::ptr(output_frame->planes[0].userptr), fmt::ptr(output_frame->planes[1].userptr), output_frame->width, output_frame->height);
-        num_bufs_to_resize++;
-    }
+        crop_region_t crop;
+        if (get_output_crop(output_res, default_crop, crop) != MEDIA_LIBRARY_SUCCESS)
+            return MEDIA_LIBRARY_ERROR;
 
-    if (num_bufs_to_resize == 0)
-    {
-        LOGGER__DEBUG("No need to perform multi resize");
-        return MEDIA_LIBRARY_SUCCESS;
+        dsp_image_properties_t *resize_target = output_frame;
+        if (prepare_output_scaling(i, output_frames[i], crop, resize_target) != MEDIA_LIBRARY_SUCCESS)
+            return MEDIA_LIBRARY_ERROR;
+
+        auto group = std::find_if(m_resize_groups.begin(), m_resize_groups.end(), [&crop](const multi_resize_group_t &g)
+                                  { return g.crop == crop && g.num_of_outputs < MAX_OUTPUTS_PER_MULTI_RESIZE; });
+        if (group == m_resize_groups.end())
+        {
+            multi_resize_group_t new_group = {
+                .crop = crop,
+                .params = {
+                    .src = input_buffer.hailo_pix_buffer.get(),
+                    .interpolation = m_multi_resize_config.output_video_config.interpolation_type,
+                },
+                .num_of_outputs = 0,
+            };
+            m_resize_groups.emplace_back(new_group);
+            group = std::prev(m_resize_groups.end());
+        }
+
+        group->params.dst[group->num_of_outputs++] = resize_target;
+        LOGGER__DEBUG("Multi resize output frame ({}) - y_ptr = {}. dims: width {} output frame height {}", i, fmt::ptr(resize_target->planes[0].userptr), resize_target->width, resize_target->height);
     }
 
-    uint start_x = 0;
-    uint start_y = 0;
-    uint end_x = m_multi_resize_config.input_video_config.dimensions.destination_width;
-    uint end_y = m_multi_resize_config.input_video_config.dimensions.destination_height;
+    return MEDIA_LIBRARY_SUCCESS;
+}
 
-    if (m_multi_resize_config.digital_zoom_config.enabled)
+/**
+ * @brief Convert the resized outputs that require an RGB color format
+ * Conversion and normalization are done in a single pass over the intermediate buffer.
+ *
+ * @param[in] output_frames - vector of output frames
+ */
+media_library_return MediaLibraryMultiResize::Impl::convert_output_colors(std::vector<hailo_media_library_buffer> &output_frames)
+{
+    for (size_t i = 0; i < output_frames.size(); i++)
     {
-        if (m_multi_resize_config.digital_zoom_config.mode == DIGITAL_ZOOM_MODE_MAGNIFICATION)
-        {
-            uint center_x = end_x / 2;
-            uint center_y = end_y / 2;
-            uint zoom_width = center_x / m_multi_resize_config.digital_zoom_config.magnification;
-            uint zoom_height = center_y / m_multi_resize_config.digital_zoom_config.magnification;
-            start_x = MAKE_EVEN(center_x - zoom_width);
-            start_y = MAKE_EVEN(center_y - zoom_height);
-            end_x = MAKE_EVEN(center_x + zoom_width);
-            end_y = MAKE_EVEN(center_y + zoom_height);
-        }
-        else
-        {
-            roi_t &digital_zoom_roi = m_multi_resize_config.digital_zoom_config.roi;
-            start_x = MAKE_EVEN(digital_zoom_roi.x);
-            start_y = MAKE_EVEN(digital_zoom_roi.y);
-            end_x = MAKE_EVEN(start_x + digital_zoom_roi.width);
-            end_y = MAKE_EVEN(start_y + digital_zoom_roi.height);
+        output_resolution_t &output_res = get_output_resolution(i);
+        if (output_frames[i].hailo_pix_buffer == nullptr || !output_res.color_conversion_required())
+            continue;
 
-            // Validate digital zoom ROI values with the input frame dimensions
-            if (end_x > m_multi_resize_config.input_video_config.dimensions.destination_width)
+        output_context_t &output_context = m_output_contexts[i];
+        const normalization_lut_t *lut = nullptr;
+        if (output_res.normalization.enabled)
+        {
+            if (output_context.lut_normalization != output_res.normalization)
             {
-                LOGGER__ERROR("Invalid digital zoom ROI. X ({}) and width ({}) coordinates exceed input frame width ({})", start_x, digital_zoom_roi.width, m_multi_resize_config.input_video_config.dimensions.destination_width);
-                return MEDIA_LIBRARY_ERROR;
+                media_library_return ret = build_normalization_lut(output_res.normalization, output_context.normalization_lut);
+                if (ret != MEDIA_LIBRARY_SUCCESS)
+                {
+                    LOGGER__ERROR("Failed to build the normalization of output {}", i);
+                    return ret;
+                }
+                output_context.lut_normalization = output_res.normalization;
             }
+            lut = &output_context.normalization_lut;
+        }
 
-            if (end_y > m_multi_resize_config.input_video_config.dimensions.destination_height)
-            {
-                LOGGER__ERROR("Invalid digital zoom ROI. Y ({}) and height ({}) coordinates exceed input frame height ({})", start_y, digital_zoom_roi.height, m_multi_resize_config.input_video_config.dimensions.destination_height);
-                return MEDIA_LIBRARY_ERROR;
-            }
+        media_library_return ret = convert_yuv_to_rgb(*output_context.conversion_buffer.hailo_pix_buffer, *output_frames[i].hailo_pix_buffer,
+                                                      output_res.color_format, lut);
+        if (ret != MEDIA_LIBRARY_SUCCESS)
+        {
+            LOGGER__ERROR("Failed to convert output frame {} to color format {}", i, output_res.color_format);
+            return ret;
         }
     }
 
-    // Blend privacy mask
-    auto blender_expected = m_privacy_mask_blender->blend();
-    if (!blender_expected.has_value())
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+/**
+ * @brief Perform multi resize on the DSP
+ *
+ * @param[in] input_frame - pointer to the input frame
+ * @param[out] output_frames - vector of output frames
+ */
+media_library_return MediaLibraryMultiResize::Impl::perform_multi_resize(hailo_media_library_buffer &input_buffer, std::vector<hailo_media_library_buffer> &output_frames)
+{
+    struct timespec start_resize, end_resize;
+    size_t output_frames_size = output_frames.size();
+    size_t num_of_output_resolutions = m_multi_resize_config.output_video_config.resolutions.size() + m_roi_streams.size();
+    if (num_of_output_resolutions != output_frames_size)
     {
-        LOGGER__ERROR("Failed to blend privacy mask");
+        LOGGER__ERROR("Number of output resolutions ({}) does not match number of output frames ({})", num_of_output_resolutions, output_frames_size);
         return MEDIA_LIBRARY_ERROR;
     }
 
-    PrivacyMaskDataPtr privacy_mask_data = blender_expected.value();
+    crop_region_t default_crop;
+    if (get_digital_zoom_crop(default_crop) != MEDIA_LIBRARY_SUCCESS)
+        return MEDIA_LIBRARY_ERROR;
 
-    // Perform multi resize
-    clock_gettime(CLOCK_MONOTONIC, &start_resize);
-    dsp_status ret = DSP_SUCCESS;
-    if(privacy_mask_data->rois_count==0)
+    media_library_return media_lib_ret = group_outputs_by_crop(input_buffer, output_frames, default_crop);
+    if (media_lib_ret != MEDIA_LIBRARY_SUCCESS)
+        return media_lib_ret;
+
+    if (m_resize_groups.empty())
     {
-        LOGGER__DEBUG("Performing multi resize on the DSP with digital zoom ROI: start_x {} start_y {} end_x {} end_y {}", start_x, start_y, end_x, end_y);
-        ret = dsp_utils::perform_dsp_multi_resize(&multi_resize_params, start_x, start_y, end_x, end_y);
+        LOGGER__DEBUG("No need to perform multi resize");
+        return MEDIA_LIBRARY_SUCCESS;
     }
-    else
+
+    // Blend privacy mask - the static masks and the rectangles of this frame
+    auto blender_expected = m_privacy_mask_blender->blend(input_buffer.privacy_mask_rects);
+    if (!blender_expected.has_value())
+    {
+        LOGGER__ERROR("Failed to blend privacy mask");
+        return MEDIA_LIBRARY_ERROR;
+    }
+
+    PrivacyMaskDataPtr privacy_mask_data = blender_expected.value();
+    dsp_roi_t dsp_rois[MAX_NUM_OF_PRIVACY_MASK_ROIS];
+    dsp_privacy_mask_t dsp_privacy_mask;
+    if (privacy_mask_data->rois_count > 0)
     {
         dsp_image_properties_t *dsp_image_props = privacy_mask_data->bitmask.hailo_pix_buffer.get();
-        dsp_roi_t dsp_rois[privacy_mask_data->rois_count];
-        dsp_privacy_mask_t dsp_privacy_mask = {
+        dsp_privacy_mask = {
             .bitmask = (uint8_t *)dsp_image_props->planes[0].userptr,
             .y_color = privacy_mask_data->color.y,
             .u_color = privacy_mask_data->color.u,
@@ -555,7 +1231,7 @@ media_library_return MediaLibraryMultiResize::Impl::perform_multi_resize(hailo_m
             .rois_count = privacy_mask_data->rois_count,
         };
 
-        for(uint i = 0; i < privacy_mask_data->rois_count; i++)
+        for (uint i = 0; i < privacy_mask_data->rois_count; i++)
         {
             dsp_privacy_mask.rois[i] = {
                 .start_x = privacy_mask_data->rois[i].x,
@@ -564,20 +1240,39 @@ media_library_return MediaLibraryMultiResize::Impl::perform_multi_resize(hailo_m
                 .end_y = privacy_mask_data->rois[i].y + privacy_mask_data->rois[i].height
             };
         }
+    }
 
-        LOGGER__DEBUG("Performing multi resize on the DSP with digital zoom ROI: start_x {} start_y {} end_x {} end_y {} and {} privacy masks", start_x, start_y, end_x, end_y, privacy_mask_data->rois_count);
-        ret = dsp_utils::perform_dsp_multi_resize(&multi_resize_params, start_x, start_y, end_x, end_y, &dsp_privacy_mask);
+    // Perform multi resize - one DSP operation per distinct crop region, all in a single DSP job of the sensor
+    clock_gettime(CLOCK_MONOTONIC, &start_resize);
+    dsp_status ret = DSP_SUCCESS;
+    dsp_scheduler::job_t dsp_job = dsp_scheduler::begin_job(m_dsp_sensor_id);
+    for (multi_resize_group_t &group : m_resize_groups)
+    {
+        crop_region_t &crop = group.crop;
+        if (privacy_mask_data->rois_count == 0)
+        {
+            LOGGER__DEBUG("Performing multi resize on the DSP of {} outputs with crop ROI: start_x {} start_y {} end_x {} end_y {}", group.num_of_outputs, crop.start_x, crop.start_y, crop.end_x, crop.end_y);
+            ret = dsp_utils::perform_dsp_multi_resize(&group.params, crop.start_x, crop.start_y, crop.end_x, crop.end_y);
+        }
+        else
+        {
+            LOGGER__DEBUG("Performing multi resize on the DSP of {} outputs with crop ROI: start_x {} start_y {} end_x {} end_y {} and {} privacy masks", group.num_of_outputs, crop.start_x, crop.start_y, crop.end_x, crop.end_y, privacy_mask_data->rois_count);
+            ret = dsp_utils::perform_dsp_multi_resize(&group.params, crop.start_x, crop.start_y, crop.end_x, crop.end_y, &dsp_privacy_mask);
+        }
 
+        if (ret != DSP_SUCCESS)
+            break;
     }
+    dsp_scheduler::end_job(dsp_job);
 
     clock_gettime(CLOCK_MONOTONIC, &end_resize);
     [[maybe_unused]] long ms = (long)media_library_difftimespec_ms(end_resize, start_resize);
-    LOGGER__TRACE("perform_multi_resize took {} milliseconds ({} fps)", ms, 1000 / ms);
+    LOGGER__TRACE("perform_multi_resize of {} DSP operations took {} milliseconds ({} fps)", m_resize_groups.size(), ms, 1000 / ms);
 
     if (ret != DSP_SUCCESS)
         return MEDIA_LIBRARY_DSP_OPERATION_ERROR;
 
-    return MEDIA_LIBRARY_SUCCESS;
+    return convert_output_colors(output_frames);
 }
 
 void MediaLibraryMultiResize::Impl::stamp_time_and_log_fps(timespec &start_handle, timespec &end_handle)
@@ -622,6 +1317,7 @@ media_library_return MediaLibraryMultiResize::Impl::handle_frame(hailo_media_lib
     // Stamp start time
     struct timespec start_handle, end_handle;
     clock_gettime(CLOCK_MONOTONIC, &start_handle);
+    input_frame.latency.stamp_start(FRAME_LATENCY_STAGE_MULTI_RESIZE);
 
     if (validate_input_and_output_frames(input_frame, output_frames) != MEDIA_LIBRARY_SUCCESS)
     {
@@ -629,7 +1325,8 @@ media_library_return MediaLibraryMultiResize::Impl::handle_frame(hailo_media_lib
         return MEDIA_LIBRARY_INVALID_ARGUMENT;
     }
 
-    std::shared_lock<std::shared_mutex> lock(rw_lock);
+    // The frame updates the per-output state (consumer saturation, letterbox padding) and the resize groups
+    std::unique_lock<std::shared_mutex> lock(rw_lock);
 
     // Acquire output buffers
     media_library_return media_lib_ret = MEDIA_LIBRARY_SUCCESS;
@@ -639,6 +1336,7 @@ media_library_return MediaLibraryMultiResize::Impl::handle_frame(hailo_media_lib
         input_frame.decrease_ref_count();
         return media_lib_ret;
     }
+    acquire_roi_stream_buffers(input_frame, output_frames);
 
     // Handle grayscaling
     if (m_multi_resize_config.output_video_config.grayscale)
@@ -651,9 +1349,21 @@ media_library_return MediaLibraryMultiResize::Impl::handle_frame(hailo_media_lib
     // Perform multi resize
     media_lib_ret = perform_multi_resize(input_frame, output_frames);
 
+    // The output frames carry on the latency record of the input frame
+    input_frame.latency.stamp_end(FRAME_LATENCY_STAGE_MULTI_RESIZE);
+    for (hailo_media_library_buffer &output_frame : output_frames)
+        output_frame.latency = input_frame.latency;
+
     // Unref the input frame
     input_frame.decrease_ref_count();
 
+    // Deliver the ROI streams without holding the lock, so their receivers may reconfigure
+    std::vector<roi_stream_delivery_t> deliveries;
+    collect_roi_stream_frames(output_frames, media_lib_ret == MEDIA_LIBRARY_SUCCESS, deliveries);
+    lock.unlock();
+    for (roi_stream_delivery_t &delivery : deliveries)
+        delivery.on_frame(delivery.stream_id, delivery.frame);
+
     if (media_lib_ret != MEDIA_LIBRARY_SUCCESS)
         return media_lib_ret;
 
@@ -687,7 +1397,20 @@ media_library_return MediaLibraryMultiResize::Impl::set_input_video_config(uint3
     m_multi_resize_config.input_video_config.dimensions.destination_height = height;
     m_multi_resize_config.input_video_config.framerate = framerate;
 
-    // Check if the new framerate is a multiple of each output framerate
+    // ROI streams which no longer fit in the input frame are skipped until they are moved
+    for (roi_stream_t &roi_stream : m_roi_streams)
+    {
+        roi_stream.roi_out_of_frame = !crop_roi_in_input_frame(roi_stream.output_res.get_crop_roi());
+        if (roi_stream.roi_out_of_frame)
+            LOGGER__WARNING("ROI of ROI stream {} exceeds the input frame {}x{}, skipping the stream until it is moved", roi_stream.id, width, height);
+    }
+
+    // Register the sensor again, now that its framerate is known
+    dsp_scheduler::sensor_id_t prev_sensor_id = m_dsp_sensor_id;
+    m_dsp_sensor_id = dsp_scheduler::register_sensor(m_multi_resize_config.video_device, framerate);
+    dsp_scheduler::unregister_sensor(prev_sensor_id);
+
+    // Check if the new framerate is a multiple of each output framerate, and that the crop ROIs fit in the new frame
     for (auto &output_config : m_multi_resize_config.output_video_config.resolutions)
     {
         if (framerate % output_config.framerate != 0)
@@ -695,6 +1418,12 @@ media_library_return MediaLibraryMultiResize::Impl::set_input_video_config(uint3
             LOGGER__ERROR("The new input framerate {} is not a multiple of the output framerate {}", framerate, output_config.framerate);
             return MEDIA_LIBRARY_INVALID_ARGUMENT;
         }
+        if (output_config.dimensions.perform_crop && !crop_roi_in_input_frame(output_config.get_crop_roi()))
+        {
+            roi_t roi = output_config.get_crop_roi();
+            LOGGER__ERROR("The new input resolution {}x{} does not hold the output crop ROI x {} y {} width {} height {}", width, height, roi.x, roi.y, roi.width, roi.height);
+            return MEDIA_LIBRARY_INVALID_ARGUMENT;
+        }
     }
 
     media_library_return blender_config_status = m_privacy_mask_blender->set_frame_size(m_multi_resize_config.input_video_config.dimensions.destination_width,
@@ -708,6 +1437,158 @@ media_library_return MediaLibraryMultiResize::Impl::set_input_video_config(uint3
     return blender_config_status;
 }
 
+media_library_return MediaLibraryMultiResize::Impl::set_output_crop_roi(uint32_t output_index, bool enabled, const roi_t &roi)
+{
+    std::unique_lock<std::shared_mutex> lock(rw_lock);
+    std::vector<output_resolution_t> &resolutions = m_multi_resize_config.output_video_config.resolutions;
+    if (output_index >= resolutions.size())
+    {
+        LOGGER__ERROR("Invalid output index {} - multi-resize has {} outputs", output_index, resolutions.size());
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+
+    if (!enabled)
+    {
+        LOGGER__INFO("Clearing crop ROI of output {}", output_index);
+        resolutions[output_index].clear_crop_roi();
+        return MEDIA_LIBRARY_SUCCESS;
+    }
+
+    if (!crop_roi_in_input_frame(roi))
+    {
+        LOGGER__ERROR("Invalid crop ROI for output {} - x {} y {} width {} height {} must be non-empty and fit in the input frame {}x{}",
+                      output_index, roi.x, roi.y, roi.width, roi.height,
+                      m_multi_resize_config.input_video_config.dimensions.destination_width,
+                      m_multi_resize_config.input_video_config.dimensions.destination_height);
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+
+    LOGGER__INFO("Setting crop ROI of output {} to x {} y {} width {} height {}", output_index, roi.x, roi.y, roi.width, roi.height);
+    resolutions[output_index].set_crop_roi(roi);
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+media_library_return MediaLibraryMultiResize::Impl::set_output_consumer_level(uint32_t output_index, uint32_t queued_buffers, uint32_t max_queued_buffers)
+{
+    std::unique_lock<std::shared_mutex> lock(rw_lock);
+    if (output_index >= m_output_contexts.size())
+    {
+        LOGGER__ERROR("Invalid output index {} - multi-resize has {} outputs", output_index, m_output_contexts.size());
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+
+    output_context_t &output_context = m_output_contexts[output_index];
+    output_context.consumer_queued_buffers = queued_buffers;
+    output_context.consumer_max_queued_buffers = max_queued_buffers;
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+tl::expected<uint32_t, media_library_return> MediaLibraryMultiResize::Impl::add_roi_stream(const output_resolution_t &output_res, const roi_t &roi, roi_stream_callback_t on_frame)
+{
+    uint width = output_res.dimensions.destination_width;
+    uint height = output_res.dimensions.destination_height;
+    if (width == 0 || height == 0 || roi.width == 0 || roi.height == 0 || on_frame == nullptr)
+    {
+        LOGGER__ERROR("Invalid ROI stream - output {}x{}, ROI {}x{}, and a frame callback are required", width, height, roi.width, roi.height);
+        return tl::make_unexpected(MEDIA_LIBRARY_INVALID_ARGUMENT);
+    }
+    if (output_res.color_conversion_required())
+    {
+        LOGGER__ERROR("ROI streams are produced in the input color format, color format {} is not supported", output_res.color_format);
+        return tl::make_unexpected(MEDIA_LIBRARY_INVALID_ARGUMENT);
+    }
+
+    // Allocate outside of the lock, so the frames keep flowing meanwhile
+    auto bytes_per_line = dsp_utils::get_dsp_desired_stride_from_width(width);
+    MediaLibraryBufferPoolPtr buffer_pool = std::make_shared<MediaLibraryBufferPool>(width, height, m_multi_resize_config.output_video_config.format, output_res.pool_max_buffers, CMA, bytes_per_line);
+    if (buffer_pool->init() != MEDIA_LIBRARY_SUCCESS)
+    {
+        LOGGER__ERROR("Failed to init the buffer pool of ROI stream {}x{}", width, height);
+        return tl::make_unexpected(MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(rw_lock);
+    uint32_t input_framerate = m_multi_resize_config.input_video_config.framerate;
+    if (output_res.framerate == 0 || (input_framerate != 0 && input_framerate % output_res.framerate != 0))
+    {
+        LOGGER__ERROR("ROI stream framerate {} is not a divisor of the input framerate {}", output_res.framerate, input_framerate);
+        return tl::make_unexpected(MEDIA_LIBRARY_INVALID_ARGUMENT);
+    }
+    if (!crop_roi_in_input_frame(roi))
+    {
+        LOGGER__ERROR("Invalid ROI stream - ROI x {} y {} width {} height {} exceeds the input frame {}x{}", roi.x, roi.y, roi.width, roi.height,
+                      m_multi_resize_config.input_video_config.dimensions.destination_width,
+                      m_multi_resize_config.input_video_config.dimensions.destination_height);
+        return tl::make_unexpected(MEDIA_LIBRARY_INVALID_ARGUMENT);
+    }
+
+    roi_stream_t roi_stream{};
+    roi_stream.id = m_next_roi_stream_id++;
+    roi_stream.output_res = output_res;
+    roi_stream.output_res.set_crop_roi(roi);
+    roi_stream.roi_out_of_frame = false;
+    roi_stream.buffer_pool = buffer_pool;
+    roi_stream.on_frame = on_frame;
+    m_roi_streams.emplace_back(std::move(roi_stream));
+
+    LOGGER__INFO("Added ROI stream {} ({}x{} at {} fps) of ROI x {} y {} width {} height {}, {} ROI streams",
+                 m_roi_streams.back().id, width, height, output_res.framerate, roi.x, roi.y, roi.width, roi.height, m_roi_streams.size());
+    return m_roi_streams.back().id;
+}
+
+media_library_return MediaLibraryMultiResize::Impl::set_roi_stream_roi(uint32_t stream_id, const roi_t &roi)
+{
+    if (roi.width == 0 || roi.height == 0)
+    {
+        LOGGER__ERROR("Invalid ROI for ROI stream {} - width ({}) and height ({}) must be positive", stream_id, roi.width, roi.height);
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(rw_lock);
+    auto roi_stream = std::find_if(m_roi_streams.begin(), m_roi_streams.end(), [stream_id](const roi_stream_t &stream)
+                                   { return stream.id == stream_id; });
+    if (roi_stream == m_roi_streams.end())
+    {
+        LOGGER__ERROR("Invalid ROI stream id {}", stream_id);
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+
+    if (!crop_roi_in_input_frame(roi))
+    {
+        LOGGER__ERROR("Invalid ROI for ROI stream {} - x {} y {} width {} height {} exceeds the input frame {}x{}", stream_id, roi.x, roi.y, roi.width, roi.height,
+                      m_multi_resize_config.input_video_config.dimensions.destination_width,
+                      m_multi_resize_config.input_video_config.dimensions.destination_height);
+        return MEDIA_LIBRARY_INVALID_ARGUMENT;
+    }
+
+    LOGGER__DEBUG("Moving ROI stream {} to x {} y {} width {} height {}", stream_id, roi.x, roi.y, roi.width, roi.height);
+    roi_stream->output_res.set_crop_roi(roi);
+    roi_stream->roi_out_of_frame = false;
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
+media_library_return MediaLibraryMultiResize::Impl::remove_roi_stream(uint32_t stream_id)
+{
+    MediaLibraryBufferPoolPtr buffer_pool;
+    {
+        std::unique_lock<std::shared_mutex> lock(rw_lock);
+        auto roi_stream = std::find_if(m_roi_streams.begin(), m_roi_streams.end(), [stream_id](const roi_stream_t &stream)
+                                       { return stream.id == stream_id; });
+        if (roi_stream == m_roi_streams.end())
+        {
+            LOGGER__ERROR("Invalid ROI stream id {}", stream_id);
+            return MEDIA_LIBRARY_INVALID_ARGUMENT;
+        }
+
+        // Free the pool of the stream outside of the lock
+        buffer_pool = roi_stream->buffer_pool;
+        m_roi_streams.erase(roi_stream);
+    }
+
+    LOGGER__INFO("Removed ROI stream {}", stream_id);
+    return MEDIA_LIBRARY_SUCCESS;
+}
+
 media_library_return MediaLibraryMultiResize::Impl::observe(const MediaLibraryMultiResize::callbacks_t &callbacks)
 {
     m_callbacks.push_back(callbacks);
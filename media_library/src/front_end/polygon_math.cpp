@@ -1,278 +1,58 @@
-#include "opencv2/imgproc.hpp"
-#include "opencv2/imgcodecs.hpp"
-#include "opencv2/highgui.hpp"
-#include <bitset>
-#include <iostream>
 #include <time.h>
-
 #include <vector>
 #include <algorithm>
 #include <math.h>
 #include <string.h>
-#include <stdlib.h>
-#include <stdio.h>
 #include <limits.h>
-#include <float.h>
-#include <fstream>
-#include <numbers>
 
-#include "opencv2/core/core.hpp"
-#include "opencv2/core/types_c.h"
-#include <opencv2/core/mat.hpp>
 #include "media_library_utils.hpp"
 #include "media_library_logger.hpp"
 #include "polygon_math.hpp"
-
-using namespace cv;
-
-// Local definitions - Use enum becuase they are only valid within the scope in which they are defined
-enum
-{
-    CV_AA = 16,
-    XY_SHIFT = 16,
-    XY_ONE = 1 << XY_SHIFT,
-    DRAWING_STORAGE_BLOCK = (1 << 12) - 256
-};
-
-struct PolyEdge
-{
-    PolyEdge() : y0(0), y1(0), x(0), dx(0), next(0) {}
-
-    int y0, y1;
-    int x, dx;
-    PolyEdge *next;
-};
-
-struct CmpEdges
-{
-    bool operator()(const PolyEdge &e1, const PolyEdge &e2)
-    {
-        return e1.y0 - e2.y0 ? e1.y0 < e2.y0 : e1.x - e2.x ? e1.x < e2.x
-                                                           : e1.dx < e2.dx;
-    }
-};
+#include "bitmask_rasterizer.hpp"
 
 /**
- * Fills a packaged array with a line segment.
- *
- * The binary image is represented as a vector of bytes (packaged_array),
- * where each byte represents 8 pixels in the image.
- * The line is specified by its y-coordinate (y) and the x-coordinates of its start and end points (x1 and x2).
- *
- * @param width The width of the array.
- * @param y The y-coordinate of the line.
- * @param x1 The starting x-coordinate of the line.
- * @param x2 The ending x-coordinate of the line.
- * @param packaged_array The vector representing the packaged array.
+ * @brief Maps a vertex of the frame the polygons are given in to the frame rotated clockwise by rotation, of
+ * frame_width x frame_height. Exact - vertices are on the pixel corners, which rotate onto pixel corners.
  */
-static void fill_packaged_array_with_line(uint width, uint y, uint x1, uint x2, std::vector<uint8_t> &packaged_array)
-{
-    uint offset_mod, packaged_array_offset, num_of_bytes, bytes_mod = 0;
-    uint8_t byte_mask;
-    int num_of_pixels;
-
-    // x1 could be simaller to x2 - in this case we should set only one pixel
-    if (x1 == x2)
-        num_of_pixels = 1;
-    else
-        num_of_pixels = (x2 - x1);
-
-    // Create a mask for the first byte
-    offset_mod = (y * width + x1) % 8;
-
-    num_of_pixels -= (8 - offset_mod);
-    // Byte mask is 255 shifted (right) by the offset
-    byte_mask = 255 >> offset_mod;
-    if (num_of_pixels < 0)
-    {
-        // Not a full byte left - we should zero num_of_pixels bits from the byte_mask:
-        // mask = 1 << num_of_pixels * (-1)
-        // mask = mask -1
-        uint8_t mask = (1 << (num_of_pixels * -1)) - 1;
-
-        // byte_mask = byte_mask AND (NOT mask)
-        byte_mask &= ~mask;
-        num_of_pixels = 0;
-    }
-
-    // Calculate the offset in the packaged array
-    packaged_array_offset = (y * width + x1) / 8;
-    // Set the first byte of the row
-    packaged_array[packaged_array_offset] |= byte_mask;
-
-    num_of_bytes = num_of_pixels / 8;
-
-    // memset the full bytes with 255
-    if (num_of_pixels >= 8)
-        memset(&packaged_array[packaged_array_offset + 1], 255, num_of_bytes);
-
-    bytes_mod = num_of_pixels % 8;
-    // Create a mask for the last byte
-    byte_mask = 255 << (8 - bytes_mod);
-    // Set the last byte of the row
-    packaged_array[(packaged_array_offset + num_of_bytes + 1)] |= byte_mask;
-}
-
-static void
-fill_edge_collection(Mat &img, std::vector<PolyEdge> &edges, const void *color, uint stride, std::vector<uint8_t> &packaged_array)
+static void rotate_vertex(const privacy_mask_types::vertex &vertex, uint frame_width, uint frame_height, rotation_angle_t rotation, int64_t &x, int64_t &y)
 {
-    PolyEdge tmp;
-    int i, y, total = (int)edges.size();
-    Size size = img.size();
-    PolyEdge *e;
-    int y_max = INT_MIN, y_min = INT_MAX;
-    int64 x_max = 0xFFFFFFFFFFFFFFFF, x_min = 0x7FFFFFFFFFFFFFFF;
-
-    if (total < 2)
-        return;
-
-    for (i = 0; i < total; i++)
-    {
-        PolyEdge &e1 = edges[i];
-        CV_Assert(e1.y0 < e1.y1);
-        // Determine x-coordinate of the end of the edge.
-        // (This is not necessary x-coordinate of any vertex in the array.)
-        int64 x1 = e1.x + (e1.y1 - e1.y0) * e1.dx;
-        y_min = std::min<int>(y_min, e1.y0);
-        y_max = std::max<int>(y_max, e1.y1);
-        x_min = std::min<int>(x_min, e1.x);
-        x_max = std::max<int>(x_max, e1.x);
-        x_min = std::min<int>(x_min, x1);
-        x_max = std::max<int>(x_max, x1);
-    }
-
-    if (y_max < 0 || y_min >= size.height || x_max < 0 || x_min >= ((int64)size.width << XY_SHIFT))
-        return;
-
-    std::sort(edges.begin(), edges.end(), CmpEdges());
-
-    // start drawing
-    tmp.y0 = INT_MAX;
-    edges.push_back(tmp); // after this point we do not add
-                          // any elements to edges, thus we can use pointers
-    i = 0;
-    tmp.next = 0;
-    e = &edges[i];
-    y_max = MIN(y_max, size.height);
-
-    for (y = e->y0; y < y_max; y++)
+    switch (rotation)
     {
-        PolyEdge *last, *prelast, *keep_prelast;
-        int draw = 0;
-        int clipline = y < 0;
-
-        prelast = &tmp;
-        last = tmp.next;
-        while (last || e->y0 == y)
-        {
-            if (last && last->y1 == y)
-            {
-                // exclude edge if y reaches its lower point
-                prelast->next = last->next;
-                last = last->next;
-                continue;
-            }
-            keep_prelast = prelast;
-            if (last && (e->y0 > y || last->x < e->x))
-            {
-                // go to the next edge in active list
-                prelast = last;
-                last = last->next;
-            }
-            else if (i < total)
-            {
-                // insert new edge into active list if y reaches its upper point
-                prelast->next = e;
-                e->next = last;
-                prelast = e;
-                e = &edges[++i];
-            }
-            else
-                break;
-
-            if (draw)
-            {
-                if (!clipline)
-                {
-                    // convert x's from fixed-point to image coordinates
-                    int x1, x2;
-
-                    if (keep_prelast->x > prelast->x)
-                    {
-                        x1 = (int)((prelast->x + XY_ONE - 1) >> XY_SHIFT);
-                        x2 = (int)(keep_prelast->x >> XY_SHIFT);
-                    }
-                    else
-                    {
-                        x1 = (int)((keep_prelast->x + XY_ONE - 1) >> XY_SHIFT);
-                        x2 = (int)(prelast->x >> XY_SHIFT);
-                    }
-
-                    // clip and draw the line
-                    if (x1 < size.width && x2 >= 0)
-                    {
-                        if (x1 < 0)
-                            x1 = 0;
-                        if (x2 >= size.width)
-                            x2 = size.width - 1;
-
-                        fill_packaged_array_with_line(stride, y, x1, x2, packaged_array);
-                    }
-                }
-                keep_prelast->x += keep_prelast->dx;
-                prelast->x += prelast->dx;
-            }
-            draw ^= 1;
-        }
-
-        // sort edges (using bubble sort)
-        keep_prelast = 0;
-
-        do
-        {
-            prelast = &tmp;
-            last = tmp.next;
-            PolyEdge *last_exchange = 0;
-
-            while (last != keep_prelast && last->next != 0)
-            {
-                PolyEdge *te = last->next;
-
-                // swap edges
-                if (last->x > te->x)
-                {
-                    prelast->next = te;
-                    last->next = te->next;
-                    te->next = last;
-                    prelast = te;
-                    last_exchange = prelast;
-                }
-                else
-                {
-                    prelast = last;
-                    last = te;
-                }
-            }
-            if (last_exchange == NULL)
-                break;
-            keep_prelast = last_exchange;
-        } while (keep_prelast != tmp.next && keep_prelast != &tmp);
+    case ROTATION_ANGLE_90:
+        x = static_cast<int64_t>(frame_width) - vertex.y;
+        y = vertex.x;
+        break;
+    case ROTATION_ANGLE_180:
+        x = static_cast<int64_t>(frame_width) - vertex.x;
+        y = static_cast<int64_t>(frame_height) - vertex.y;
+        break;
+    case ROTATION_ANGLE_270:
+        x = vertex.y;
+        y = static_cast<int64_t>(frame_height) - vertex.x;
+        break;
+    default:
+        x = vertex.x;
+        y = vertex.y;
+        break;
     }
 }
 
-static std::vector<Point> convert_vertices_to_points(const std::vector<privacy_mask_types::vertex> &vertices, roi_t &roi)
+static std::vector<bitmask_point_t> convert_vertices_to_points(const std::vector<privacy_mask_types::vertex> &vertices, uint frame_width, uint frame_height, rotation_angle_t rotation, roi_t &roi)
 {
     int min_x = INT_MAX;
     int min_y = INT_MAX;
-    int max_x = 0;
-    int max_y = 0;
+    int max_x = INT_MIN;
+    int max_y = INT_MIN;
 
-    std::vector<Point> points;
+    std::vector<bitmask_point_t> points;
     points.reserve(vertices.size());
 
     for (const auto &vertex : vertices)
     {
-        Point point(vertex.x * PRIVACY_MASK_QUANTIZATION, vertex.y * PRIVACY_MASK_QUANTIZATION);
+        // Vertices right of or below the frame rotate to negative coordinates
+        int64_t x, y;
+        rotate_vertex(vertex, frame_width, frame_height, rotation, x, y);
+        bitmask_point_t point = {static_cast<int>(std::floor(x * PRIVACY_MASK_QUANTIZATION)), static_cast<int>(std::floor(y * PRIVACY_MASK_QUANTIZATION))};
         points.emplace_back(point);
 
         min_x = std::min(min_x, point.x);
@@ -281,237 +61,289 @@ static std::vector<Point> convert_vertices_to_points(const std::vector<privacy_m
         max_y = std::max(max_y, point.y);
     }
 
+    // Clipped at the top left corner of the frame, empty if the polygon is left of or above it
+    min_x = std::max(min_x, 0);
+    min_y = std::max(min_y, 0);
     roi.x = min_x;
     roi.y = min_y;
-    roi.width = max_x - min_x;
-    roi.height = max_y - min_y;
+    roi.width = std::max(max_x - min_x, 0);
+    roi.height = std::max(max_y - min_y, 0);
 
     return points;
 }
 
-static void
-collect_poly_edges(Mat &img, const Point2l *v, int count, std::vector<PolyEdge> &edges,
-                   const void *color, int line_type, int shift, Point offset)
+static void get_privacy_mask_geometry(uint frame_width, uint frame_height, uint &mask_width, uint &mask_height, uint &bytes_per_line)
 {
-    int i, delta = offset.y + ((1 << shift) >> 1);
-    Point2l pt0 = v[count - 1], pt1;
-    pt0.x = (pt0.x + offset.x) << (XY_SHIFT - shift);
-    pt0.y = (pt0.y + delta) >> shift;
+    // Quantize the frame size
+    mask_width = frame_width * PRIVACY_MASK_QUANTIZATION;
+    mask_height = frame_height * PRIVACY_MASK_QUANTIZATION;
+    // Round up frame_width to byte_size / quantization (32), handle padding (aligned to 8) - as the bitmask buffer
+    // pool of PrivacyMaskBlender does
+    uint line_division = 8 / PRIVACY_MASK_QUANTIZATION;
+    bytes_per_line = (((frame_width + line_division - 1) / line_division) + 7) & ~7;
+}
 
-    edges.reserve(edges.size() + count);
+roi_t get_privacy_mask_bounds(const privacy_mask_types::polygon &polygon, uint frame_width, uint frame_height, rotation_angle_t rotation)
+{
+    uint mask_width, mask_height, bytes_per_line;
+    get_privacy_mask_geometry(frame_width, frame_height, mask_width, mask_height, bytes_per_line);
+
+    roi_t roi;
+    std::vector<bitmask_point_t> points = convert_vertices_to_points(polygon.vertices, frame_width, frame_height, rotation, roi);
+    bool outside = std::all_of(points.begin(), points.end(), [](const bitmask_point_t &point)
+                               { return point.x < 0; }) ||
+                   std::all_of(points.begin(), points.end(), [](const bitmask_point_t &point)
+                               { return point.y < 0; });
+    if (points.empty() || outside || roi.x >= mask_width || roi.y >= mask_height)
+        return {0, 0, 0, 0};
+
+    // The ROI spans from the minimal to the maximal vertex, the pixels of the maximal vertex are set too
+    roi.width = std::min(roi.width + 1, mask_width - roi.x);
+    roi.height = std::min(roi.height + 1, mask_height - roi.y);
+    return roi;
+}
 
-    for (i = 0; i < count; i++, pt0 = pt1)
-    {
-        Point2l t0, t1;
-        PolyEdge edge;
+privacy_mask_types::yuv_color_t rgb_to_yuv(const privacy_mask_types::rgb_color_t &rgb_color)
+{
+    privacy_mask_types::yuv_color_t yuv_color;
+    yuv_color.y = 0.257 * rgb_color.r + 0.504 * rgb_color.g + 0.098 * rgb_color.b + 16;
+    yuv_color.u = -0.148 * rgb_color.r - 0.291 * rgb_color.g + 0.439 * rgb_color.b + 128;
+    yuv_color.v = 0.439 * rgb_color.r - 0.368 * rgb_color.g - 0.071 * rgb_color.b + 128;
+    return yuv_color;
+}
 
-        pt1 = v[i];
-        pt1.x = (pt1.x + offset.x) << (XY_SHIFT - shift);
-        pt1.y = (pt1.y + delta) >> shift;
+static uint64_t roi_area(const roi_t &roi)
+{
+    return static_cast<uint64_t>(roi.width) * roi.height;
+}
 
-        if (line_type < CV_AA)
-        {
-            t0.y = pt0.y;
-            t1.y = pt1.y;
-            t0.x = (pt0.x + (XY_ONE >> 1)) >> XY_SHIFT;
-            t1.x = (pt1.x + (XY_ONE >> 1)) >> XY_SHIFT;
-        }
-        else
+static roi_t roi_union(const roi_t &a, const roi_t &b)
+{
+    uint x = std::min(a.x, b.x);
+    uint y = std::min(a.y, b.y);
+    return {x, y, std::max(a.x + a.width, b.x + b.width) - x, std::max(a.y + a.height, b.y + b.height) - y};
+}
+
+// Area covered by merging two boxes besides the boxes themselves - negative for overlapping boxes
+static int64_t roi_merge_cost(const roi_t &a, const roi_t &b)
+{
+    return static_cast<int64_t>(roi_area(roi_union(a, b))) - static_cast<int64_t>(roi_area(a)) - static_cast<int64_t>(roi_area(b));
+}
+
+uint cluster_privacy_mask_rois(const std::vector<roi_t> &boxes, roi_t *rois, uint max_rois)
+{
+    std::vector<roi_t> clusters = boxes;
+    size_t count = clusters.size();
+    std::vector<bool> merged(count, false);
+    // For each cluster, the cheapest other cluster to merge with and the cost
+    std::vector<size_t> best(count);
+    std::vector<int64_t> best_cost(count);
+    auto find_best = [&](size_t i)
+    {
+        best[i] = i;
+        best_cost[i] = INT64_MAX;
+        for (size_t j = 0; j < clusters.size(); j++)
         {
-            t0.x = pt0.x;
-            t1.x = pt1.x;
-            t0.y = pt0.y << XY_SHIFT;
-            t1.y = pt1.y << XY_SHIFT;
+            if (merged[j] || j == i)
+                continue;
+            int64_t cost = roi_merge_cost(clusters[i], clusters[j]);
+            if (cost < best_cost[i])
+            {
+                best[i] = j;
+                best_cost[i] = cost;
+            }
         }
+    };
 
-        if (pt0.y == pt1.y)
-            continue;
+    if (count > max_rois)
+    {
+        for (size_t i = 0; i < clusters.size(); i++)
+            find_best(i);
+    }
 
-        if (pt0.y < pt1.y)
+    while (count > max_rois)
+    {
+        size_t i = clusters.size();
+        for (size_t k = 0; k < clusters.size(); k++)
         {
-            edge.y0 = (int)(pt0.y);
-            edge.y1 = (int)(pt1.y);
-            edge.x = pt0.x;
+            if (!merged[k] && (i == clusters.size() || best_cost[k] < best_cost[i]))
+                i = k;
         }
-        else
+        size_t j = best[i];
+
+        // Merge j into i
+        clusters[i] = roi_union(clusters[i], clusters[j]);
+        merged[j] = true;
+        count--;
+
+        // Only the costs to i changed. A cluster keeps i as its best if the cost did not grow, and looks again only
+        // if its best was i or j and got more expensive.
+        for (size_t k = 0; k < clusters.size(); k++)
         {
-            edge.y0 = (int)(pt1.y);
-            edge.y1 = (int)(pt0.y);
-            edge.x = pt1.x;
+            if (merged[k] || k == i)
+                continue;
+            int64_t cost = roi_merge_cost(clusters[k], clusters[i]);
+            if (cost <= best_cost[k])
+            {
+                best[k] = i;
+                best_cost[k] = cost;
+            }
+            else if (best[k] == i || best[k] == j)
+            {
+                find_best(k);
+            }
         }
-        edge.dx = (pt1.x - pt0.x) / (pt1.y - pt0.y);
-        edges.push_back(edge);
+        find_best(i);
     }
-}
 
-void scalar_to_raw_data(const Scalar &s, void *_buf, int type, int unroll_to)
-{
-    int i, depth = CV_MAT_DEPTH(type), cn = CV_MAT_CN(type);
-    CV_Assert(cn <= 4);
-    switch (depth)
+    uint rois_count = 0;
+    for (size_t i = 0; i < clusters.size(); i++)
     {
-    case CV_8U:
-    {
-        uchar *buf = (uchar *)_buf;
-        for (i = 0; i < cn; i++)
-            buf[i] = saturate_cast<uchar>(s.val[i]);
-        for (; i < unroll_to; i++)
-            buf[i] = buf[i - cn];
-    }
-    break;
-    default:
-        CV_Error(CV_StsUnsupportedFormat, "");
+        if (!merged[i])
+            rois[rois_count++] = clusters[i];
     }
+    return rois_count;
 }
 
-void fill_poly_internal(InputOutputArray _img, const Point **pts, const int *npts, int ncontours,
-                        const Scalar &color, int line_type,
-                        int shift, Point offset, uint stride, std::vector<uint8_t> &packaged_array)
+static void set_privacy_mask_rois(std::vector<privacy_mask_types::PolygonPtr> &polygons, uint frame_width, uint frame_height, rotation_angle_t rotation, const privacy_mask_types::rgb_color_t &color, privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data)
 {
+    struct timespec start_cluster, end_cluster;
+    clock_gettime(CLOCK_MONOTONIC, &start_cluster);
 
-    Mat img = _img.getMat();
-
-    if (line_type == CV_AA && img.depth() != CV_8U)
-        line_type = 8;
-
-    CV_Assert(pts && npts && ncontours >= 0 && 0 <= shift && shift <= XY_SHIFT);
-
-    double buf[4];
-    scalar_to_raw_data(color, buf, img.type(), 0);
-
-    std::vector<PolyEdge> edges;
-
-    int i, total = 0;
-    for (i = 0; i < ncontours; i++)
-        total += npts[i];
+    // Set the rois count and YUV color in the privacy mask data
+    privacy_mask_data->color = rgb_to_yuv(color);
 
-    edges.reserve(total + 1);
-    for (i = 0; i < ncontours; i++)
-    {
-        std::vector<Point2l> _pts(pts[i], pts[i] + npts[i]);
-        collect_poly_edges(img, _pts.data(), npts[i], edges, buf, line_type, shift, offset);
-    }
+    std::vector<roi_t> boxes(polygons.size());
+    for (size_t i = 0; i < polygons.size(); i++)
+        convert_vertices_to_points(polygons[i]->vertices, frame_width, frame_height, rotation, boxes[i]);
+    privacy_mask_data->rois_count = cluster_privacy_mask_rois(boxes, privacy_mask_data->rois, MAX_NUM_OF_PRIVACY_MASK_ROIS);
 
-    fill_edge_collection(img, edges, buf, stride, packaged_array);
+    clock_gettime(CLOCK_MONOTONIC, &end_cluster);
+    [[maybe_unused]] long ms = (long)media_library_difftimespec_ms(end_cluster, start_cluster);
+    LOGGER__DEBUG("clustering {} privacy masks into {} ROIs took {} milliseconds", polygons.size(), privacy_mask_data->rois_count, ms);
 }
 
-media_library_return fill_poly_packaged_array(InputOutputArray img, InputArrayOfArrays pts,
-                                              const Scalar &color, int lineType, int shift, uint stride, std::vector<uint8_t> &packaged_array)
+static uint8_t *get_privacy_mask_bitmask(privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data, uint bytes_per_line, uint mask_height)
 {
-
-    bool manyContours = pts.kind() == _InputArray::STD_VECTOR_VECTOR ||
-                        pts.kind() == _InputArray::STD_VECTOR_MAT;
-    int i, ncontours = manyContours ? (int)pts.total() : 1;
-    if (ncontours == 0)
-        return media_library_return::MEDIA_LIBRARY_SUCCESS;
-    AutoBuffer<Point *> _ptsptr(ncontours);
-    AutoBuffer<int> _npts(ncontours);
-    Point **ptsptr = _ptsptr.data();
-    int *npts = _npts.data();
-
-    for (i = 0; i < ncontours; i++)
+    if (privacy_mask_data->bitmask.hailo_pix_buffer->planes[0].bytesused != bytes_per_line * mask_height)
     {
-        Mat p = pts.getMat(manyContours ? i : -1);
-        CV_Assert(p.checkVector(2, CV_32S) >= 0);
-        ptsptr[i] = p.ptr<Point>();
-        npts[i] = p.rows * p.cols * p.channels() / 2;
+        LOGGER__ERROR("Failed to fill polygon - privacy mask buffer size is not equal to the packaged array size");
+        return nullptr;
     }
-    fill_poly_internal(img, (const Point **)ptsptr, npts, (int)ncontours, color, lineType, shift, Point(), stride, packaged_array);
-    return media_library_return::MEDIA_LIBRARY_SUCCESS;
+    return (uint8_t *)privacy_mask_data->bitmask.hailo_pix_buffer->planes[0].userptr;
 }
 
-privacy_mask_types::yuv_color_t rgb_to_yuv(const privacy_mask_types::rgb_color_t &rgb_color)
+media_library_return write_polygons_to_privacy_mask_data(std::vector<privacy_mask_types::PolygonPtr> &polygons, const uint &frame_width, const uint &frame_height, rotation_angle_t rotation, const privacy_mask_types::rgb_color_t &color, privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data)
 {
-    privacy_mask_types::yuv_color_t yuv_color;
-    yuv_color.y = 0.257 * rgb_color.r + 0.504 * rgb_color.g + 0.098 * rgb_color.b + 16;
-    yuv_color.u = -0.148 * rgb_color.r - 0.291 * rgb_color.g + 0.439 * rgb_color.b + 128;
-    yuv_color.v = 0.439 * rgb_color.r - 0.368 * rgb_color.g - 0.071 * rgb_color.b + 128;
-    return yuv_color;
-}
+    struct timespec start_fill_polly, end_fill_polly;
+    clock_gettime(CLOCK_MONOTONIC, &start_fill_polly);
 
-media_library_return rotate_polygon(privacy_mask_types::PolygonPtr polygon, double rotation_angle, uint frame_width, uint frame_height)
-{
-    double xm = static_cast<double>(frame_width) / 2;
-    double ym = static_cast<double>(frame_height) / 2;
+    uint mask_width, mask_height, bytes_per_line;
+    get_privacy_mask_geometry(frame_width, frame_height, mask_width, mask_height, bytes_per_line);
+    uint8_t *bitmask = get_privacy_mask_bitmask(privacy_mask_data, bytes_per_line, mask_height);
+    if (bitmask == nullptr)
+        return media_library_return::MEDIA_LIBRARY_ERROR;
 
-    // Convert to Radians
-    rotation_angle = rotation_angle * std::numbers::pi / 180.0;
-    for (auto &vertex : polygon->vertices)
+    // Draw directly into the bitmask buffer
+    memset(bitmask, 0, bytes_per_line * mask_height);
+    roi_t mask_rect = {0, 0, mask_width, mask_height};
+    for (const auto &polygon : polygons)
     {
-        double trans_x =  vertex.x  - xm;
-        double trans_y = ym - vertex.y;
-        double x_res = (trans_x * std::cos(rotation_angle) + trans_y * std::sin(rotation_angle)) + xm;
-        double y_res = ym - ((-1)*trans_x * std::sin(rotation_angle) + trans_y * std::cos(rotation_angle));
-        vertex.x = x_res;
-        vertex.y = y_res;
+        roi_t roi;
+        fill_polygon_bitmask(convert_vertices_to_points(polygon->vertices, frame_width, frame_height, rotation, roi), mask_rect, bitmask, bytes_per_line);
     }
 
-    return media_library_return::MEDIA_LIBRARY_SUCCESS;
-}
+    clock_gettime(CLOCK_MONOTONIC, &end_fill_polly);
+    [[maybe_unused]] long ms = (long)media_library_difftimespec_ms(end_fill_polly, start_fill_polly);
+    LOGGER__DEBUG("perform fill of {} polygons took {} milliseconds", polygons.size(), ms);
 
-media_library_return rotate_polygons(std::vector<privacy_mask_types::PolygonPtr> &polygons, double rotation_angle, uint frame_width, uint frame_height)
-{
-    for(auto &polygon : polygons)
-    {
-        if (rotate_polygon(polygon, rotation_angle, frame_width, frame_height) != media_library_return::MEDIA_LIBRARY_SUCCESS)
-            return media_library_return::MEDIA_LIBRARY_ERROR;
-    }
+    set_privacy_mask_rois(polygons, frame_width, frame_height, rotation, color, privacy_mask_data);
 
     return media_library_return::MEDIA_LIBRARY_SUCCESS;
 }
 
-media_library_return write_polygons_to_privacy_mask_data(std::vector<privacy_mask_types::PolygonPtr> &polygons, const uint &frame_width, const uint &frame_height, const privacy_mask_types::rgb_color_t &color, privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data)
+media_library_return update_privacy_mask_data(std::vector<privacy_mask_types::PolygonPtr> &polygons, const std::vector<roi_t> &dirty_rects, const uint &frame_width, const uint &frame_height, rotation_angle_t rotation, const privacy_mask_types::rgb_color_t &color, privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data)
 {
     struct timespec start_fill_polly, end_fill_polly;
     clock_gettime(CLOCK_MONOTONIC, &start_fill_polly);
 
-    // Quantize the frame size
-    int mask_width = frame_width * PRIVACY_MASK_QUANTIZATION;
-    int mask_height = frame_height * PRIVACY_MASK_QUANTIZATION;
+    uint mask_width, mask_height, bytes_per_line;
+    get_privacy_mask_geometry(frame_width, frame_height, mask_width, mask_height, bytes_per_line);
+    uint8_t *bitmask = get_privacy_mask_bitmask(privacy_mask_data, bytes_per_line, mask_height);
+    if (bitmask == nullptr)
+        return media_library_return::MEDIA_LIBRARY_ERROR;
 
-    // Initialize a matrix of zeros
-    Mat mask = Mat::zeros(Size(mask_width, mask_height), CV_8UC1);
-    auto white = Scalar(255, 255, 255);
+    // Redraw each dirty rectangle from scratch - the polygons overlapping it are clipped to it
+    uint64_t redrawn_pixels = 0;
+    for (const roi_t &rect : dirty_rects)
+    {
+        clear_bitmask_rect(bitmask, bytes_per_line, rect);
+        for (const auto &polygon : polygons)
+        {
+            roi_t bounds = get_privacy_mask_bounds(*polygon, frame_width, frame_height, rotation);
+            if (bounds.x >= rect.x + rect.width || rect.x >= bounds.x + bounds.width ||
+                bounds.y >= rect.y + rect.height || rect.y >= bounds.y + bounds.height)
+                continue;
+            roi_t roi;
+            fill_polygon_bitmask(convert_vertices_to_points(polygon->vertices, frame_width, frame_height, rotation, roi), rect, bitmask, bytes_per_line);
+        }
+        redrawn_pixels += rect.width * rect.height;
+    }
 
-    // Round up frame_width to byte_size / quantization (32)
-    int line_division = 8 / PRIVACY_MASK_QUANTIZATION;
-    int bytes_per_line = (frame_width/line_division + 7) & ~7;
-    // Handle padding (aligned to 8)
-    int mask_width_with_stride = bytes_per_line*8;
+    clock_gettime(CLOCK_MONOTONIC, &end_fill_polly);
+    [[maybe_unused]] long ms = (long)media_library_difftimespec_ms(end_fill_polly, start_fill_polly);
+    LOGGER__DEBUG("update of {} dirty regions ({} of {} mask pixels) of {} polygons took {} milliseconds", dirty_rects.size(), redrawn_pixels, mask_width * mask_height, polygons.size(), ms);
 
-    // To represent a bit per pixel structure - set packaged array size to /8 and add one if it is not a multiple of 8
-    uint packaged_array_size = (mask_width_with_stride * mask_height) / 8 + ((mask_width_with_stride * mask_height) % 8 == 0 ? 0 : 1);
-    std::vector<uint8_t> packaged_array(packaged_array_size, 0);
+    set_privacy_mask_rois(polygons, frame_width, frame_height, rotation, color, privacy_mask_data);
 
-    // Set the rois count and YUV color in the privacy mask data
-    privacy_mask_data->rois_count = polygons.size();
-    privacy_mask_data->color = rgb_to_yuv(color);
+    return media_library_return::MEDIA_LIBRARY_SUCCESS;
+}
 
-    uint i = 0;
-    for (const auto &polygon : polygons)
-    {
-        std::vector<Point> pts = convert_vertices_to_points(polygon->vertices, privacy_mask_data->rois[i]);
+media_library_return write_rects_to_privacy_mask_data(const std::vector<roi_t> &rects, const uint &frame_width, const uint &frame_height, privacy_mask_types::PrivacyMaskDataPtr static_data, privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data)
+{
+    struct timespec start_fill_rects, end_fill_rects;
+    clock_gettime(CLOCK_MONOTONIC, &start_fill_rects);
 
-        if (fill_poly_packaged_array(mask, pts, white, 8, 0, mask_width_with_stride, packaged_array) != media_library_return::MEDIA_LIBRARY_SUCCESS)
-        {
-            LOGGER__ERROR("Failed to fill polygon");
+    uint mask_width, mask_height, bytes_per_line;
+    get_privacy_mask_geometry(frame_width, frame_height, mask_width, mask_height, bytes_per_line);
+    uint8_t *bitmask = get_privacy_mask_bitmask(privacy_mask_data, bytes_per_line, mask_height);
+    if (bitmask == nullptr)
+        return media_library_return::MEDIA_LIBRARY_ERROR;
+
+    std::vector<roi_t> boxes;
+    boxes.reserve(static_data->rois_count + rects.size());
+    if (static_data->rois_count > 0)
+    {
+        uint8_t *static_bitmask = get_privacy_mask_bitmask(static_data, bytes_per_line, mask_height);
+        if (static_bitmask == nullptr)
             return media_library_return::MEDIA_LIBRARY_ERROR;
-        }
-        i++;
+        memcpy(bitmask, static_bitmask, bytes_per_line * mask_height);
+        boxes.insert(boxes.end(), static_data->rois, static_data->rois + static_data->rois_count);
     }
-
-    if (privacy_mask_data->bitmask.hailo_pix_buffer->planes[0].bytesused != packaged_array_size)
+    else
     {
-        LOGGER__ERROR("Failed to fill polygon - privacy mask buffer size is not equal to the packaged array size");
-        return media_library_return::MEDIA_LIBRARY_ERROR;
+        memset(bitmask, 0, bytes_per_line * mask_height);
     }
-    // memcopy packaged array to privacy_mask_data void pointer bit mask
-    memcpy(privacy_mask_data->bitmask.hailo_pix_buffer->planes[0].userptr, packaged_array.data(), packaged_array_size);
 
-    clock_gettime(CLOCK_MONOTONIC, &end_fill_polly);
-    [[maybe_unused]] long ms = (long)media_library_difftimespec_ms(end_fill_polly, start_fill_polly);
-    LOGGER__DEBUG("perform fill polygon took {} milliseconds ({} fps)", ms, (1000 / ms));
+    // Quantize each rectangle outwards, so that it is fully covered
+    for (const roi_t &rect : rects)
+    {
+        uint x_start = rect.x * PRIVACY_MASK_QUANTIZATION;
+        uint y_start = rect.y * PRIVACY_MASK_QUANTIZATION;
+        uint x_end = std::min<uint>(std::ceil((rect.x + rect.width) * PRIVACY_MASK_QUANTIZATION), mask_width);
+        uint y_end = std::min<uint>(std::ceil((rect.y + rect.height) * PRIVACY_MASK_QUANTIZATION), mask_height);
+        if (x_start >= x_end || y_start >= y_end)
+            continue;
+        roi_t mask_rect = {x_start, y_start, x_end - x_start, y_end - y_start};
+        fill_bitmask_rect(bitmask, bytes_per_line, mask_rect);
+        boxes.push_back(mask_rect);
+    }
+    privacy_mask_data->color = static_data->color;
+    privacy_mask_data->rois_count = cluster_privacy_mask_rois(boxes, privacy_mask_data->rois, MAX_NUM_OF_PRIVACY_MASK_ROIS);
 
+    clock_gettime(CLOCK_MONOTONIC, &end_fill_rects);
+    [[maybe_unused]] long ms = (long)media_library_difftimespec_ms(end_fill_rects, start_fill_rects);
+    LOGGER__DEBUG("fill of {} rectangles into {} ROIs took {} milliseconds", rects.size(), privacy_mask_data->rois_count, ms);
 
     return media_library_return::MEDIA_LIBRARY_SUCCESS;
-}
\ No newline at end of file
+}
@@ -34,33 +34,82 @@
 /**
  * @brief Fills a privacy mask data structure with polygons.
  * 
- * The target is to represent the binary image as a vector of bytes (packaged_array),
+ * The target is to represent the binary image as an array of bytes (packaged_array),
  * Where each pixel represents 4 pixels in the original image,
  * and each byte in memory (uint8) contains 8 pixels
- * Then it is copied into void* bitmask, this way it can be send to the HailoDSP later.
+ * It is drawn directly into the bitmask buffer of the privacy mask data, this way it can be send to the HailoDSP.
  * 
- * We use the OpenCV fillPoly functionality to fill the bitmask using Scanline Fill Algorithm.
+ * The polygons are filled using Scanline Fill Algorithm - see fill_polygon_bitmask.
  * 
- * @param polygons Vector of polygons to fill.
+ * @param polygons Vector of polygons to fill, in the frame before rotation.
+ * @param frame_width The width of the frame, after rotation.
+ * @param frame_height The height of the frame, after rotation.
+ * @param rotation The rotation of the frame - the polygons are rotated with it.
+ * @param color The color of the polygons (RGB).
+ * @param privacy_mask_data The privacy mask data structure to fill.
+ */
+media_library_return write_polygons_to_privacy_mask_data(std::vector<privacy_mask_types::PolygonPtr> &polygons, const uint &frame_width, const uint &frame_height, rotation_angle_t rotation, const privacy_mask_types::rgb_color_t &color, privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data);
+
+/**
+ * @brief Redraws the dirty rectangles of a privacy mask data structure filled by write_polygons_to_privacy_mask_data.
+ *
+ * Each rectangle is cleared and the polygons overlapping it are filled clipped to it, so the cost of an update is
+ * proportional to the area of the rectangles rather than to the frame.
+ *
+ * @param polygons Vector of all the polygons, in the frame before rotation.
+ * @param dirty_rects Rectangles of the quantized mask to redraw - see get_privacy_mask_bounds.
+ * @param frame_width The width of the frame, after rotation.
+ * @param frame_height The height of the frame, after rotation.
+ * @param rotation The rotation of the frame.
+ * @param color The color of the polygons (RGB).
+ * @param privacy_mask_data The privacy mask data structure to update.
+ */
+media_library_return update_privacy_mask_data(std::vector<privacy_mask_types::PolygonPtr> &polygons, const std::vector<roi_t> &dirty_rects, const uint &frame_width, const uint &frame_height, rotation_angle_t rotation, const privacy_mask_types::rgb_color_t &color, privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data);
+
+/**
+ * @brief Fills the privacy mask data of a single frame - the static privacy masks, and rectangles masked in this
+ * frame only.
+ *
+ * The bitmask of the static masks is copied and the rectangles are set in the copy directly, without polygon
+ * rasterization. The ROIs of the static masks and the rectangles are clustered into the DSP ROIs.
+ *
+ * @param rects Rectangles to mask, in frame pixels.
  * @param frame_width The width of the frame.
  * @param frame_height The height of the frame.
- * @param color The color of the polygons (RGB).
+ * @param static_data The privacy mask data of the static masks, not modified. Its bitmask is used only if it has ROIs.
  * @param privacy_mask_data The privacy mask data structure to fill.
  */
-media_library_return write_polygons_to_privacy_mask_data(std::vector<privacy_mask_types::PolygonPtr> &polygons, const uint &frame_width, const uint &frame_height, const privacy_mask_types::rgb_color_t &color, privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data);
+media_library_return write_rects_to_privacy_mask_data(const std::vector<roi_t> &rects, const uint &frame_width, const uint &frame_height, privacy_mask_types::PrivacyMaskDataPtr static_data, privacy_mask_types::PrivacyMaskDataPtr privacy_mask_data);
 
 /**
- * @brief Rotates a vector of polygons.
- * 
- * @param polygons Vector of polygons to rotate.
- * @param rotation_angle The rotation angle.
-*/
-media_library_return rotate_polygons(std::vector<privacy_mask_types::PolygonPtr> &polygons, double rotation_angle, uint frame_width, uint frame_height);
+ * @brief Clusters bounding boxes into at most max_rois boxes covering them.
+ *
+ * Greedily merges the two boxes whose union covers the least area besides theirs, until max_rois are left, so that
+ * the area the DSP blends stays close to the area of the masks. Overlapping boxes are merged first.
+ *
+ * @param boxes The boxes to cluster.
+ * @param rois The clustered boxes, at least max_rois of them.
+ * @param max_rois The maximal number of clustered boxes.
+ * @return uint The number of clustered boxes.
+ */
+uint cluster_privacy_mask_rois(const std::vector<roi_t> &boxes, roi_t *rois, uint max_rois);
 
 /**
- * @brief Rotates a polygon.
- * 
- * @param polygon The polygon to rotate.
- * @param rotation_angle The rotation angle.
-*/
-media_library_return rotate_polygon(privacy_mask_types::PolygonPtr polygon, double rotation_angle, uint frame_width, uint frame_height);
+ * @brief Returns the rectangle of the quantized mask a polygon may set pixels in, clipped to the mask.
+ *
+ * @param polygon The polygon, in the frame before rotation.
+ * @param frame_width The width of the frame, after rotation.
+ * @param frame_height The height of the frame, after rotation.
+ * @param rotation The rotation of the frame.
+ * @return roi_t The rectangle, empty if the polygon is outside of the mask.
+ */
+roi_t get_privacy_mask_bounds(const privacy_mask_types::polygon &polygon, uint frame_width, uint frame_height, rotation_angle_t rotation);
+
+/**
+ * @brief Converts an RGB color to YUV (BT.601, limited range).
+ *
+ * @param rgb_color The RGB color to convert.
+ * @return privacy_mask_types::yuv_color_t The YUV color.
+ */
+privacy_mask_types::yuv_color_t rgb_to_yuv(const privacy_mask_types::rgb_color_t &rgb_color);
+
@@ -28,37 +28,74 @@
 
 using namespace privacy_mask_types;
 
-PrivacyMaskBlender::PrivacyMaskBlender()
+// Beyond this many dirty regions, a single region covering them all is redrawn
+#define MAX_NUM_OF_DIRTY_RECTS (16)
+// Number of bitmasks - one published while the other is drawn
+#define NUM_OF_PRIVACY_MASK_BUFFERS (2)
+// Number of bitmasks of frames with rectangles - a frame holds one until its resize is done
+#define NUM_OF_DYNAMIC_PRIVACY_MASK_BUFFERS (2)
+
+// Privacy mask data releasing its bitmask buffer with the last reference, so that a bitmask stays valid while a
+// frame still uses it
+static PrivacyMaskDataPtr make_privacy_mask_data()
 {
-  m_privacy_masks.reserve(MAX_NUM_OF_PRIVACY_MASKS);
+  PrivacyMaskDataPtr privacy_mask_data(new privacy_mask_data_t(), [](privacy_mask_data_t *data)
+                                       {
+                                         if (data->bitmask.hailo_pix_buffer != nullptr)
+                                           data->bitmask.decrease_ref_count();
+                                         delete data; });
+  privacy_mask_data->rois_count = 0;
+  return privacy_mask_data;
+}
 
+PrivacyMaskBlender::PrivacyMaskBlender()
+{
   // Black color for default
   m_color = {0, 0, 0};
   m_frame_width = 0;
   m_frame_height = 0;
+  m_rotation = ROTATION_ANGLE_0;
   m_privacy_mask_mutex = std::make_shared<std::mutex>();
+  m_release = std::make_shared<privacy_mask_release_t>();
+  m_stop_rasterize_worker = false;
 
-  m_buffer_pool = NULL;
-  m_latest_privacy_mask_data = NULL;
+  publish_state(NULL);
+  m_rasterize_worker = std::thread(&PrivacyMaskBlender::rasterize_worker_loop, this);
 }
 
 PrivacyMaskBlender::PrivacyMaskBlender(uint frame_width, uint frame_height)
 {
 
-  m_privacy_masks.reserve(MAX_NUM_OF_PRIVACY_MASKS);
-
   // Black color for default
   m_color = {0, 0, 0};
   m_frame_width = frame_width;
   m_frame_height = frame_height;
+  m_rotation = ROTATION_ANGLE_0;
   m_privacy_mask_mutex = std::make_shared<std::mutex>();
+  m_release = std::make_shared<privacy_mask_release_t>();
+  m_stop_rasterize_worker = false;
 
+  publish_state(NULL);
   set_frame_size(frame_width, frame_height);
-  m_latest_privacy_mask_data = NULL;
+  m_rasterize_worker = std::thread(&PrivacyMaskBlender::rasterize_worker_loop, this);
 }
 
 PrivacyMaskBlender::~PrivacyMaskBlender()
 {
+    {
+        std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
+        m_stop_rasterize_worker = true;
+    }
+    m_rasterize_cv.notify_all();
+    {
+        // The worker may be waiting for the frames to release a bitmask
+        std::unique_lock<std::mutex> release_lock(m_release->mutex);
+    }
+    m_release->cv.notify_all();
+    if (m_rasterize_worker.joinable())
+        m_rasterize_worker.join();
+
+    m_states.clear();
     m_privacy_masks.clear();
     dsp_status status = dsp_utils::release_device();
     if (status != DSP_SUCCESS)
@@ -105,33 +142,262 @@ tl::expected<PrivacyMaskBlenderPtr, media_library_return> PrivacyMaskBlender::cr
   return privacy_mask_blender_ptr;
 }
 
-media_library_return PrivacyMaskBlender::init_buffer_pool()
+media_library_return PrivacyMaskBlender::init_buffer_pools(const PrivacyMaskStatePtr &state)
 {
-    // Round up m_frame_width to be a multiple of byte_size / PRIVACY_MASK_QUANTIZATION (32)
+    // Called from the rasterization worker, the only one to set the buffer pools of a state
+    // Round up the frame width to be a multiple of byte_size / PRIVACY_MASK_QUANTIZATION (32)
     int line_division = 8 / PRIVACY_MASK_QUANTIZATION;
-    uint frame_width = ((m_frame_width + (line_division-1)) & ~(line_division-1))/line_division;
+    uint frame_width = ((state->frame_width + (line_division-1)) & ~(line_division-1))/line_division;
     // Round bytes_per_line to be a multiple of byte_size (8)
     uint bytes_per_line = (frame_width + 7) & ~7;
-    uint frame_height = m_frame_height/4;
-    // TODO: set pool size
-    m_buffer_pool = std::make_shared<MediaLibraryBufferPool>(frame_width, frame_height, DSP_IMAGE_FORMAT_GRAY8, 1, CMA, bytes_per_line);
-    if (m_buffer_pool->init() != MEDIA_LIBRARY_SUCCESS)
+    uint frame_height = state->frame_height/4;
+
+    MediaLibraryBufferPoolPtr dynamic_buffer_pool = NULL;
     {
-      LOGGER__ERROR("PrivacyMaskBlender::PrivacyMaskBlender: Failed to initialize buffer pool");
+      std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
+      for (const PrivacyMaskStatePtr &other_state : m_states)
+      {
+        if (other_state->dynamic_buffer_pool != NULL && other_state->frame_width == state->frame_width && other_state->frame_height == state->frame_height)
+        {
+          dynamic_buffer_pool = other_state->dynamic_buffer_pool;
+          break;
+        }
+      }
+    }
+
+    MediaLibraryBufferPoolPtr buffer_pool = std::make_shared<MediaLibraryBufferPool>(frame_width, frame_height, DSP_IMAGE_FORMAT_GRAY8, NUM_OF_PRIVACY_MASK_BUFFERS, CMA, bytes_per_line);
+    if (buffer_pool->init() != MEDIA_LIBRARY_SUCCESS)
+    {
+      LOGGER__ERROR("PrivacyMaskBlender::init_buffer_pools: Failed to initialize buffer pool");
       return media_library_return::MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
     }
 
-    LOGGER__INFO("PrivacyMaskBlender::PrivacyMaskBlender: Buffer pool initialized successfully with frame size {}x{} bytes_per_line {}", frame_width, frame_height, bytes_per_line);
+    if (dynamic_buffer_pool == NULL)
+    {
+      dynamic_buffer_pool = std::make_shared<MediaLibraryBufferPool>(frame_width, frame_height, DSP_IMAGE_FORMAT_GRAY8, NUM_OF_DYNAMIC_PRIVACY_MASK_BUFFERS, CMA, bytes_per_line);
+      if (dynamic_buffer_pool->init() != MEDIA_LIBRARY_SUCCESS)
+      {
+        LOGGER__ERROR("PrivacyMaskBlender::init_buffer_pools: Failed to initialize dynamic privacy mask buffer pool");
+        return media_library_return::MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
+      }
+    }
+
+    LOGGER__INFO("PrivacyMaskBlender::init_buffer_pools: Buffer pools initialized successfully with frame size {}x{} bytes_per_line {} rotation {}", frame_width, frame_height, bytes_per_line, state->rotation);
+
+    std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
+    state->buffer_pool = buffer_pool;
+    state->dynamic_buffer_pool = dynamic_buffer_pool;
     return media_library_return::MEDIA_LIBRARY_SUCCESS;
 }
 
-void PrivacyMaskBlender::clean_latest_privacy_mask_data()
+PrivacyMaskBlender::shared_privacy_mask_data_t::~shared_privacy_mask_data_t()
+{
+  // May be released with m_privacy_mask_mutex held, so the notification takes another mutex
+  data.reset();
+  {
+    std::unique_lock<std::mutex> release_lock(release->mutex);
+  }
+  release->cv.notify_all();
+}
+
+PrivacyMaskDataPtr PrivacyMaskBlender::share_privacy_mask_data(const PrivacyMaskDataPtr &privacy_mask_data)
+{
+  // A reference to the bitmask for the frames, notifying the rasterization worker once the last of them releases it -
+  // see rasterize()
+  auto shared_data = std::make_shared<shared_privacy_mask_data_t>();
+  shared_data->data = privacy_mask_data;
+  shared_data->release = m_release;
+  return PrivacyMaskDataPtr(shared_data, shared_data->data.get());
+}
+
+void PrivacyMaskBlender::publish_state(const PrivacyMaskStatePtr &state)
 {
-  if (m_latest_privacy_mask_data != NULL)
+  // Called with m_privacy_mask_mutex held, or from the constructors
+  std::shared_ptr<published_privacy_mask_t> published = std::make_shared<published_privacy_mask_t>();
+  published->data = state != NULL && state->latest_data != NULL ? share_privacy_mask_data(state->latest_data) : NULL;
+  if (published->data == NULL)
   {
-    m_latest_privacy_mask_data->bitmask.decrease_ref_count();
-    m_latest_privacy_mask_data = NULL;
+    // Not rasterized yet
+    published->data = make_privacy_mask_data();
+    published->data->color = rgb_to_yuv(m_color);
   }
+  published->dynamic_buffer_pool = state != NULL ? state->dynamic_buffer_pool : NULL;
+  published->frame_width = state != NULL ? state->frame_width : 0;
+  published->frame_height = state != NULL ? state->frame_height : 0;
+  std::atomic_store(&m_published, published);
+}
+
+void PrivacyMaskBlender::activate_state()
+{
+  // Called with m_privacy_mask_mutex held
+  if (m_frame_width == 0 || m_frame_height == 0)
+    return;
+
+  auto it = std::find_if(m_states.begin(), m_states.end(), [this](const PrivacyMaskStatePtr &state)
+                         { return state->frame_width == m_frame_width && state->frame_height == m_frame_height && state->rotation == m_rotation; });
+  if (it != m_states.end())
+  {
+    // Kept up to date by the rasterization worker - frames get its bitmask right away
+    LOGGER__DEBUG("PrivacyMaskBlender::activate_state: Using cached privacy mask of frame size {}x{} rotation {}", m_frame_width, m_frame_height, m_rotation);
+    m_states.splice(m_states.begin(), m_states, it);
+  }
+  else
+  {
+    PrivacyMaskStatePtr state = std::make_shared<privacy_mask_state_t>();
+    state->frame_width = m_frame_width;
+    state->frame_height = m_frame_height;
+    state->rotation = m_rotation;
+    state->back_slot = 0;
+    state->stale = true;
+    m_states.push_front(state);
+    // Frames still using the bitmasks of the evicted state keep them until they are done
+    if (m_states.size() > STATE_CACHE_SIZE)
+      m_states.pop_back();
+  }
+
+  publish_state(m_states.front());
+  m_rasterize_cv.notify_one();
+}
+
+void PrivacyMaskBlender::add_dirty_rect(const polygon &privacy_mask)
+{
+  // Called with m_privacy_mask_mutex held
+  for (const PrivacyMaskStatePtr &state : m_states)
+  {
+    roi_t rect = get_privacy_mask_bounds(privacy_mask, state->frame_width, state->frame_height, state->rotation);
+    if (rect.width == 0 || rect.height == 0)
+      continue;
+
+    // Both bitmasks are behind - the rect is redrawn in each of them when it is drawn next
+    for (privacy_mask_slot_t &slot : state->slots)
+    {
+      if (slot.data == NULL)
+        continue;
+      std::vector<roi_t> &dirty_rects = slot.dirty_rects;
+      dirty_rects.push_back(rect);
+
+      if (dirty_rects.size() > MAX_NUM_OF_DIRTY_RECTS)
+      {
+        uint x_start = UINT_MAX, y_start = UINT_MAX, x_end = 0, y_end = 0;
+        for (const roi_t &dirty_rect : dirty_rects)
+        {
+          x_start = std::min(x_start, dirty_rect.x);
+          y_start = std::min(y_start, dirty_rect.y);
+          x_end = std::max(x_end, dirty_rect.x + dirty_rect.width);
+          y_end = std::max(y_end, dirty_rect.y + dirty_rect.height);
+        }
+        dirty_rects = {{x_start, y_start, x_end - x_start, y_end - y_start}};
+      }
+    }
+  }
+}
+
+void PrivacyMaskBlender::request_rasterize()
+{
+  // Called with m_privacy_mask_mutex held - all the cached states are redrawn, so that switching to one of them
+  // publishes a bitmask of the current masks
+  for (const PrivacyMaskStatePtr &state : m_states)
+    state->stale = true;
+  m_rasterize_cv.notify_one();
+}
+
+PrivacyMaskBlender::PrivacyMaskStatePtr PrivacyMaskBlender::get_stale_state()
+{
+  // Called with m_privacy_mask_mutex held - the current state first
+  for (const PrivacyMaskStatePtr &state : m_states)
+  {
+    if (state->stale)
+      return state;
+  }
+  return NULL;
+}
+
+void PrivacyMaskBlender::rasterize_worker_loop()
+{
+  while (true)
+  {
+    PrivacyMaskStatePtr state;
+    {
+      std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
+      m_rasterize_cv.wait(lock, [this]
+                          { return m_stop_rasterize_worker || get_stale_state() != NULL; });
+      if (m_stop_rasterize_worker)
+        return;
+      state = get_stale_state();
+    }
+
+    rasterize(state);
+  }
+}
+
+void PrivacyMaskBlender::rasterize(const PrivacyMaskStatePtr &state)
+{
+  // The frame geometry of a state does not change. The masks are copied, so that the API calls do not wait for the
+  // drawing.
+  std::vector<PolygonPtr> polygons;
+  std::vector<roi_t> dirty_rects;
+  rgb_color_t color;
+  uint slot_index;
+  PrivacyMaskDataPtr privacy_mask_data;
+  {
+    std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
+    state->stale = false;
+
+    polygons.reserve(m_privacy_masks.size());
+    for (auto &privacy_mask : m_privacy_masks)
+      polygons.emplace_back(std::make_shared<polygon>(*privacy_mask));
+    color = m_color;
+    slot_index = state->back_slot;
+    privacy_mask_slot_t &slot = state->slots[slot_index];
+    if (slot.data == NULL)
+      slot.data = make_privacy_mask_data();
+    privacy_mask_data = slot.data;
+    dirty_rects.swap(slot.dirty_rects);
+  }
+
+  media_library_return ret = media_library_return::MEDIA_LIBRARY_SUCCESS;
+  if (state->buffer_pool == NULL)
+    ret = init_buffer_pools(state);
+
+  // The back bitmask was published before the latest one - wait for the frames still using it (one DSP operation
+  // at most), new frames only get the latest one. The slot and this function hold the other two references.
+  {
+    std::unique_lock<std::mutex> release_lock(m_release->mutex);
+    m_release->cv.wait(release_lock, [this, &privacy_mask_data]
+                       { return m_stop_rasterize_worker || privacy_mask_data.use_count() <= 2; });
+  }
+  if (m_stop_rasterize_worker)
+    return;
+
+  if (ret == MEDIA_LIBRARY_SUCCESS && privacy_mask_data->bitmask.hailo_pix_buffer == nullptr)
+  {
+    // allocate memory for bitmask - kept until the state is evicted
+    ret = state->buffer_pool->acquire_buffer(privacy_mask_data->bitmask);
+    if (ret != MEDIA_LIBRARY_SUCCESS)
+      LOGGER__ERROR("PrivacyMaskBlender::rasterize: Failed to acquire buffer");
+    else
+      ret = write_polygons_to_privacy_mask_data(polygons, state->frame_width, state->frame_height, state->rotation, color, privacy_mask_data);
+  }
+  else if (ret == MEDIA_LIBRARY_SUCCESS)
+  {
+    // Redraw only the regions of the masks changed since this bitmask was drawn
+    ret = update_privacy_mask_data(polygons, dirty_rects, state->frame_width, state->frame_height, state->rotation, color, privacy_mask_data);
+  }
+
+  std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
+  if (ret != MEDIA_LIBRARY_SUCCESS)
+  {
+    LOGGER__ERROR("PrivacyMaskBlender::rasterize: Failed to write polygons");
+    // Drawn from scratch on the next change
+    state->slots[slot_index].data = NULL;
+    state->slots[slot_index].dirty_rects.clear();
+    return;
+  }
+
+  state->latest_data = privacy_mask_data;
+  state->back_slot = (slot_index + 1) % state->slots.size();
+  if (!m_states.empty() && m_states.front() == state)
+    publish_state(state);
 }
 
 media_library_return PrivacyMaskBlender::add_privacy_mask(const polygon &privacy_mask)
@@ -150,12 +416,10 @@ media_library_return PrivacyMaskBlender::add_privacy_mask(const polygon &privacy
   }
 
   PolygonPtr polygon = std::make_shared<privacy_mask_types::polygon>(privacy_mask);
-
-  // double rotation_angle = m_rotation;
-  // rotate_polygon(polygon, rotation_angle, m_frame_width, m_frame_height);
   m_privacy_masks.emplace_back(polygon);
 
-  clean_latest_privacy_mask_data();
+  add_dirty_rect(*polygon);
+  request_rasterize();
 
   return media_library_return::MEDIA_LIBRARY_SUCCESS;
 }
@@ -179,13 +443,11 @@ media_library_return PrivacyMaskBlender::set_privacy_mask(const polygon &privacy
   }
 
   PolygonPtr privacy_mask_to_update = *it;
-  // Update polygon
+  // Update polygon - both where it was and where it is now are redrawn
+  add_dirty_rect(*privacy_mask_to_update);
   privacy_mask_to_update->vertices = privacy_mask.vertices;
-
-  clean_latest_privacy_mask_data();
-
-  // double rotation_angle = m_rotation;
-  // rotate_polygon(privacy_mask_to_update, rotation_angle, m_frame_width, m_frame_height);
+  add_dirty_rect(*privacy_mask_to_update);
+  request_rasterize();
   return media_library_return::MEDIA_LIBRARY_SUCCESS;
 }
 
@@ -199,63 +461,39 @@ media_library_return PrivacyMaskBlender::remove_privacy_mask(const std::string &
     LOGGER__ERROR("PrivacyMaskBlender::remove_privacy_mask: Privacy mask with id {} not found", id);
     return media_library_return::MEDIA_LIBRARY_ERROR;
   }
+  add_dirty_rect(**it);
   m_privacy_masks.erase(it);
-
-  clean_latest_privacy_mask_data();
+  request_rasterize();
 
   return media_library_return::MEDIA_LIBRARY_SUCCESS;
 }
 
 media_library_return PrivacyMaskBlender::set_color(const rgb_color_t &color)
 {
+  std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
   m_color = color;
+  request_rasterize();
   return media_library_return::MEDIA_LIBRARY_SUCCESS;
 }
 
 media_library_return PrivacyMaskBlender::set_rotation(const rotation_angle_t &rotation)
 {
+  std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
   if(m_rotation == rotation)
   {
     LOGGER__WARNING("PrivacyMaskBlender::set_rotation: Rotation is already set to {}, skipping update", rotation);
     return media_library_return::MEDIA_LIBRARY_SUCCESS;
   }
 
-  std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
-
-  // Rotate polygons
-  // double rotation_angle = rotation - m_rotation;
-  // LOGGER__INFO("PrivacyMaskBlender::set_rotation: Rotating polygons by {} degrees", rotation_angle);
-  // if (rotate_polygons(m_privacy_masks, rotation_angle, m_frame_width, m_frame_height) != media_library_return::MEDIA_LIBRARY_SUCCESS)
-  // {
-  //   LOGGER__ERROR("PrivacyMaskBlender::set_rotation: Failed to rotate polygons");
-  //   return media_library_return::MEDIA_LIBRARY_ERROR;
-  // }
-
-  // Swap frame width and height if needed
-  if ((m_rotation == ROTATION_ANGLE_0 || m_rotation == ROTATION_ANGLE_180) && (rotation == ROTATION_ANGLE_90 || rotation == ROTATION_ANGLE_270))
-  {
-    std::swap(m_frame_width, m_frame_height);
-  }
-  else if ((m_rotation == ROTATION_ANGLE_90 || m_rotation == ROTATION_ANGLE_270) && (rotation == ROTATION_ANGLE_0 || rotation == ROTATION_ANGLE_180))
-  {
-    std::swap(m_frame_width, m_frame_height);
-  }
-
-  clean_latest_privacy_mask_data();
-
-  // Initialize buffer pool with new dimensions
-  if (init_buffer_pool() != media_library_return::MEDIA_LIBRARY_SUCCESS)
-  {
-    LOGGER__ERROR("PrivacyMaskBlender::set_rotation: Failed to initialize buffer pool");
-    return media_library_return::MEDIA_LIBRARY_ERROR;
-  }
-
+  // The masks are not rotated - they are rotated exactly when drawn, so rotating back and forth does not move them
   m_rotation = rotation;
+  activate_state();
   return media_library_return::MEDIA_LIBRARY_SUCCESS;
 }
 
 tl::expected<rgb_color_t, media_library_return> PrivacyMaskBlender::get_color()
 {
+  std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
   return m_color;
 }
 
@@ -287,16 +525,7 @@ media_library_return PrivacyMaskBlender::set_frame_size(const uint &width, const
   std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
   m_frame_width = width;
   m_frame_height = height;
-
-  clean_latest_privacy_mask_data();
-
-  // Initialize buffer pool
-  if (init_buffer_pool() != media_library_return::MEDIA_LIBRARY_SUCCESS)
-  {
-    LOGGER__ERROR("PrivacyMaskBlender::set_rotation: Failed to initialize buffer pool at new frame size");
-    return media_library_return::MEDIA_LIBRARY_ERROR;
-  }
-
+  activate_state();
   return media_library_return::MEDIA_LIBRARY_SUCCESS;
 }
 
@@ -313,37 +542,35 @@ tl::expected<std::vector<polygon>, media_library_return> PrivacyMaskBlender::get
 
 tl::expected<PrivacyMaskDataPtr, media_library_return> PrivacyMaskBlender::blend()
 {
-  if(m_latest_privacy_mask_data != NULL)
-  {
-    return m_latest_privacy_mask_data;
-  }
+  // Called from the frame path - never waits for the rasterization. Empty until the masks are first rasterized.
+  return std::atomic_load(&m_published)->data;
+}
 
-  m_latest_privacy_mask_data = std::make_shared<privacy_mask_data_t>();
-  if (m_privacy_masks.empty())
-  {
-    m_latest_privacy_mask_data->rois_count = 0;
-    return m_latest_privacy_mask_data;
-  }
+tl::expected<PrivacyMaskDataPtr, media_library_return> PrivacyMaskBlender::blend(const std::vector<roi_t> &rects)
+{
+  // The static bitmask and the pool of the same state
+  std::shared_ptr<published_privacy_mask_t> published = std::atomic_load(&m_published);
+  if (rects.empty())
+    return published->data;
 
-  if (m_buffer_pool == NULL)
+  if (published->dynamic_buffer_pool == NULL)
   {
-      LOGGER__ERROR("PrivacyMaskBlender::set_rotation: buffer pool is uninitialized");
-      return tl::make_unexpected(media_library_return::MEDIA_LIBRARY_ERROR);
+    LOGGER__WARNING("PrivacyMaskBlender::blend: Privacy mask buffers are not allocated yet, skipping {} rectangles", rects.size());
+    return published->data;
   }
 
-  // allocate memory for bitmask
-  if (m_buffer_pool->acquire_buffer(m_latest_privacy_mask_data->bitmask) != MEDIA_LIBRARY_SUCCESS)
+  PrivacyMaskDataPtr privacy_mask_data = make_privacy_mask_data();
+  if (published->dynamic_buffer_pool->acquire_buffer(privacy_mask_data->bitmask) != MEDIA_LIBRARY_SUCCESS)
   {
     LOGGER__ERROR("PrivacyMaskBlender::blend: Failed to acquire buffer");
     return tl::make_unexpected(media_library_return::MEDIA_LIBRARY_ERROR);
   }
-  
-  std::unique_lock<std::mutex> lock(*m_privacy_mask_mutex);
-  if (write_polygons_to_privacy_mask_data(m_privacy_masks, m_frame_width, m_frame_height, m_color, m_latest_privacy_mask_data) != media_library_return::MEDIA_LIBRARY_SUCCESS)
+
+  if (write_rects_to_privacy_mask_data(rects, published->frame_width, published->frame_height, published->data, privacy_mask_data) != media_library_return::MEDIA_LIBRARY_SUCCESS)
   {
-    LOGGER__ERROR("PrivacyMaskBlender::blend: Failed to write polygon");
+    LOGGER__ERROR("PrivacyMaskBlender::blend: Failed to write rectangles");
     return tl::make_unexpected(media_library_return::MEDIA_LIBRARY_ERROR);
   }
 
-  return m_latest_privacy_mask_data;
-}
\ No newline at end of file
+  return privacy_mask_data;
+}
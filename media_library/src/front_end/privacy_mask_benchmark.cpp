@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2017-2023 Hailo Technologies Ltd. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * @file privacy_mask_benchmark.cpp
+ * @brief Measures the privacy mask rasterization at 4K with many masks, and checks the word level rasterizer against
+ * a bit by bit reference. Does the same for the redraw of the dirty region of a moved mask against a full redraw.
+ * Measures the clustering of the masks into the DSP ROIs, and the share of the frame the ROIs blend.
+ * Measures the per frame rectangles (e.g. detected faces) drawn over the bitmask of 8 masks.
+ *
+ * Usage: privacy_mask_benchmark [iterations]
+ **/
+#include "bitmask_rasterizer.hpp"
+#include "polygon_math.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+// 3840x2160 quantized by 4, rows padded to 8 bytes
+constexpr uint32_t MASK_WIDTH = 960;
+constexpr uint32_t MASK_HEIGHT = 540;
+constexpr uint32_t BYTES_PER_LINE = ((MASK_WIDTH + 7) / 8 + 7) & ~7u;
+constexpr uint32_t MAX_VERTICES = 8;
+// Largest mask extent, in mask pixels
+constexpr int MAX_MASK_SIZE = 100;
+// Per frame rectangle extents, in frame pixels
+constexpr int MIN_RECT_SIZE = 32;
+constexpr int MAX_RECT_SIZE = 256;
+
+using polygon_t = std::vector<bitmask_point_t>;
+using bitmask_t = std::vector<uint8_t>;
+
+template <typename Func>
+double measure_us(int iterations, Func func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        func(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+polygon_t random_polygon(std::mt19937 &rng)
+{
+    // Vertices around a center, sorted by angle so that most polygons are simple, some are not
+    std::uniform_int_distribution<int> center_x(-MAX_MASK_SIZE / 2, MASK_WIDTH + MAX_MASK_SIZE / 2);
+    std::uniform_int_distribution<int> center_y(-MAX_MASK_SIZE / 2, MASK_HEIGHT + MAX_MASK_SIZE / 2);
+    std::uniform_int_distribution<int> count(3, MAX_VERTICES);
+    std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+    std::uniform_real_distribution<float> radius(2.f, MAX_MASK_SIZE / 2);
+    int cx = center_x(rng), cy = center_y(rng);
+    std::vector<float> angles(count(rng));
+    for (float &a : angles)
+        a = angle(rng);
+    std::sort(angles.begin(), angles.end());
+
+    polygon_t polygon;
+    for (float a : angles)
+    {
+        float r = radius(rng);
+        // Vertices are unsigned in the API - clamp at 0, allow past the right and bottom borders
+        polygon.push_back({std::max(0, cx + static_cast<int>(r * std::cos(a))),
+                           std::max(0, cy + static_cast<int>(r * std::sin(a)))});
+    }
+    return polygon;
+}
+
+roi_t polygon_bounds(const polygon_t &polygon)
+{
+    int min_x = INT32_MAX, min_y = INT32_MAX, max_x = 0, max_y = 0;
+    for (const bitmask_point_t &p : polygon)
+    {
+        min_x = std::min(min_x, p.x);
+        min_y = std::min(min_y, p.y);
+        max_x = std::max(max_x, p.x);
+        max_y = std::max(max_y, p.y);
+    }
+    if (min_x >= (int)MASK_WIDTH || min_y >= (int)MASK_HEIGHT)
+        return {0, 0, 0, 0};
+    return {(uint32_t)min_x, (uint32_t)min_y, std::min<uint32_t>(max_x - min_x + 1, MASK_WIDTH - min_x),
+            std::min<uint32_t>(max_y - min_y + 1, MASK_HEIGHT - min_y)};
+}
+
+bool overlaps(const roi_t &a, const roi_t &b)
+{
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+bool contains(const roi_t &outer, const roi_t &inner)
+{
+    return outer.x <= inner.x && outer.y <= inner.y && inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+/// Bit by bit reference - a pixel is set when an odd number of edges cross its row center left of (or on) its center
+void reference_fill(const polygon_t &polygon, const roi_t &clip, bitmask_t &bitmask)
+{
+    for (uint32_t y = clip.y; y < clip.y + clip.height; y++)
+    {
+        for (uint32_t x = clip.x; x < clip.x + clip.width; x++)
+        {
+            int crossings = 0;
+            for (size_t i = 0; i < polygon.size(); i++)
+            {
+                bitmask_point_t p0 = polygon[i], p1 = polygon[(i + 1) % polygon.size()];
+                if (p0.y == p1.y)
+                    continue;
+                if (p0.y > p1.y)
+                    std::swap(p0, p1);
+                if ((int)y < p0.y || (int)y >= p1.y)
+                    continue;
+                // x + 0.5 >= p0.x + (p1.x - p0.x) * (y + 0.5 - p0.y) / (p1.y - p0.y)
+                int64_t dy = p1.y - p0.y;
+                if ((2 * (int64_t)x + 1) * dy >= 2 * (int64_t)p0.x * dy + (int64_t)(p1.x - p0.x) * (2 * ((int64_t)y - p0.y) + 1))
+                    crossings++;
+            }
+            if (crossings % 2)
+                bitmask[y * BYTES_PER_LINE + x / 8] |= 0x80 >> (x % 8);
+        }
+    }
+}
+
+void fill_all(const std::vector<polygon_t> &polygons, const roi_t &clip, bitmask_t &bitmask)
+{
+    for (const polygon_t &polygon : polygons)
+    {
+        if (overlaps(polygon_bounds(polygon), clip))
+            fill_polygon_bitmask(polygon, clip, bitmask.data(), BYTES_PER_LINE);
+    }
+}
+
+// Privacy mask data with its bitmask in host memory
+struct host_privacy_mask_t
+{
+    bitmask_t memory = bitmask_t(BYTES_PER_LINE * MASK_HEIGHT, 0);
+    dsp_data_plane_t plane = {.userptr = memory.data(), .bytesperline = BYTES_PER_LINE, .bytesused = BYTES_PER_LINE * MASK_HEIGHT};
+    dsp_image_properties_t properties = {};
+    privacy_mask_types::PrivacyMaskDataPtr data = std::make_shared<privacy_mask_types::privacy_mask_data_t>();
+
+    host_privacy_mask_t()
+    {
+        properties.planes = &plane;
+        properties.planes_count = 1;
+        data->bitmask.hailo_pix_buffer = DspImagePropertiesPtr(&properties, [](dsp_image_properties_t *) {});
+        data->rois_count = 0;
+    }
+};
+
+bool run_rects(int rect_count, int iterations, std::mt19937 &rng)
+{
+    // 8 static masks, with their ROIs
+    host_privacy_mask_t static_mask;
+    std::vector<roi_t> boxes;
+    for (int i = 0; i < 8; i++)
+    {
+        polygon_t polygon = random_polygon(rng);
+        fill_polygon_bitmask(polygon, {0, 0, MASK_WIDTH, MASK_HEIGHT}, static_mask.memory.data(), BYTES_PER_LINE);
+        boxes.push_back(polygon_bounds(polygon));
+    }
+    static_mask.data->rois_count = cluster_privacy_mask_rois(boxes, static_mask.data->rois, MAX_NUM_OF_PRIVACY_MASK_ROIS);
+
+    std::vector<std::vector<roi_t>> frames(iterations);
+    std::uniform_int_distribution<uint> x(0, MASK_WIDTH / PRIVACY_MASK_QUANTIZATION - 1);
+    std::uniform_int_distribution<uint> y(0, MASK_HEIGHT / PRIVACY_MASK_QUANTIZATION - 1);
+    std::uniform_int_distribution<uint> size(MIN_RECT_SIZE, MAX_RECT_SIZE);
+    for (std::vector<roi_t> &rects : frames)
+    {
+        for (int i = 0; i < rect_count; i++)
+            rects.push_back({x(rng), y(rng), size(rng), size(rng)});
+    }
+
+    host_privacy_mask_t frame_mask;
+    bool ok = true;
+    double rects_us = measure_us(iterations, [&](int i) {
+        ok &= write_rects_to_privacy_mask_data(frames[i], MASK_WIDTH / PRIVACY_MASK_QUANTIZATION, MASK_HEIGHT / PRIVACY_MASK_QUANTIZATION,
+                                               static_mask.data, frame_mask.data) == MEDIA_LIBRARY_SUCCESS;
+    });
+
+    // Bit by bit - the static masks, and every pixel touched by a rectangle
+    bitmask_t reference = static_mask.memory;
+    for (const roi_t &rect : frames.back())
+    {
+        for (uint py = rect.y / 4; py < std::min((rect.y + rect.height + 3) / 4, MASK_HEIGHT); py++)
+        {
+            for (uint px = rect.x / 4; px < std::min((rect.x + rect.width + 3) / 4, MASK_WIDTH); px++)
+                reference[py * BYTES_PER_LINE + px / 8] |= 0x80 >> (px % 8);
+        }
+    }
+    ok &= frame_mask.memory == reference && frame_mask.data->rois_count <= MAX_NUM_OF_PRIVACY_MASK_ROIS;
+
+    printf("%6d %12.1f %5u   %s\n", rect_count, rects_us, frame_mask.data->rois_count, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+bool run(int mask_count, int iterations, std::mt19937 &rng)
+{
+    const roi_t frame = {0, 0, MASK_WIDTH, MASK_HEIGHT};
+    std::vector<polygon_t> polygons;
+    for (int i = 0; i < mask_count; i++)
+        polygons.push_back(random_polygon(rng));
+
+    // Full rasterization
+    bitmask_t bitmask(BYTES_PER_LINE * MASK_HEIGHT);
+    double full_us = measure_us(iterations, [&](int) {
+        clear_bitmask_rect(bitmask.data(), BYTES_PER_LINE, frame);
+        fill_all(polygons, frame, bitmask);
+    });
+    bitmask_t reference(BYTES_PER_LINE * MASK_HEIGHT, 0);
+    double reference_us = measure_us(1, [&](int) {
+        for (const polygon_t &polygon : polygons)
+            reference_fill(polygon, polygon_bounds(polygon), reference);
+    });
+    bool full_ok = bitmask == reference;
+
+    // Move one mask at a time, redrawing its old and new regions
+    std::vector<polygon_t> moved = polygons;
+    std::vector<polygon_t> moves;
+    for (int i = 0; i < iterations; i++)
+        moves.push_back(random_polygon(rng));
+    double update_us = measure_us(iterations, [&](int i) {
+        size_t index = i % moved.size();
+        roi_t dirty[2] = {polygon_bounds(moved[index]), polygon_bounds(moves[i])};
+        moved[index] = moves[i];
+        for (const roi_t &rect : dirty)
+        {
+            clear_bitmask_rect(bitmask.data(), BYTES_PER_LINE, rect);
+            fill_all(moved, rect, bitmask);
+        }
+    });
+    bitmask_t redrawn(BYTES_PER_LINE * MASK_HEIGHT, 0);
+    fill_all(moved, frame, redrawn);
+    bool update_ok = bitmask == redrawn;
+
+    // Clustering into the DSP ROIs - every mask must be inside one of them
+    std::vector<roi_t> boxes;
+    for (const polygon_t &polygon : polygons)
+        boxes.push_back(polygon_bounds(polygon));
+    roi_t rois[MAX_NUM_OF_PRIVACY_MASK_ROIS];
+    uint rois_count = 0;
+    double cluster_us = measure_us(iterations, [&](int) {
+        rois_count = cluster_privacy_mask_rois(boxes, rois, MAX_NUM_OF_PRIVACY_MASK_ROIS);
+    });
+    bool cluster_ok = rois_count <= MAX_NUM_OF_PRIVACY_MASK_ROIS;
+    uint64_t blended_area = 0;
+    for (uint i = 0; i < rois_count; i++)
+        blended_area += static_cast<uint64_t>(rois[i].width) * rois[i].height;
+    for (const roi_t &box : boxes)
+    {
+        if (box.width != 0 && std::none_of(rois, rois + rois_count, [&](const roi_t &roi) { return contains(roi, box); }))
+            cluster_ok = false;
+    }
+
+    bool ok = full_ok && update_ok && cluster_ok;
+    printf("%6d %12.1f %12.1f %12.1f %5u %9.1f%% %12.1f   %s\n", mask_count, full_us, update_us, cluster_us, rois_count,
+           100.0 * blended_area / (MASK_WIDTH * MASK_HEIGHT), reference_us,
+           ok ? "ok" : (!full_ok ? "MISMATCH" : (!update_ok ? "UPDATE MISMATCH" : "CLUSTER MISMATCH")));
+    return ok;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 50;
+    std::mt19937 rng(1);
+
+    printf("%ux%u mask (3840x2160 frame), %d iterations\n", MASK_WIDTH, MASK_HEIGHT, iterations);
+    printf(" masks      full us  one move us   cluster us  rois   blended  bit by bit us\n");
+    bool ok = true;
+    for (int mask_count : {1, 8, 32, 64, 128, MAX_NUM_OF_PRIVACY_MASKS})
+        ok &= run(mask_count, iterations, rng);
+
+    printf("\nPer frame rectangles over 8 masks\n");
+    printf(" rects     frame us  rois\n");
+    for (int rect_count : {1, 4, 16, 64})
+        ok &= run_rects(rect_count, iterations, rng);
+    return ok ? 0 : 1;
+}
@@ -138,6 +138,17 @@ std::shared_ptr<EncoderConfig> Encoder::get_config()
 
 std::shared_ptr<EncoderConfig> Encoder::Impl::get_config() { return m_config; }
 
+frame_latency_stats_t Encoder::get_latency_stats()
+{
+    return m_impl->get_latency_stats();
+}
+
+frame_latency_stats_t Encoder::Impl::get_latency_stats()
+{
+    std::unique_lock<std::mutex> lock(m_latency_stats_mutex);
+    return m_latency_stats;
+}
+
 EncoderOutputBuffer Encoder::start() { return m_impl->start(); }
 
 EncoderOutputBuffer Encoder::Impl::start()
@@ -309,6 +320,13 @@ Encoder::Impl::encode_frame(HailoMediaLibraryBufferPtr buf,
     clock_gettime(CLOCK_MONOTONIC, &end_encode);
     LOGGER__DEBUG("Encoding of frame took {} ms",
                   time_diff(end_encode, start_encode));
+
+    // The encode stage spans from handle_frame, including the wait for the rest of the GOP
+    buf->latency.stamp_end(FRAME_LATENCY_STAGE_ENCODE);
+    {
+        std::unique_lock<std::mutex> lock(m_latency_stats_mutex);
+        m_latency_stats.add(buf->latency, FRAME_LATENCY_STAGE_ENCODE);
+    }
     switch (enc_ret)
     {
     case VCENC_FRAME_READY:
@@ -359,6 +377,7 @@ std::vector<EncoderOutputBuffer>
 Encoder::Impl::handle_frame(HailoMediaLibraryBufferPtr buf)
 {
     LOGGER__DEBUG("Start Handling Frame");
+    buf->latency.stamp_start(FRAME_LATENCY_STAGE_ENCODE);
     std::vector<EncoderOutputBuffer> outputs;
     outputs.clear();
     media_library_return ret = MEDIA_LIBRARY_UNINITIALIZED;
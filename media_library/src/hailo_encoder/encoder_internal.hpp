@@ -23,6 +23,7 @@
 #pragma once
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 
 extern "C"
@@ -83,11 +84,14 @@ private:
   class gopConfig;
   std::unique_ptr<gopConfig> m_gop_cfg;
   MediaLibraryBufferPoolPtr m_buffer_pool;
+  std::mutex m_latency_stats_mutex;
+  frame_latency_stats_t m_latency_stats;
 
 public:
   Impl(std::string json_string);
   ~Impl();
   std::vector<EncoderOutputBuffer> handle_frame(HailoMediaLibraryBufferPtr buf);
+  frame_latency_stats_t get_latency_stats();
   void force_keyframe();
   void update_stride(uint32_t stride);
   int get_gop_size();
@@ -25,6 +25,7 @@
 #include "buffer_pool.hpp"
 #include "config_manager.hpp"
 #include "dewarp_mesh_context.hpp"
+#include "dsp_scheduler.hpp"
 #include "dsp_utils.hpp"
 #include "media_library_logger.hpp"
 #include "media_library_utils.hpp"
@@ -90,6 +91,8 @@ private:
     std::vector<MediaLibraryBufferPoolPtr> m_buffer_pools;
     // video fd
     int m_video_fd;
+    // sensor of the input frames, for sharing the DSP with other sensors
+    dsp_scheduler::sensor_id_t m_dsp_sensor_id;
     // configuration mutex
     std::shared_ptr<std::mutex> m_configuration_mutex;
 
@@ -166,6 +169,7 @@ MediaLibraryVisionPreProc::Impl::Impl(media_library_return &status, std::string
 {
     m_configured = false;
     m_video_fd = -1;
+    m_dsp_sensor_id = dsp_scheduler::invalid_sensor_id;
     m_configuration_mutex = std::make_shared<std::mutex>();
 
     // Start frame count from 0 - to make sure we always handle the first frame even if framerate is set to 0
@@ -187,6 +191,8 @@ MediaLibraryVisionPreProc::Impl::Impl(media_library_return &status, std::string
         status = MEDIA_LIBRARY_OUT_OF_RESOURCES;
         return;
     }
+    m_dsp_sensor_id = dsp_scheduler::register_sensor(m_pre_proc_configs.input_video_config.video_device,
+                                                     m_pre_proc_configs.input_video_config.resolution.framerate);
 
     m_dewarp_mesh_ctx = std::make_unique<DewarpMeshContext>(m_pre_proc_configs);
     if (configure(m_pre_proc_configs) != MEDIA_LIBRARY_SUCCESS)
@@ -202,6 +208,7 @@ MediaLibraryVisionPreProc::Impl::~Impl()
 {
     m_pre_proc_configs.output_video_config.resolutions.clear();
     m_dewarp_mesh_ctx = nullptr;
+    dsp_scheduler::unregister_sensor(m_dsp_sensor_id);
     dsp_status status = dsp_utils::release_device();
     if (status != DSP_SUCCESS)
     {
@@ -392,6 +399,7 @@ media_library_return MediaLibraryVisionPreProc::Impl::acquire_output_buffers(hai
         if (m_buffer_pools[i]->acquire_buffer(buffer) != MEDIA_LIBRARY_SUCCESS)
         {
             LOGGER__ERROR("Failed to acquire buffer");
+            dsp_scheduler::record_dropped_frame(m_dsp_sensor_id);
             return MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
         }
         buffers.emplace_back(std::move(buffer));
@@ -421,17 +429,21 @@ media_library_return MediaLibraryVisionPreProc::Impl::perform_dewarp(
         MEDIA_LIBRARY_SUCCESS)
     {
         // log: failed to acquire buffer for dewarp output
+        dsp_scheduler::record_dropped_frame(m_dsp_sensor_id);
         return MEDIA_LIBRARY_BUFFER_ALLOCATION_ERROR;
     }
 
     // Perform dewarp
-    dsp_dewarp_mesh_t *mesh = m_dewarp_mesh_ctx->get();
+    // Held until the DSP is done with it, so the mesh context does not reuse it meanwhile
+    DspDewarpMeshPtr mesh = m_dewarp_mesh_ctx->get();
     LOGGER__TRACE("Performing dewarp with mesh (w={}, h={}) interpolation type {}", mesh->mesh_width, mesh->mesh_height, m_pre_proc_configs.dewarp_config.interpolation_type);
     clock_gettime(CLOCK_MONOTONIC, &start_dewarp);
+    dsp_scheduler::job_t dsp_job = dsp_scheduler::begin_job(m_dsp_sensor_id);
     dsp_status ret = dsp_utils::perform_dsp_dewarp(
         input_buffer.hailo_pix_buffer.get(),
-        dewarp_output_buffer.hailo_pix_buffer.get(), mesh,
+        dewarp_output_buffer.hailo_pix_buffer.get(), mesh.get(),
         m_pre_proc_configs.dewarp_config.interpolation_type);
+    dsp_scheduler::end_job(dsp_job);
     clock_gettime(CLOCK_MONOTONIC, &end_dewarp);
     [[maybe_unused]] long ms = (long)media_library_difftimespec_ms(end_dewarp, start_dewarp);
     LOGGER__TRACE("perform_dsp_dewarp took {} milliseconds ({} fps)", ms, (1000 / ms));
@@ -547,7 +559,9 @@ media_library_return MediaLibraryVisionPreProc::Impl::perform_multi_resize(
     // Perform multi resize
     LOGGER__DEBUG("Performing multi resize on the DSP with digital zoom ROI: start_x {} start_y {} end_x {} end_y {}", start_x, start_y, end_x, end_y);
     clock_gettime(CLOCK_MONOTONIC, &start_resize);
+    dsp_scheduler::job_t dsp_job = dsp_scheduler::begin_job(m_dsp_sensor_id);
     dsp_status ret = dsp_utils::perform_dsp_multi_resize(&multi_resize_params, start_x, start_y, end_x, end_y);
+    dsp_scheduler::end_job(dsp_job);
     clock_gettime(CLOCK_MONOTONIC, &end_resize);
     [[maybe_unused]] long ms = (long)media_library_difftimespec_ms(end_resize, start_resize);
     LOGGER__TRACE("perform_multi_resize took {} milliseconds ({} fps)", ms, 1000 / ms);
@@ -646,6 +660,7 @@ media_library_return MediaLibraryVisionPreProc::Impl::handle_frame(hailo_media_l
     // Stamp start time
     struct timespec start_handle, end_handle;
     clock_gettime(CLOCK_MONOTONIC, &start_handle);
+    input_frame.latency.stamp_start(FRAME_LATENCY_STAGE_VISION_PRE_PROC);
 
     if (validate_input_and_output_frames(input_frame, output_frames) != MEDIA_LIBRARY_SUCCESS)
     {
@@ -682,6 +697,11 @@ media_library_return MediaLibraryVisionPreProc::Impl::handle_frame(hailo_media_l
         media_lib_ret = perform_multi_resize(input_frame, output_frames);
     }
 
+    // The output frames carry on the latency record of the input frame
+    input_frame.latency.stamp_end(FRAME_LATENCY_STAGE_VISION_PRE_PROC);
+    for (hailo_media_library_buffer &output_frame : output_frames)
+        output_frame.latency = input_frame.latency;
+
     // Unref the input frame
     input_frame.decrease_ref_count();
 
@@ -21,10 +21,12 @@ std::shared_ptr<webserver::pipeline::IPipeline> webserver::pipeline::IPipeline::
 std::shared_ptr<webserver::pipeline::Pipeline> webserver::pipeline::Pipeline::create()
 {
     auto resources = webserver::resources::ResourceRepository::create();
+    nlohmann::json input_config = resources->get(webserver::resources::RESOURCE_FRONTEND)->get()["input_stream"];
+    nlohmann::json input_resolution = input_config["resolution"];
 
     std::ostringstream pipeline;
-    pipeline << "v4l2src device=/dev/video0 io-mode=mmap ! ";
-    pipeline << "video/x-raw,format=NV12,width=3840,height=2160,framerate=30/1 ! ";
+    pipeline << "v4l2src device=" << input_config["source"].get<std::string>() << " io-mode=mmap ! ";
+    pipeline << "video/x-raw,format=NV12,width=" << input_resolution["width"] << ",height=" << input_resolution["height"] << ",framerate=" << input_resolution["framerate"] << "/1 ! ";
     pipeline << "queue leaky=downstream max-size-buffers=5 max-size-bytes=0 max-size-time=0 ! ";
     pipeline << "hailofrontend name=frontend config-string='" << resources->get(webserver::resources::RESOURCE_FRONTEND)->to_string() << "' ";
     pipeline << "frontend. ! ";